@@ -0,0 +1,41 @@
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> allocation_count{0};
+
+auto allocate(std::size_t size) -> void* {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (auto* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+}  // namespace
+
+auto operator new(std::size_t size) -> void* { return allocate(size); }
+
+auto operator new[](std::size_t size) -> void* { return allocate(size); }
+
+auto operator delete(void* p) noexcept -> void { std::free(p); }
+
+auto operator delete[](void* p) noexcept -> void { std::free(p); }
+
+auto operator delete(void* p, std::size_t) noexcept -> void { std::free(p); }
+
+auto operator delete[](void* p, std::size_t) noexcept -> void {
+  std::free(p);
+}
+
+namespace fz::http::bench {
+
+auto allocations() -> std::size_t {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+}  // namespace fz::http::bench
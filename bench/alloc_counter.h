@@ -0,0 +1,42 @@
+#ifndef __FZ_HTTP_BENCH_ALLOC_COUNTER_H__
+#define __FZ_HTTP_BENCH_ALLOC_COUNTER_H__
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+
+namespace fz::http::bench {
+
+/**
+ * @brief Number of calls to the global operator new so far, counted by the
+ * replacement in alloc_counter.cpp linked into every benchmark.
+ */
+auto allocations() -> std::size_t;
+
+/**
+ * @brief Counts the allocations made while it's alive and reports them per
+ * iteration as the "allocs" counter of state.
+ */
+class AllocationCounter {
+ public:
+  explicit AllocationCounter(benchmark::State& state)
+      : _state{state}, _start{allocations()} {}
+
+  AllocationCounter(const AllocationCounter&) = delete;
+
+  auto operator=(const AllocationCounter&) -> AllocationCounter& = delete;
+
+  ~AllocationCounter() {
+    _state.counters["allocs"] =
+        benchmark::Counter(static_cast<double>(allocations() - _start),
+                           benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State& _state;
+  std::size_t _start;
+};
+
+}  // namespace fz::http::bench
+
+#endif  // __FZ_HTTP_BENCH_ALLOC_COUNTER_H__
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+
+#include "alloc_counter.h"
+#include "http/http_response.h"
+#include "net/common/buffer.h"
+
+namespace {
+
+using fz::http::HttpResponse;
+using fz::http::bench::AllocationCounter;
+
+// A response as a typical handler builds it, with a body of range(0) bytes.
+auto makeResponse(std::size_t body_size) -> HttpResponse {
+  auto response = HttpResponse::makeOk();
+  response.addHeader("Content-Type", "application/json");
+  response.addHeader("Cache-Control", "no-cache");
+  response.addHeader("X-Request-Id", "6f1c2d3e-4b5a-6978-8a9b-0c1d2e3f4a5b");
+  response.setBody(std::string(body_size, 'x'));
+  return response;
+}
+
+// toString() builds a fresh string for every response.
+auto BM_HttpResponseToString(benchmark::State& state) {
+  const auto response = makeResponse(static_cast<std::size_t>(state.range(0)));
+  auto bytes = std::size_t{0};
+  {
+    auto counter = AllocationCounter{state};
+    for (auto _ : state) {
+      const auto str = response.toString();
+      bytes += str.size();
+      benchmark::DoNotOptimize(str.data());
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+// serialize() into a reused output buffer, which is what a session does.
+auto BM_HttpResponseSerialize(benchmark::State& state) {
+  const auto response = makeResponse(static_cast<std::size_t>(state.range(0)));
+  auto buffer = fz::net::Buffer{};
+  auto bytes = std::size_t{0};
+  {
+    auto counter = AllocationCounter{state};
+    for (auto _ : state) {
+      response.serialize(buffer, "fz");
+      bytes += buffer.readableBytes();
+      benchmark::DoNotOptimize(buffer.peek());
+      buffer.retrieve(buffer.readableBytes());
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+// Building the response in the handler plus serializing it.
+auto BM_HttpResponseBuildAndSerialize(benchmark::State& state) {
+  const auto body_size = static_cast<std::size_t>(state.range(0));
+  auto buffer = fz::net::Buffer{};
+  auto bytes = std::size_t{0};
+  {
+    auto counter = AllocationCounter{state};
+    for (auto _ : state) {
+      makeResponse(body_size).serialize(buffer, "fz");
+      bytes += buffer.readableBytes();
+      buffer.retrieve(buffer.readableBytes());
+    }
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+}  // namespace
+
+BENCHMARK(BM_HttpResponseToString)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(BM_HttpResponseSerialize)->Arg(0)->Arg(1024)->Arg(64 * 1024);
+BENCHMARK(BM_HttpResponseBuildAndSerialize)->Arg(0)->Arg(1024)->Arg(64 * 1024);
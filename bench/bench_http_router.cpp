@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "http/http_router.h"
+
+namespace {
+
+using fz::http::HttpRequest;
+using fz::http::HttpResponse;
+using fz::http::HttpRouter;
+using fz::http::bench::AllocationCounter;
+
+auto handler(const HttpRequest&) -> HttpResponse { return {}; }
+
+// Route tables shaped like an API gateway: resource collections, items by id
+// and nested sub resources.
+auto staticPaths(std::size_t count) {
+  auto paths = std::vector<std::string>{};
+  for (std::size_t i = 0; paths.size() < count; ++i) {
+    paths.push_back("/api/v1/service" + std::to_string(i / 8) + "/resource" +
+                    std::to_string(i % 8));
+  }
+  return paths;
+}
+
+auto BM_UnorderedMapStatic(benchmark::State& state) {
+  const auto paths = staticPaths(static_cast<std::size_t>(state.range(0)));
+  auto handlers =
+      std::unordered_map<std::string,
+                         std::function<HttpResponse(const HttpRequest&)>>{};
+  for (const auto& path : paths) {
+    handlers.emplace(path, handler);
+  }
+
+  auto counter = AllocationCounter{state};
+  std::size_t i = 0;
+  for (auto _ : state) {
+    // The server used to copy the path out of the request before the lookup.
+    auto path = std::string{paths[i++ % paths.size()]};
+    benchmark::DoNotOptimize(handlers.find(path));
+  }
+}
+
+auto BM_RouterStatic(benchmark::State& state) {
+  const auto paths = staticPaths(static_cast<std::size_t>(state.range(0)));
+  auto router = HttpRouter{};
+  for (const auto& path : paths) {
+    router.add(HttpRequest::GET, path, handler);
+  }
+
+  auto params = fz::http::HttpFields{};
+  auto counter = AllocationCounter{state};
+  std::size_t i = 0;
+  for (auto _ : state) {
+    params.clear();
+    benchmark::DoNotOptimize(
+        router.match(HttpRequest::GET, paths[i++ % paths.size()], params));
+  }
+}
+
+auto BM_RouterParams(benchmark::State& state) {
+  const auto count = static_cast<std::size_t>(state.range(0));
+  auto router = HttpRouter{};
+  auto paths = std::vector<std::string>{};
+  for (std::size_t i = 0; i < count / 2; ++i) {
+    const auto prefix = "/api/v1/service" + std::to_string(i / 8) +
+                        "/resource" + std::to_string(i % 8);
+    router.add(HttpRequest::GET, prefix + "/:id", handler);
+    router.add(HttpRequest::GET, prefix + "/:id/items/:item", handler);
+    paths.push_back(prefix + "/12345");
+    paths.push_back(prefix + "/12345/items/678");
+  }
+
+  auto params = fz::http::HttpFields{};
+  auto counter = AllocationCounter{state};
+  std::size_t i = 0;
+  for (auto _ : state) {
+    params.clear();
+    benchmark::DoNotOptimize(
+        router.match(HttpRequest::GET, paths[i++ % paths.size()], params));
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_UnorderedMapStatic)->Arg(16)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_RouterStatic)->Arg(16)->Arg(1024)->Arg(4096);
+BENCHMARK(BM_RouterParams)->Arg(16)->Arg(1024)->Arg(4096);
@@ -0,0 +1,240 @@
+// End-to-end throughput of HttpServer over loopback, for every server
+// thread_num and accept mode in a sweep:
+//
+//   fz_http_load [--threads=1,2,4] [--accept=shared,reuseport] [--pin=0]
+//                [--connections=64] [--pipeline=1]
+//                [--requests-per-connection=0] [--client-threads=2]
+//                [--duration=3000] [--warmup=500] [--body=13]
+//                [--port=18080] [--min-rps=0]
+//
+// Durations are in milliseconds. --pin=1 pins the server's loops to CPUs.
+// writes/req is the number of sends per response on the server side, from
+// its metrics.
+// With --requests-per-connection=1 every request opens a connection of its
+// own, which compares how fast the accept modes take new connections:
+//
+//   fz_http_load --accept=shared,reuseport --requests-per-connection=1
+//
+// With --min-rps the exit status is 1 when any run falls below it, so the
+// benchmark can gate a change.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "http/http_server.h"
+#include "load_generator.h"
+
+namespace {
+
+using fz::http::HttpServer;
+using fz::http::bench::LoadGenerator;
+
+struct Options {
+  std::vector<std::size_t> threads;
+  std::vector<HttpServer::AcceptMode> accept{HttpServer::AcceptMode::Shared};
+  bool pin{false};
+  std::size_t body{13};
+  std::uint16_t port{18080};
+  double min_rps{0};
+  LoadGenerator::Options load;
+};
+
+template <typename T>
+auto parseNumber(std::string_view value, T& out) -> bool {
+  const auto [end, error] =
+      std::from_chars(value.data(), value.data() + value.size(), out);
+  return error == std::errc{} && end == value.data() + value.size();
+}
+
+auto parseOptions(int argc, char* argv[], Options& options) -> bool {
+  for (auto i = 1; i < argc; ++i) {
+    const auto arg = std::string_view{argv[i]};
+    const auto eq = arg.find('=');
+    if (!arg.starts_with("--") || eq == std::string_view::npos) {
+      return false;
+    }
+
+    const auto name = arg.substr(2, eq - 2);
+    const auto value = arg.substr(eq + 1);
+    auto ms = std::size_t{0};
+    auto ok = true;
+    if (name == "threads") {
+      options.threads.clear();
+      for (auto list = value; ok && !list.empty();) {
+        const auto comma = std::min(list.find(','), list.size());
+        auto thread_num = std::size_t{0};
+        ok = parseNumber(list.substr(0, comma), thread_num) && 0 < thread_num;
+        options.threads.push_back(thread_num);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+      }
+    } else if (name == "accept") {
+      options.accept.clear();
+      for (auto list = value; ok && !list.empty();) {
+        const auto comma = std::min(list.find(','), list.size());
+        const auto mode = list.substr(0, comma);
+        ok = mode == "shared" || mode == "reuseport";
+        options.accept.push_back(mode == "reuseport"
+                                     ? HttpServer::AcceptMode::ReusePort
+                                     : HttpServer::AcceptMode::Shared);
+        list.remove_prefix(std::min(comma + 1, list.size()));
+      }
+    } else if (name == "pin") {
+      auto pin = 0;
+      ok = parseNumber(value, pin);
+      options.pin = pin != 0;
+    } else if (name == "requests-per-connection") {
+      ok = parseNumber(value, options.load.requests_per_connection);
+    } else if (name == "connections") {
+      ok = parseNumber(value, options.load.connections);
+    } else if (name == "pipeline") {
+      ok = parseNumber(value, options.load.pipeline);
+    } else if (name == "client-threads") {
+      ok = parseNumber(value, options.load.threads);
+    } else if (name == "duration") {
+      ok = parseNumber(value, ms);
+      options.load.duration = std::chrono::milliseconds{ms};
+    } else if (name == "warmup") {
+      ok = parseNumber(value, ms);
+      options.load.warmup = std::chrono::milliseconds{ms};
+    } else if (name == "body") {
+      ok = parseNumber(value, options.body);
+    } else if (name == "port") {
+      ok = parseNumber(value, options.port);
+    } else if (name == "min-rps") {
+      options.min_rps = std::strtod(std::string{value}.c_str(), nullptr);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      return false;
+    }
+  }
+  return 0 < options.load.connections && 0 < options.load.pipeline &&
+         !options.accept.empty();
+}
+
+/**
+ * @brief Powers of two up to the core count, and the core count itself.
+ */
+auto defaultThreads() -> std::vector<std::size_t> {
+  const auto cores =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  auto threads = std::vector<std::size_t>{};
+  for (std::size_t n = 1; n < cores; n *= 2) {
+    threads.push_back(n);
+  }
+  threads.push_back(cores);
+  return threads;
+}
+
+auto toMicros(std::chrono::nanoseconds latency) -> double {
+  return std::chrono::duration<double, std::micro>(latency).count();
+}
+
+/**
+ * @brief Sends per response the server made, warmup included.
+ */
+auto writesPerResponse(const fz::http::HttpMetrics& metrics) -> double {
+  const auto snapshot = metrics.snapshot();
+  auto responses = std::uint64_t{0};
+  for (const auto& [pattern, route] : snapshot.routes) {
+    for (const auto& [status, count] : route.statuses) {
+      responses += count;
+    }
+  }
+  return responses == 0 ? 0
+                        : static_cast<double>(snapshot.writes) /
+                              static_cast<double>(responses);
+}
+
+auto acceptModeToString(HttpServer::AcceptMode mode) -> const char* {
+  return mode == HttpServer::AcceptMode::ReusePort ? "reuseport" : "shared";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  auto options = Options{};
+  if (!parseOptions(argc, argv, options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--threads=1,2,4] [--accept=shared,reuseport] "
+                 "[--pin=0|1] [--connections=N] [--pipeline=N] "
+                 "[--requests-per-connection=N] [--client-threads=N] "
+                 "[--duration=MS] [--warmup=MS] [--body=BYTES] "
+                 "[--port=PORT] [--min-rps=RPS]\n",
+                 argv[0]);
+    return 2;
+  }
+  if (options.threads.empty()) {
+    options.threads = defaultThreads();
+  }
+
+  const auto body = std::string(options.body, 'x');
+  std::printf(
+      "connections=%zu pipeline=%zu requests_per_connection=%zu "
+      "client_threads=%zu body=%zu pin=%d\n",
+      options.load.connections, options.load.pipeline,
+      options.load.requests_per_connection, options.load.threads,
+      options.body, options.pin ? 1 : 0);
+  std::printf("%8s %10s %12s %10s %10s %10s %10s %10s %10s %8s\n",
+              "threads", "accept", "rps", "conn/s", "writes/req", "p50(us)",
+              "p99(us)", "p999(us)", "max(us)", "errors");
+
+  auto passed = true;
+  auto run = std::size_t{0};
+  for (const auto thread_num : options.threads) {
+    for (const auto accept : options.accept) {
+      // A fresh port per run, so a previous server's sockets in TIME_WAIT
+      // don't get in the way.
+      options.load.port = static_cast<std::uint16_t>(options.port + run++);
+      auto server =
+          HttpServer{thread_num, options.load.ip, options.load.port};
+      server.setAcceptMode(accept);
+      server.enableMetrics("");
+      if (options.pin) {
+        server.pinThreads();
+      }
+      server.registerHandler(fz::http::HttpRequest::GET, "/",
+                             [&body](const auto&) {
+                               auto response =
+                                   fz::http::HttpResponse::makeOk();
+                               response.addHeader("Content-Type",
+                                                  "text/plain");
+                               response.setBody(body);
+                               return response;
+                             });
+      server.start();
+
+      try {
+        const auto result = LoadGenerator::run(options.load);
+        std::printf(
+            "%8zu %10s %12.0f %10.0f %10.2f %10.1f %10.1f %10.1f %10.1f "
+            "%8llu\n",
+            thread_num, acceptModeToString(accept), result.rps(),
+            result.cps(), writesPerResponse(*server.metrics()),
+            toMicros(result.latency.quantile(0.5)),
+            toMicros(result.latency.quantile(0.99)),
+            toMicros(result.latency.quantile(0.999)),
+            toMicros(result.latency.quantile(1)),
+            static_cast<unsigned long long>(result.errors));
+        passed = passed && options.min_rps <= result.rps();
+      } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        passed = false;
+      }
+      std::fflush(stdout);
+      server.stop();
+    }
+  }
+
+  return passed ? 0 : 1;
+}
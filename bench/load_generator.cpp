@@ -0,0 +1,438 @@
+#include "load_generator.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace fz::http::bench {
+
+auto LatencyHistogram::record(std::chrono::nanoseconds latency) -> void {
+  const auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(
+      latency.count(), 0));
+  ++_buckets[bucketOf(value)];
+  ++_count;
+}
+
+auto LatencyHistogram::merge(const LatencyHistogram& other) -> void {
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    _buckets[i] += other._buckets[i];
+  }
+  _count += other._count;
+}
+
+auto LatencyHistogram::quantile(double q) const -> std::chrono::nanoseconds {
+  if (_count == 0) {
+    return {};
+  }
+
+  const auto rank = static_cast<std::uint64_t>(
+      std::clamp(q, 0.0, 1.0) * static_cast<double>(_count - 1));
+  auto seen = std::uint64_t{0};
+  for (std::size_t i = 0; i < BUCKETS; ++i) {
+    seen += _buckets[i];
+    if (rank < seen) {
+      return std::chrono::nanoseconds{
+          static_cast<std::int64_t>(upperBoundOf(i))};
+    }
+  }
+  return std::chrono::nanoseconds::max();
+}
+
+auto LatencyHistogram::bucketOf(std::uint64_t value) -> std::size_t {
+  if (value < SUB_BUCKETS) {
+    return static_cast<std::size_t>(value);
+  }
+
+  // The SUB_BITS bits below the leading one pick the bucket within its
+  // power of two.
+  const auto shift = std::bit_width(value) - 1 - SUB_BITS;
+  const auto sub = (value >> shift) - SUB_BUCKETS;
+  return SUB_BUCKETS * (static_cast<std::size_t>(shift) + 1) +
+         static_cast<std::size_t>(sub);
+}
+
+auto LatencyHistogram::upperBoundOf(std::size_t bucket) -> std::uint64_t {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+
+  const auto shift = bucket / SUB_BUCKETS - 1;
+  const auto sub = bucket % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub) << shift) + ((std::uint64_t{1} << shift) - 1);
+}
+
+namespace {
+
+using Clock = LoadGenerator::Clock;
+
+auto toLower(char c) -> char {
+  return 'A' <= c && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+auto startsWithIgnoreCase(std::string_view data, std::string_view prefix)
+    -> bool {
+  return prefix.size() <= data.size() &&
+         std::equal(prefix.begin(), prefix.end(), data.begin(),
+                    [](char a, char b) { return toLower(a) == toLower(b); });
+}
+
+/**
+ * @brief Size of the first response in data, 0 while it's incomplete.
+ * Handles Content-Length and chunked bodies, which is all HttpServer sends.
+ */
+auto responseSize(std::string_view data, bool& ok) -> std::size_t {
+  const auto head_end = data.find("\r\n\r\n");
+  if (head_end == std::string_view::npos) {
+    return 0;
+  }
+
+  const auto head = data.substr(0, head_end + 2);
+  ok = head.starts_with("HTTP/1.1 200 ") || head.starts_with("HTTP/1.0 200 ");
+
+  auto content_length = std::size_t{0};
+  auto chunked = false;
+  for (auto line_start = head.find("\r\n") + 2; line_start < head.size();) {
+    const auto line_end = head.find("\r\n", line_start);
+    const auto line = head.substr(line_start, line_end - line_start);
+    if (startsWithIgnoreCase(line, "content-length:")) {
+      auto value = line.substr(15);
+      while (!value.empty() && value.front() == ' ') {
+        value.remove_prefix(1);
+      }
+      std::from_chars(value.data(), value.data() + value.size(),
+                      content_length);
+    } else if (startsWithIgnoreCase(line, "transfer-encoding:") &&
+               line.find("chunked") != std::string_view::npos) {
+      chunked = true;
+    }
+    line_start = line_end + 2;
+  }
+
+  const auto body_start = head_end + 4;
+  if (chunked) {
+    // Good enough for a benchmark: the server sends no trailers.
+    const auto end = data.find("\r\n0\r\n\r\n", body_start - 2);
+    return end == std::string_view::npos ? 0 : end + 7;
+  }
+  return body_start + content_length <= data.size()
+             ? body_start + content_length
+             : 0;
+}
+
+auto connectTo(const LoadGenerator::Options& options) -> int {
+  auto address = sockaddr_in{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(options.port);
+  if (inet_pton(AF_INET, options.ip.c_str(), &address.sin_addr) != 1) {
+    throw std::runtime_error{"invalid address " + options.ip};
+  }
+
+  const auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+
+  const auto one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+struct Connection {
+  int fd{-1};
+  std::string input;
+  std::string output;
+  std::size_t output_pos{0};
+  std::deque<Clock::time_point> sent;
+  std::size_t requested{0};
+  std::size_t answered{0};
+  bool writing{false};
+};
+
+/**
+ * @brief One client thread and the connections it drives.
+ */
+class Worker {
+ public:
+  Worker(const LoadGenerator::Options& options, std::size_t connections)
+      : _options{options}, _epoll{::epoll_create1(EPOLL_CLOEXEC)} {
+    _connections.resize(connections);
+  }
+
+  Worker(const Worker&) = delete;
+
+  auto operator=(const Worker&) -> Worker& = delete;
+
+  ~Worker() {
+    for (auto& connection : _connections) {
+      if (connection.fd >= 0) {
+        ::close(connection.fd);
+      }
+    }
+    ::close(_epoll);
+  }
+
+  auto result() const -> const LoadGenerator::Result& { return _result; }
+
+  auto run(Clock::time_point measure_from, Clock::time_point stop_at)
+      -> void {
+    _measure_from = measure_from;
+    _stop_at = stop_at;
+    for (std::size_t i = 0; i < _connections.size(); ++i) {
+      open(i);
+    }
+
+    auto events = std::array<epoll_event, 256>{};
+    while (Clock::now() < _stop_at) {
+      const auto n = ::epoll_wait(_epoll, events.data(),
+                                  static_cast<int>(events.size()), 10);
+      for (auto i = 0; i < n; ++i) {
+        const auto index = static_cast<std::size_t>(events[i].data.u64);
+        if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
+          reopen(index);
+          continue;
+        }
+        if ((events[i].events & EPOLLOUT) != 0 && !flush(index)) {
+          continue;
+        }
+        if ((events[i].events & EPOLLIN) != 0) {
+          read(index);
+        }
+      }
+    }
+    _result.elapsed = _stop_at - _measure_from;
+  }
+
+ private:
+  auto open(std::size_t index) -> void {
+    auto& connection = _connections[index];
+    connection = Connection{};
+    connection.fd = connectTo(_options);
+    if (connection.fd < 0) {
+      ++_result.errors;
+      return;
+    }
+
+    auto event = epoll_event{};
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    ::epoll_ctl(_epoll, EPOLL_CTL_ADD, connection.fd, &event);
+    send(index, _options.pipeline);
+  }
+
+  auto reopen(std::size_t index) -> void {
+    auto& connection = _connections[index];
+    if (connection.fd >= 0) {
+      ::epoll_ctl(_epoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+      ::close(connection.fd);
+    }
+    ++_result.errors;
+    open(index);
+  }
+
+  /**
+   * @brief Close a connection that got all its responses and open the next
+   * one. The reset skips TIME_WAIT, which would run out of ports.
+   */
+  auto recycle(std::size_t index) -> void {
+    auto& connection = _connections[index];
+    const auto linger = ::linger{.l_onoff = 1, .l_linger = 0};
+    ::setsockopt(connection.fd, SOL_SOCKET, SO_LINGER, &linger,
+                 sizeof(linger));
+    ::epoll_ctl(_epoll, EPOLL_CTL_DEL, connection.fd, nullptr);
+    ::close(connection.fd);
+    if (const auto now = Clock::now(); _measure_from <= now && now < _stop_at) {
+      ++_result.connections;
+    }
+    open(index);
+  }
+
+  auto send(std::size_t index, std::size_t count) -> void {
+    auto& connection = _connections[index];
+    if (const auto limit = _options.requests_per_connection; 0 < limit) {
+      count = std::min(count, limit - connection.requested);
+    }
+    connection.requested += count;
+    const auto now = Clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+      connection.output += _options.request;
+      connection.sent.push_back(now);
+    }
+    flush(index);
+  }
+
+  /**
+   * @brief Write what's pending, watching for EPOLLOUT only while the
+   * socket is full. False if the connection had to be reopened.
+   */
+  auto flush(std::size_t index) -> bool {
+    auto& connection = _connections[index];
+    while (connection.output_pos < connection.output.size()) {
+      const auto n = ::write(
+          connection.fd, connection.output.data() + connection.output_pos,
+          connection.output.size() - connection.output_pos);
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          break;
+        }
+        reopen(index);
+        return false;
+      }
+      connection.output_pos += static_cast<std::size_t>(n);
+    }
+
+    if (connection.output_pos == connection.output.size()) {
+      connection.output.clear();
+      connection.output_pos = 0;
+    }
+
+    const auto writing = !connection.output.empty();
+    if (writing != connection.writing) {
+      connection.writing = writing;
+      auto event = epoll_event{};
+      event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+      event.data.u64 = index;
+      ::epoll_ctl(_epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+    return true;
+  }
+
+  auto read(std::size_t index) -> void {
+    auto& connection = _connections[index];
+    auto chunk = std::array<char, 64 * 1024>{};
+    while (true) {
+      const auto n = ::read(connection.fd, chunk.data(), chunk.size());
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        reopen(index);
+        return;
+      }
+      if (n < 0) {
+        break;
+      }
+      connection.input.append(chunk.data(), static_cast<std::size_t>(n));
+    }
+
+    const auto now = Clock::now();
+    auto consumed = std::size_t{0};
+    auto completed = std::size_t{0};
+    while (!connection.sent.empty()) {
+      auto ok = false;
+      const auto size = responseSize(
+          std::string_view{connection.input}.substr(consumed), ok);
+      if (size == 0) {
+        break;
+      }
+
+      consumed += size;
+      ++completed;
+      if (_measure_from <= now && now < _stop_at) {
+        if (ok) {
+          ++_result.responses;
+          _result.latency.record(now - connection.sent.front());
+        } else {
+          ++_result.errors;
+        }
+      }
+      connection.sent.pop_front();
+    }
+
+    connection.input.erase(0, consumed);
+    connection.answered += completed;
+    if (0 < _options.requests_per_connection &&
+        connection.answered == _options.requests_per_connection) {
+      recycle(index);
+    } else if (0 < completed) {
+      send(index, completed);
+    }
+  }
+
+  const LoadGenerator::Options& _options;
+  int _epoll;
+  std::vector<Connection> _connections;
+  Clock::time_point _measure_from;
+  Clock::time_point _stop_at;
+  LoadGenerator::Result _result;
+};
+
+/**
+ * @brief Wait for the server to accept connections.
+ */
+auto waitForServer(const LoadGenerator::Options& options,
+                   std::chrono::milliseconds timeout) -> void {
+  const auto deadline = Clock::now() + timeout;
+  while (true) {
+    if (const auto fd = connectTo(options); fd >= 0) {
+      ::close(fd);
+      return;
+    }
+    if (deadline <= Clock::now()) {
+      throw std::runtime_error{"server at " + options.ip + ":" +
+                               std::to_string(options.port) +
+                               " isn't accepting connections"};
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+}
+
+}  // namespace
+
+auto LoadGenerator::run(const Options& options,
+                        std::chrono::milliseconds connect_timeout)
+    -> Result {
+  waitForServer(options, connect_timeout);
+
+  const auto thread_num =
+      std::clamp<std::size_t>(options.threads, 1, options.connections);
+  auto workers = std::vector<std::unique_ptr<Worker>>{};
+  for (std::size_t i = 0; i < thread_num; ++i) {
+    const auto connections = options.connections / thread_num +
+                             (i < options.connections % thread_num ? 1 : 0);
+    workers.push_back(std::make_unique<Worker>(options, connections));
+  }
+
+  const auto measure_from = Clock::now() + options.warmup;
+  const auto stop_at = measure_from + options.duration;
+  auto threads = std::vector<std::thread>{};
+  for (auto& worker : workers) {
+    threads.emplace_back([&worker, measure_from, stop_at] {
+      worker->run(measure_from, stop_at);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto result = Result{};
+  result.elapsed = stop_at - measure_from;
+  for (const auto& worker : workers) {
+    result.responses += worker->result().responses;
+    result.errors += worker->result().errors;
+    result.connections += worker->result().connections;
+    result.latency.merge(worker->result().latency);
+  }
+  return result;
+}
+
+}  // namespace fz::http::bench
@@ -0,0 +1,106 @@
+#ifndef __FZ_HTTP_BENCH_LOAD_GENERATOR_H__
+#define __FZ_HTTP_BENCH_LOAD_GENERATOR_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fz::http::bench {
+
+/**
+ * @brief Log-linear latency histogram: exact below 32 ns, then every power
+ * of two is split into 32 buckets, so a percentile is off by at most ~3%
+ * whatever the range of the values. Recording is O(1) and allocation free.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram() : _buckets(BUCKETS, 0) {}
+
+  auto record(std::chrono::nanoseconds latency) -> void;
+
+  auto merge(const LatencyHistogram& other) -> void;
+
+  auto count() const { return _count; }
+
+  /**
+   * @brief Upper bound of the bucket holding the q-quantile, q in [0, 1].
+   */
+  auto quantile(double q) const -> std::chrono::nanoseconds;
+
+ private:
+  constexpr static auto SUB_BITS = 5;
+  constexpr static auto SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+  constexpr static auto BUCKETS = SUB_BUCKETS * (64 - SUB_BITS + 1);
+
+  static auto bucketOf(std::uint64_t value) -> std::size_t;
+
+  static auto upperBoundOf(std::size_t bucket) -> std::uint64_t;
+
+  std::vector<std::uint64_t> _buckets;
+  std::uint64_t _count{0};
+};
+
+/**
+ * @brief Closed loop HTTP/1.1 load over loopback: every connection keeps
+ * Options::pipeline requests in flight and sends the next one as soon as a
+ * response arrives. Latency is measured from writing a request to reading
+ * the end of its response, responses during the warmup are not counted.
+ *
+ * With Options::requests_per_connection a connection is closed after that
+ * many responses and a new one opened in its place, which measures the
+ * rate the server accepts connections at. Those closes reset the
+ * connection, so the client's ports don't pile up in TIME_WAIT.
+ *
+ * Each client thread drives its share of the connections with its own
+ * epoll instance. Connections the server closes are reopened and counted
+ * as errors, as are responses other than 200. Linux only.
+ */
+class LoadGenerator {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    std::string ip{"127.0.0.1"};
+    std::uint16_t port{8080};
+    std::string request{"GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"};
+    std::size_t connections{64};
+    std::size_t pipeline{1};
+    // Zero keeps every connection open for the whole run.
+    std::size_t requests_per_connection{0};
+    std::size_t threads{2};
+    std::chrono::milliseconds warmup{500};
+    std::chrono::milliseconds duration{3000};
+  };
+
+  struct Result {
+    std::uint64_t responses{0};
+    std::uint64_t errors{0};
+    // Connections completed with requests_per_connection responses.
+    std::uint64_t connections{0};
+    Clock::duration elapsed{};
+    LatencyHistogram latency;
+
+    auto rps() const -> double { return perSecond(responses); }
+
+    auto cps() const -> double { return perSecond(connections); }
+
+    auto perSecond(std::uint64_t count) const -> double {
+      const auto seconds = std::chrono::duration<double>(elapsed).count();
+      return seconds <= 0 ? 0 : static_cast<double>(count) / seconds;
+    }
+  };
+
+  /**
+   * @brief Connect to the server, waiting up to connect_timeout for it to
+   * listen, then run the load. Throws std::runtime_error if it never does.
+   */
+  static auto run(const Options& options,
+                  std::chrono::milliseconds connect_timeout =
+                      std::chrono::seconds{5}) -> Result;
+};
+
+}  // namespace fz::http::bench
+
+#endif  // __FZ_HTTP_BENCH_LOAD_GENERATOR_H__
@@ -0,0 +1,140 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <llhttp.h>
+
+#include "parsed_requests.h"
+
+namespace {
+
+using fz::http::HttpRequestParse;
+using fz::http::fuzz::Fields;
+using fz::http::fuzz::ParsedRequest;
+using fz::http::fuzz::parseRequests;
+
+auto trim(std::string value) -> std::string {
+  const auto begin = value.find_first_not_of(" \t");
+  if (begin == std::string::npos) {
+    return {};
+  }
+  return value.substr(begin, value.find_last_not_of(" \t") - begin + 1);
+}
+
+/**
+ * @brief The first request as llhttp sees it, collected from its callbacks.
+ * Callbacks may hand over a field in several spans.
+ */
+struct Reference {
+  std::string url;
+  Fields headers;
+  Fields trailers;
+  std::string field;
+  std::string value;
+  std::string body;
+  bool headers_done{false};
+  bool complete{false};
+
+  static auto self(llhttp_t* parser) -> Reference& {
+    return *static_cast<Reference*>(parser->data);
+  }
+
+  static auto settings() -> llhttp_settings_t {
+    auto settings = llhttp_settings_t{};
+    llhttp_settings_init(&settings);
+    settings.on_url = [](llhttp_t* parser, const char* at, std::size_t size) {
+      self(parser).url.append(at, size);
+      return 0;
+    };
+    settings.on_header_field = [](llhttp_t* parser, const char* at,
+                                  std::size_t size) {
+      self(parser).field.append(at, size);
+      return 0;
+    };
+    settings.on_header_value = [](llhttp_t* parser, const char* at,
+                                  std::size_t size) {
+      self(parser).value.append(at, size);
+      return 0;
+    };
+    settings.on_header_value_complete = [](llhttp_t* parser) {
+      auto& reference = self(parser);
+      auto& fields =
+          reference.headers_done ? reference.trailers : reference.headers;
+      fields.emplace_back(std::move(reference.field),
+                          trim(std::move(reference.value)));
+      reference.field.clear();
+      reference.value.clear();
+      return 0;
+    };
+    settings.on_headers_complete = [](llhttp_t* parser) {
+      self(parser).headers_done = true;
+      return 0;
+    };
+    settings.on_body = [](llhttp_t* parser, const char* at,
+                          std::size_t size) {
+      self(parser).body.append(at, size);
+      return 0;
+    };
+    // Stop after the first request, the rest is compared by the other
+    // target.
+    settings.on_message_complete = [](llhttp_t* parser) {
+      self(parser).complete = true;
+      return static_cast<int>(HPE_PAUSED);
+    };
+    return settings;
+  }
+};
+
+}  // namespace
+
+/**
+ * Same input layout as fuzz_http_request_parse, so the two share a corpus;
+ * the split and flag bytes aren't used here.
+ *
+ * When both parsers take a complete first request from the input, it must
+ * be the same request. With FZ_HTTP_FUZZ_STRICT set in the environment, a
+ * request that HttpRequestParse takes and llhttp doesn't is reported too:
+ * a server that frames a request differently from the proxies in front of
+ * it is open to request smuggling.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size) {
+  static const auto strict = std::getenv("FZ_HTTP_FUZZ_STRICT") != nullptr;
+  static const auto settings = Reference::settings();
+
+  if (size < 3) {
+    return 0;
+  }
+  const auto input =
+      std::string_view{reinterpret_cast<const char*>(data + 3), size - 3};
+
+  const auto ours = parseRequests(input, HttpRequestParse::Limits{}, false);
+
+  auto reference = Reference{};
+  auto parser = llhttp_t{};
+  llhttp_init(&parser, HTTP_REQUEST, &settings);
+  parser.data = &reference;
+  llhttp_execute(&parser, input.data(), input.size());
+
+  if (ours.requests.empty() || !reference.complete) {
+    FZ_HTTP_FUZZ_CHECK(!strict || ours.requests.empty());
+    return 0;
+  }
+
+  auto expected = ours.requests.front();
+  expected.querys.clear();
+  auto actual = ParsedRequest{
+      llhttp_method_name(static_cast<llhttp_method_t>(parser.method)),
+      reference.url.substr(0, reference.url.find('?')),
+      "HTTP/" + std::to_string(parser.http_major) + "." +
+          std::to_string(parser.http_minor),
+      {},
+      std::move(reference.headers),
+      std::move(reference.trailers),
+      std::move(reference.body)};
+  FZ_HTTP_FUZZ_CHECK(actual == expected);
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "parsed_requests.h"
+
+namespace {
+
+using fz::http::HttpRequest;
+using fz::http::HttpRequestParse;
+using fz::http::fuzz::ParsedRequest;
+using fz::http::fuzz::parseRequests;
+
+/**
+ * @brief xorshift32, so the split points follow from the input alone and a
+ * crash replays the same way.
+ */
+class Splits {
+ public:
+  explicit Splits(std::uint32_t seed) : _state{seed | 1} {}
+
+  // Mostly short pieces, down to single bytes, where the parser has to keep
+  // its position between calls; sometimes everything that is left.
+  auto operator()(std::size_t remaining) -> std::size_t {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state % 8 == 0 ? remaining : 1 + _state % 16;
+  }
+
+ private:
+  std::uint32_t _state;
+};
+
+}  // namespace
+
+/**
+ * Input: two bytes that pick the split points, one byte of flags, then the
+ * bytes of the connection.
+ *
+ * Checks that, for the same bytes:
+ * - HttpRequestParse::run() finds the same requests and ends in the same
+ *   state whether the bytes arrive at once or in arbitrary pieces,
+ * - a streamed body is the body that would have been buffered,
+ * - HttpRequest::parse() agrees with run() on the head of the first request.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size) {
+  if (size < 3) {
+    return 0;
+  }
+  const auto seed = static_cast<std::uint32_t>(data[0] | data[1] << 8);
+  const auto flags = data[2];
+  const auto input =
+      std::string_view{reinterpret_cast<const char*>(data + 3), size - 3};
+
+  // Small limits let short inputs reach the size checks too.
+  auto limits = HttpRequestParse::Limits{};
+  if (flags & 1) {
+    limits = {.max_headers_size = 64, .max_body_size = 16};
+  }
+  const auto stream = (flags & 2) != 0;
+
+  const auto whole = parseRequests(input, limits, stream);
+  const auto pieces = parseRequests(input, limits, stream, Splits{seed});
+  FZ_HTTP_FUZZ_CHECK(whole == pieces);
+
+  // Streamed bodies aren't limited, so only compare when nothing was too
+  // large to buffer. A streamed body is taken as it arrives, the bytes left
+  // in the buffer differ.
+  if (stream) {
+    const auto buffered = parseRequests(input, limits, false);
+    if (buffered.error != HttpRequestParse::Error::BodyTooLarge) {
+      FZ_HTTP_FUZZ_CHECK(whole.requests == buffered.requests);
+      FZ_HTTP_FUZZ_CHECK(whole.status == buffered.status);
+    }
+  }
+
+  // parse() takes a single request without framing or limits, so it has to
+  // accept every head run() accepted, the same way.
+  auto request = HttpRequest{};
+  const auto parsed = request.parse(input);
+  if (!whole.requests.empty()) {
+    FZ_HTTP_FUZZ_CHECK(parsed);
+    auto head = ParsedRequest::from(request, {});
+    auto first = whole.requests.front();
+    first.trailers.clear();
+    first.body.clear();
+    FZ_HTTP_FUZZ_CHECK(head == first);
+  }
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef __FZ_HTTP_FUZZ_PARSED_REQUESTS_H__
+#define __FZ_HTTP_FUZZ_PARSED_REQUESTS_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http/http_request.h"
+#include "http/http_request_parse.h"
+#include "net/common/buffer.h"
+
+// Unlike assert(), also checked in builds with NDEBUG.
+#define FZ_HTTP_FUZZ_CHECK(condition)                                  \
+  ((condition) ? void(0)                                               \
+               : fz::http::fuzz::fail(#condition, __FILE__, __LINE__))
+
+namespace fz::http::fuzz {
+
+[[noreturn]] inline auto fail(const char* condition, const char* file,
+                              int line) -> void {
+  std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+  std::abort();
+}
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief An owning copy of what the parser made of one request, so results
+ * of separate runs can be compared after their buffers are gone.
+ */
+struct ParsedRequest {
+  std::string method;
+  std::string path;
+  std::string version;
+  Fields querys;
+  Fields headers;
+  Fields trailers;
+  std::string body;
+
+  auto operator==(const ParsedRequest&) const -> bool = default;
+
+  static auto fields(const HttpFields& fields) -> Fields {
+    auto copy = Fields{};
+    for (const auto& [key, value] : fields) {
+      copy.emplace_back(key, value);
+    }
+    return copy;
+  }
+
+  static auto from(const HttpRequest& request, std::string_view body)
+      -> ParsedRequest {
+    return {std::string{HttpRequest::methodToString(request.method())},
+            std::string{request.path()},
+            std::string{HttpRequest::versionToString(request.version())},
+            fields(request.querys()),
+            fields(request.headers()),
+            fields(request.trailers()),
+            std::string{body}};
+  }
+};
+
+/**
+ * @brief Every request HttpRequestParse found in the input, and where it
+ * stopped: the status and error after the last byte, and the bytes it left
+ * in the buffer (none once it gave up).
+ */
+struct ParsedRequests {
+  std::vector<ParsedRequest> requests;
+  HttpRequestParse::Status status{HttpRequestParse::Status::RequestLine};
+  HttpRequestParse::Error error{HttpRequestParse::Error::None};
+  std::size_t left{0};
+
+  auto operator==(const ParsedRequests&) const -> bool = default;
+};
+
+/**
+ * @brief Feed input to a parser in pieces, next_size(remaining) giving the
+ * size of each, resetting the parser after every complete request like a
+ * connection does. With stream, bodies go through streamBody() instead of
+ * being buffered.
+ */
+template <typename NextSize>
+auto parseRequests(std::string_view input,
+                   const HttpRequestParse::Limits& limits, bool stream,
+                   NextSize&& next_size) -> ParsedRequests {
+  auto parse = HttpRequestParse{};
+  parse.setLimits(limits);
+  auto buffer = net::Buffer{};
+  auto result = ParsedRequests{};
+  auto body = std::string{};
+
+  const auto on_headers = [&](HttpRequest&) {
+    if (stream) {
+      parse.streamBody([&body](std::string_view data) {
+        body.append(data);
+        return true;
+      });
+    }
+  };
+
+  while (!input.empty() &&
+         parse.status() != HttpRequestParse::Status::INVALID) {
+    const auto size = std::min(input.size(), next_size(input.size()));
+    buffer.append(input.substr(0, size));
+    input.remove_prefix(size);
+
+    parse.run(buffer, on_headers);
+    while (parse.status() == HttpRequestParse::Status::OK) {
+      result.requests.push_back(ParsedRequest::from(
+          parse.request(), stream ? body : parse.request().body()));
+      body.clear();
+      parse.reset();
+      parse.run(buffer, on_headers);
+    }
+  }
+
+  result.status = parse.status();
+  result.error = parse.error();
+  // An invalid request ends the connection, what follows it is never read.
+  result.left = result.status == HttpRequestParse::Status::INVALID
+                    ? 0
+                    : buffer.readableBytes();
+  return result;
+}
+
+inline auto parseRequests(std::string_view input,
+                          const HttpRequestParse::Limits& limits, bool stream)
+    -> ParsedRequests {
+  return parseRequests(input, limits, stream,
+                       [](std::size_t remaining) { return remaining; });
+}
+
+}  // namespace fz::http::fuzz
+
+#endif  // __FZ_HTTP_FUZZ_PARSED_REQUESTS_H__
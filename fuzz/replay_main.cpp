@@ -0,0 +1,47 @@
+// Stands in for libFuzzer with compilers that don't have it: runs the target
+// once on every file given, or on every file in a directory given, e.g. to
+// replay a corpus or a crash found elsewhere.
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data,
+                                      std::size_t size);
+
+namespace {
+
+auto runFile(const std::filesystem::path& path) -> void {
+  auto file = std::ifstream{path, std::ios::binary};
+  const auto data = std::vector<char>{std::istreambuf_iterator<char>{file},
+                                      std::istreambuf_iterator<char>{}};
+  LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(data.data()),
+                         data.size());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  auto runs = std::size_t{0};
+  for (auto i = 1; i < argc; ++i) {
+    const auto path = std::filesystem::path{argv[i]};
+    if (!std::filesystem::is_directory(path)) {
+      runFile(path);
+      ++runs;
+      continue;
+    }
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator{path}) {
+      if (entry.is_regular_file()) {
+        runFile(entry.path());
+        ++runs;
+      }
+    }
+  }
+  std::cout << "Ran " << runs << " inputs\n";
+}
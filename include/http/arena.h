@@ -0,0 +1,99 @@
+#ifndef __FZ_HTTP_ARENA_H__
+#define __FZ_HTTP_ARENA_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief Bump allocator for per-request storage. reset() rewinds to the first
+ * block and keeps the blocks around, so a connection that serves requests of
+ * a similar size stops allocating after the first few requests.
+ */
+class Arena {
+ public:
+  constexpr static std::size_t DEFAULT_BLOCK_SIZE = 4096;
+
+  explicit Arena(std::size_t block_size = DEFAULT_BLOCK_SIZE)
+      : _block_size{block_size} {}
+
+  Arena(const Arena&) = delete;
+
+  Arena(Arena&&) noexcept = default;
+
+  auto operator=(const Arena&) -> Arena& = delete;
+
+  auto operator=(Arena&&) noexcept -> Arena& = default;
+
+  ~Arena() = default;
+
+  auto allocate(std::size_t size) -> char* {
+    while (_index < _blocks.size()) {
+      auto& block = _blocks[_index];
+      if (size <= block.size - _offset) {
+        auto* ptr = block.data.get() + _offset;
+        _offset += size;
+        return ptr;
+      }
+
+      ++_index;
+      _offset = 0;
+    }
+
+    auto block_size = std::max(size, _block_size);
+    _blocks.push_back({std::make_unique<char[]>(block_size), block_size});
+    _offset = size;
+    return _blocks.back().data.get();
+  }
+
+  /**
+   * @brief Copy data into the arena and return a view of the copy.
+   */
+  auto store(std::string_view data) -> std::string_view {
+    if (data.empty()) {
+      return {};
+    }
+
+    auto* ptr = allocate(data.size());
+    std::memcpy(ptr, data.data(), data.size());
+    return {ptr, data.size()};
+  }
+
+  auto reset() -> void {
+    // Oversized blocks come from unusually large requests, don't let one of
+    // them pin its memory for the lifetime of the connection.
+    std::erase_if(_blocks, [this](const auto& block) {
+      return _block_size < block.size;
+    });
+    _index = 0;
+    _offset = 0;
+  }
+
+  auto capacity() const {
+    std::size_t capacity = 0;
+    for (const auto& block : _blocks) {
+      capacity += block.size;
+    }
+    return capacity;
+  }
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    std::size_t size;
+  };
+
+  std::size_t _block_size;
+  std::vector<Block> _blocks;
+  std::size_t _index{0};
+  std::size_t _offset{0};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_ARENA_H__
@@ -0,0 +1,120 @@
+#ifndef __FZ_HTTP_HTTP_CHUNKED_WRITER_H__
+#define __FZ_HTTP_HTTP_CHUNKED_WRITER_H__
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http/type_define.h"
+
+namespace fz::http {
+
+/**
+ * @brief Encodes a body with "Transfer-Encoding: chunked". Each write()
+ * becomes one chunk appended to the output, so a handler can emit a large
+ * body piece by piece instead of building it in memory first.
+ */
+class HttpChunkedWriter {
+ public:
+  /**
+   * @brief out can be anything with append(const char*, std::size_t) and
+   * must outlive the writer.
+   */
+  template <typename Output>
+  explicit HttpChunkedWriter(Output& out)
+      : _out{&out}, _append{[](void* out, std::string_view data) {
+          static_cast<Output*>(out)->append(data.data(), data.size());
+        }} {}
+
+  struct Unframed {};
+
+  /**
+   * @brief A writer that appends each write() to out as is and writes
+   * nothing on finish(), for a stage that transforms the body (e.g.
+   * compression) before handing it to the real writer.
+   */
+  template <typename Output>
+  HttpChunkedWriter(Output& out, Unframed) : HttpChunkedWriter{out} {
+    _framed = false;
+  }
+
+  auto write(std::string_view data) -> void {
+    // An empty chunk would end the body.
+    if (data.empty() || _finished) {
+      return;
+    }
+
+    if (!_framed) {
+      append(data);
+      _bytes += data.size();
+      return;
+    }
+
+    auto size = std::array<char, sizeof(std::size_t) * 2>{};
+    auto [ptr, ec] =
+        std::to_chars(size.data(), size.data() + size.size(), data.size(), 16);
+    append({size.data(), static_cast<std::size_t>(ptr - size.data())});
+    append(CRLF);
+    append(data);
+    append(CRLF);
+    _bytes += data.size();
+  }
+
+  /**
+   * @brief Add a trailer field, written after the last chunk.
+   */
+  auto addTrailer(std::string_view key, std::string_view value) -> void {
+    _trailers.emplace_back(key, value);
+  }
+
+  /**
+   * @brief Write the last chunk and the trailers. Further writes are ignored.
+   */
+  auto finish() -> void {
+    if (_finished) {
+      return;
+    }
+
+    _finished = true;
+    if (!_framed) {
+      return;
+    }
+
+    append("0");
+    append(CRLF);
+    for (const auto& [key, value] : _trailers) {
+      append(key);
+      append(COLON);
+      append(value);
+      append(CRLF);
+    }
+    append(CRLF);
+  }
+
+  auto finished() const { return _finished; }
+
+  auto& trailers() const { return _trailers; }
+
+  /**
+   * @brief Body bytes written so far, without the chunk framing.
+   */
+  auto bytes() const { return _bytes; }
+
+ private:
+  auto append(std::string_view data) -> void { _append(_out, data); }
+
+  void* _out;
+  void (*_append)(void* out, std::string_view data);
+  std::vector<std::pair<std::string, std::string>> _trailers;
+  std::size_t _bytes{0};
+  bool _finished{false};
+  bool _framed{true};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_CHUNKED_WRITER_H__
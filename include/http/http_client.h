@@ -0,0 +1,329 @@
+#ifndef __FZ_HTTP_HTTP_CLIENT_H__
+#define __FZ_HTTP_HTTP_CLIENT_H__
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "http/http_request.h"
+#include "http/http_response.h"
+#include "http/http_response_parse.h"
+#include "http/timer_wheel.h"
+
+namespace fz::http {
+
+/**
+ * @brief HTTP/1.1 client with a keep-alive connection pool per host.
+ *
+ * Requests can be sent from any thread. Each is serialized right away, so
+ * the HttpRequest only has to stay valid during the call, and queued for
+ * the client's event loop. The loop sends it on an idle connection to the
+ * host if there is one, opens a new one while the pool is below
+ * max_connections_per_host, and otherwise pipelines it behind the requests
+ * in flight on the least busy connection, up to pipeline_depth. Requests
+ * that find every connection full wait for one to free up.
+ *
+ * Completion is reported to a callback, a future or an awaiting coroutine.
+ * Callbacks run on the client's loop thread and must not block it; a
+ * coroutine resumed by fetch() continues there too. To answer a server
+ * request from the result, hand it to an HttpResponder, whose send() can be
+ * called from any thread.
+ *
+ * A request that gets no complete response within request_timeout fails
+ * with Error::Timeout and its connection is closed, since the response
+ * might still arrive; requests pipelined behind it fail with Error::Closed.
+ * Nothing is retried, as a request that was sent may have had an effect.
+ *
+ * stream() sends a request whose body is written piece by piece and hands
+ * over the response body as it arrives, so neither is held in memory as a
+ * whole, e.g. to relay them between connections.
+ */
+class HttpClient {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Error : std::uint8_t {
+    None,
+    // The host didn't resolve or the connection was refused or timed out.
+    Connect,
+    Timeout,
+    // The connection closed before the response was complete.
+    Closed,
+    BadResponse,
+    // The client was destroyed with the request pending.
+    Shutdown
+  };
+
+  constexpr static auto errorToString(Error error) -> std::string_view {
+    switch (error) {
+      case Error::None:
+        return "none";
+      case Error::Connect:
+        return "connect failed";
+      case Error::Timeout:
+        return "timed out";
+      case Error::Closed:
+        return "connection closed";
+      case Error::BadResponse:
+        return "bad response";
+      case Error::Shutdown:
+        return "client shut down";
+    }
+    return "unknown";
+  }
+
+  struct Result {
+    Error error{Error::None};
+    HttpResponse response;
+
+    auto ok() const { return error == Error::None; }
+  };
+
+  using Callback = std::function<void(Result result)>;
+
+  /**
+   * @brief Gets the head of a streamed response and returns the consumer
+   * for its body, see HttpResponseParse::BodyConsumer. An empty consumer
+   * discards the body.
+   */
+  using HeadCallback = std::function<HttpResponseParse::BodyConsumer(
+      const HttpResponse& head)>;
+
+  /**
+   * @brief Body of a request sent with stream(). write() and finish() may be
+   * called from any thread while the client exists.
+   */
+  class RequestBody : public std::enable_shared_from_this<RequestBody> {
+   public:
+    constexpr static auto HIGH_WATER_MARK = std::size_t{256 * 1024};
+
+    /**
+     * @brief Queue data to be sent. Returns false once HIGH_WATER_MARK bytes
+     * or more wait to be sent, the drain callback runs on the client's loop
+     * once they have been.
+     */
+    auto write(std::string_view data) -> bool;
+
+    /**
+     * @brief End the body. Later writes are ignored.
+     */
+    auto finish() -> void;
+
+    /**
+     * @brief Set before the first write.
+     */
+    auto setDrainCallback(std::function<void()> on_drain) -> void {
+      _on_drain = std::move(on_drain);
+    }
+
+   private:
+    friend class HttpClient;
+
+    RequestBody(HttpClient& client, bool chunked)
+        : _client{&client}, _chunked{chunked} {}
+
+    HttpClient* _client;
+    bool _chunked;
+    std::mutex _mutex;
+    std::string _queued;
+    bool _finished{false};
+    std::atomic<std::size_t> _unsent{0};
+    std::atomic<bool> _blocked{false};
+    std::function<void()> _on_drain;
+    // The connection the request went to, only touched by the loop.
+    std::uint64_t _connection{0};
+  };
+
+  struct Options {
+    std::size_t max_connections_per_host{8};
+    // Requests in flight on one connection, 1 disables pipelining.
+    std::size_t pipeline_depth{1};
+    Clock::duration connect_timeout{std::chrono::seconds{5}};
+    // From the moment the request is handed to a connection.
+    Clock::duration request_timeout{std::chrono::seconds{30}};
+    // How long an unused connection stays in the pool.
+    Clock::duration idle_timeout{std::chrono::seconds{60}};
+    HttpResponseParse::Limits limits;
+  };
+
+  /**
+   * @brief co_await client.fetch(...) sends the request and resumes the
+   * coroutine with its Result on the client's loop thread.
+   */
+  class Awaitable {
+   public:
+    auto await_ready() const noexcept { return false; }
+
+    auto await_suspend(std::coroutine_handle<> handle) -> void;
+
+    auto await_resume() -> Result { return std::move(_result); }
+
+   private:
+    friend class HttpClient;
+
+    Awaitable(HttpClient& client, std::string host, std::uint16_t port,
+              std::string data, bool head)
+        : _client{&client},
+          _host{std::move(host)},
+          _port{port},
+          _data{std::move(data)},
+          _head{head} {}
+
+    HttpClient* _client;
+    std::string _host;
+    std::uint16_t _port;
+    std::string _data;
+    bool _head;
+    Result _result;
+  };
+
+  HttpClient() : HttpClient{Options{}} {}
+
+  /**
+   * @brief Start the client's loop thread. Every client runs one, apart
+   * from the server's loops, so the thread count grows with every client:
+   * share one where possible, as HttpProxy does by default.
+   */
+  explicit HttpClient(const Options& options);
+
+  /**
+   * @brief Stop the loop and close every connection. Pending requests fail
+   * with Error::Shutdown. Must not be called from a callback.
+   */
+  ~HttpClient();
+
+  HttpClient(const HttpClient&) = delete;
+
+  auto operator=(const HttpClient&) -> HttpClient& = delete;
+
+  auto& options() const { return _options; }
+
+  /**
+   * @brief Send request to host:port and call callback with the result.
+   *
+   * Host and Content-Length are added unless the request sets them, and a
+   * request without a version is sent as HTTP/1.1. A plain chunked
+   * Transfer-Encoding is dropped since the body is sent whole, but other
+   * codings are the caller's and kept; the body then goes out as one
+   * chunk.
+   */
+  auto request(std::string_view host, std::uint16_t port,
+               const HttpRequest& request, Callback callback) -> void;
+
+  auto request(std::string_view host, std::uint16_t port,
+               const HttpRequest& request) -> std::future<Result>;
+
+  auto fetch(std::string_view host, std::uint16_t port,
+             const HttpRequest& request) -> Awaitable;
+
+  /**
+   * @brief Send the head of request and return the writer for its body. The
+   * body is framed the way the request says: sent as written with
+   * Content-Length, one chunk per write with "Transfer-Encoding: chunked",
+   * and not at all with neither, in which case the writer only needs to be
+   * finished. A connection carries nothing else until the body is finished.
+   *
+   * on_head runs once the response head is parsed, and done once the
+   * exchange is over, with the head but no body in the result. Both run on
+   * the client's loop. The request timeout restarts with every read, so a
+   * long body only times out when it stalls.
+   */
+  auto stream(std::string_view host, std::uint16_t port,
+              const HttpRequest& request, HeadCallback on_head, Callback done)
+      -> std::shared_ptr<RequestBody>;
+
+  /**
+   * @brief The request as it goes on the wire.
+   */
+  static auto serialize(const HttpRequest& request, std::string_view host,
+                        std::uint16_t port) -> std::string;
+
+ private:
+  struct Pending;
+  struct Submission;
+  struct Connection;
+  struct Pool;
+
+  auto submit(std::string host, std::uint16_t port, Pending pending)
+      -> void;
+
+  auto submit(std::string host, std::uint16_t port, std::string data,
+              bool head, Callback callback) -> void;
+
+  auto pushBody(std::shared_ptr<RequestBody> body) -> void;
+
+  auto drainBody(Connection& connection) -> void;
+
+  auto armTimeout(Connection& connection, Pending& pending) -> void;
+
+  auto run() -> void;
+
+  auto wake() -> void;
+
+  auto takeSubmissions() -> void;
+
+  auto dispatch(Pool& pool) -> void;
+
+  auto connect(Pool& pool) -> Connection*;
+
+  auto assign(Connection& connection, Pending pending) -> void;
+
+  auto handleEvent(std::uint64_t id, std::uint32_t events) -> void;
+
+  auto onConnected(Connection& connection) -> void;
+
+  auto onReadable(Connection& connection) -> void;
+
+  auto flush(Connection& connection) -> bool;
+
+  auto updateEvents(Connection& connection) -> void;
+
+  auto expectResponse(Connection& connection) -> void;
+
+  auto complete(Connection& connection) -> void;
+
+  auto setIdle(Connection& connection) -> void;
+
+  /**
+   * @brief Close connection and fail its requests: the first with error,
+   * the ones after it with rest.
+   */
+  auto close(Connection& connection, Error error, Error rest) -> void;
+
+  static auto fail(Pending& pending, Error error) -> void;
+
+  auto failAll(Error error) -> void;
+
+  Options _options;
+  int _epoll_fd{-1};
+  int _wake_fd{-1};
+  std::atomic<bool> _running{true};
+  std::thread _thread;
+
+  std::mutex _mutex;
+  bool _stopped{false};
+  std::vector<Submission> _submissions;
+  std::vector<std::shared_ptr<RequestBody>> _body_updates;
+
+  // Only touched by the loop thread.
+  TimerWheel _timers{std::chrono::milliseconds{10}};
+  std::map<std::string, std::unique_ptr<Pool>, std::less<>> _pools;
+  std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> _connections;
+  std::uint64_t _next_id{1};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_CLIENT_H__
@@ -0,0 +1,139 @@
+#ifndef __FZ_HTTP_HTTP_COMPRESSION_H__
+#define __FZ_HTTP_HTTP_COMPRESSION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http/http_header.h"
+#include "http/http_request.h"
+#include "http/http_response.h"
+
+namespace fz::http {
+
+/**
+ * @brief Compresses response bodies with gzip or deflate for clients whose
+ * Accept-Encoding allows it.
+ *
+ * Bodies below Options::min_size and types that don't compress (images,
+ * archives, ...) are left alone. Compressed bodies are kept in an LRU cache
+ * keyed by the uncompressed content, so a body served again, e.g. a static
+ * file or a deterministic handler, is compressed once. Entries keep the
+ * uncompressed bytes to compare on a hit, and max_cached_bytes counts
+ * both. Chunked bodies are compressed as they are produced, each call of the
+ * producer ending in a flush so nothing is held back.
+ *
+ * zlib is optional: when FzHttp is built without it (FZ_HTTP_HAS_ZLIB not
+ * defined) available() is false and responses are never compressed.
+ */
+class HttpCompression {
+ public:
+  enum class Coding : std::uint8_t { Identity, Deflate, Gzip };
+
+  struct Options {
+    std::size_t min_size{1024};
+    int level{6};
+    std::size_t max_cached_bytes{std::size_t{64} << 20};
+  };
+
+  HttpCompression() : HttpCompression{Options{}} {}
+
+  explicit HttpCompression(Options options);
+
+  ~HttpCompression();
+
+  HttpCompression(const HttpCompression&) = delete;
+
+  auto operator=(const HttpCompression&) -> HttpCompression& = delete;
+
+  static auto available() -> bool;
+
+  static auto codingToString(Coding coding) -> std::string_view;
+
+  /**
+   * @brief Pick the coding for an Accept-Encoding value: the acceptable one
+   * with the highest q-value, gzip on a tie, identity if none is.
+   */
+  static auto negotiate(std::string_view accept_encoding) -> Coding;
+
+  /**
+   * @brief Whether a Content-Type is worth compressing. A missing type is.
+   */
+  static auto compressible(std::string_view content_type) -> bool;
+
+  /**
+   * @brief Compress data in one go. Returns data unchanged for identity or
+   * without zlib.
+   */
+  static auto compress(Coding coding, std::string_view data, int level = 6)
+      -> std::string;
+
+  /**
+   * @brief Compress response in place with coding if it qualifies, setting
+   * Content-Encoding and Vary and turning a strong ETag into a weak one.
+   * Thread safe.
+   */
+  auto apply(Coding coding, HttpResponse& response) -> void;
+
+  auto apply(const HttpRequest& request, HttpResponse& response) -> void {
+    apply(negotiate(request.header(HttpHeader::AcceptEncoding)), response);
+  }
+
+  /**
+   * @brief Only the Vary and ETag changes apply() makes when it compresses
+   * with coding, for a response without the body, e.g. a 304 that has to
+   * carry the headers of the compressed 200 it stands for. Nothing changes
+   * for identity.
+   */
+  static auto applyHeaders(Coding coding, HttpResponse& response) -> void;
+
+  auto cachedBytes() const -> std::size_t;
+
+ private:
+  // A view of the uncompressed bytes kept in the entry, compared in full on
+  // a lookup: responses whose bodies only share a hash must never be served
+  // each other's bytes.
+  struct Key {
+    std::string_view data;
+    Coding coding;
+
+    auto operator==(const Key&) const -> bool = default;
+  };
+
+  struct KeyHash {
+    auto operator()(const Key& key) const -> std::size_t {
+      return std::hash<std::string_view>{}(key.data) ^
+             static_cast<std::size_t>(key.coding);
+    }
+  };
+
+  struct Entry {
+    std::string data;
+    Coding coding;
+    std::shared_ptr<const std::string> body;  // null if incompressible
+    std::size_t size;  // of data and body
+  };
+
+  /**
+   * @brief Compressed data from the cache, compressing it on a miss. Null if
+   * compressing doesn't make it smaller.
+   */
+  auto compressCached(Coding coding, std::string_view data)
+      -> std::shared_ptr<const std::string>;
+
+  Options _options;
+
+  mutable std::mutex _mutex;
+  std::list<Entry> _lru;  // most recently used first
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _entries;
+  std::size_t _cached_bytes{0};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_COMPRESSION_H__
@@ -0,0 +1,82 @@
+#ifndef __FZ_HTTP_HTTP_DATE_H__
+#define __FZ_HTTP_HTTP_DATE_H__
+
+#include <array>
+#include <cstddef>
+#include <ctime>
+#include <string_view>
+
+namespace fz::http {
+
+class HttpDate {
+ public:
+  // IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+  constexpr static std::size_t SIZE = 29;
+
+  using Buffer = std::array<char, SIZE>;
+
+  /**
+   * @brief Format time as an IMF-fixdate. Names are written by hand so the
+   * result doesn't depend on the C locale.
+   */
+  static auto format(std::time_t time, Buffer& out) -> std::string_view {
+    constexpr auto days = std::string_view{"SunMonTueWedThuFriSat"};
+    constexpr auto months =
+        std::string_view{"JanFebMarAprMayJunJulAugSepOctNovDec"};
+
+    auto tm = std::tm{};
+    gmtime_r(&time, &tm);
+
+    auto put2 = [](char* p, int value) {
+      p[0] = static_cast<char>('0' + value / 10);
+      p[1] = static_cast<char>('0' + value % 10);
+    };
+
+    auto* p = out.data();
+    days.copy(p, 3, static_cast<std::size_t>(tm.tm_wday) * 3);
+    p[3] = ',';
+    p[4] = ' ';
+    put2(p + 5, tm.tm_mday);
+    p[7] = ' ';
+    months.copy(p + 8, 3, static_cast<std::size_t>(tm.tm_mon) * 3);
+    p[11] = ' ';
+    const auto year = tm.tm_year + 1900;
+    put2(p + 12, year / 100 % 100);
+    put2(p + 14, year % 100);
+    p[16] = ' ';
+    put2(p + 17, tm.tm_hour);
+    p[19] = ':';
+    put2(p + 20, tm.tm_min);
+    p[22] = ':';
+    put2(p + 23, tm.tm_sec);
+    std::string_view{" GMT"}.copy(p + 25, 4);
+
+    return {out.data(), out.size()};
+  }
+
+  /**
+   * @brief Current date, cached per thread and reformatted at most once per
+   * second, so every event loop thread keeps its own copy without locking.
+   */
+  static auto now() -> std::string_view {
+    thread_local auto cache = Cache{};
+
+    const auto current = std::time(nullptr);
+    if (current != cache.time) {
+      cache.time = current;
+      format(current, cache.date);
+    }
+
+    return {cache.date.data(), cache.date.size()};
+  }
+
+ private:
+  struct Cache {
+    std::time_t time{-1};
+    Buffer date{};
+  };
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_DATE_H__
@@ -0,0 +1,66 @@
+#ifndef __FZ_HTTP_HTTP_FIELDS_H__
+#define __FZ_HTTP_HTTP_FIELDS_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief Small flat list of key/value views used for headers and querys.
+ * Requests rarely carry more than a few dozen fields, so a linear scan over a
+ * contiguous vector beats hashing, and clear() keeps the capacity for the
+ * next request on the connection. The fields do not own their bytes.
+ */
+class HttpFields {
+ public:
+  using value_type = std::pair<std::string_view, std::string_view>;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  auto begin() const { return _fields.begin(); }
+
+  auto end() const { return _fields.end(); }
+
+  auto size() const { return _fields.size(); }
+
+  auto empty() const { return _fields.empty(); }
+
+  auto add(std::string_view key, std::string_view value) -> void {
+    _fields.emplace_back(key, value);
+  }
+
+  auto find(std::string_view key) const -> const_iterator {
+    return std::find_if(_fields.begin(), _fields.end(),
+                        [key](const auto& field) {
+                          return field.first == key;
+                        });
+  }
+
+  auto contains(std::string_view key) const { return find(key) != end(); }
+
+  auto at(std::string_view key) const -> std::string_view {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("HttpFields::at");
+    }
+    return it->second;
+  }
+
+  /**
+   * @brief Drop every field added after the first size ones.
+   */
+  auto truncate(std::size_t size) -> void { _fields.resize(size); }
+
+  auto clear() -> void { _fields.clear(); }
+
+ private:
+  std::vector<value_type> _fields;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_FIELDS_H__
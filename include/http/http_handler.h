@@ -0,0 +1,173 @@
+#ifndef __FZ_HTTP_HTTP_HANDLER_H__
+#define __FZ_HTTP_HTTP_HANDLER_H__
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "http/http_request.h"
+#include "http/http_request_parse.h"
+#include "http/http_responder.h"
+#include "http/http_response.h"
+#include "http/http_response_cache.h"
+#include "http/http_validators.h"
+#include "http/websocket.h"
+
+namespace fz::http {
+
+/**
+ * @brief A route handler in one of four forms:
+ *
+ * - Inline: HttpResponse(const HttpRequest&), runs on the event loop.
+ * - Async: void(const HttpRequest&, HttpResponder), runs on the event loop
+ *   and answers later through the responder, from any thread. The request
+ *   is only valid during the call, use HttpRequest::copyTo() to keep it.
+ * - Offload: an inline handler run on the server's offload thread pool with
+ *   a copy of the request, for CPU heavy work.
+ * - Stream: BodyConsumer(const HttpRequest&, HttpResponder), called as soon
+ *   as the headers are parsed. The returned consumer gets the body as it
+ *   arrives (see HttpRequestParse::BodyConsumer) and isn't subject to the
+ *   body size limit. The request stays valid until the consumer has seen the
+ *   end of the body. Returning an empty consumer discards the body.
+ * - WebSocket: the server completes the upgrade handshake and hands the
+ *   connection to a WebSocketHandler.
+ *
+ * Any of them can be made cached(): GET responses are then kept serialized
+ * in the server's HttpResponseCache and reused while fresh. Inline, Async
+ * and Offload handlers can also be made conditional(), so revalidating
+ * clients get a 304 without the handler running.
+ *
+ * HEAD requests run the GET handler, the server sends only the head of
+ * its response.
+ */
+class HttpHandler {
+ public:
+  using Sync = std::function<HttpResponse(const HttpRequest& request)>;
+  using Async =
+      std::function<void(const HttpRequest& request, HttpResponder responder)>;
+  using BodyConsumer = HttpRequestParse::BodyConsumer;
+  using Stream = std::function<BodyConsumer(const HttpRequest& request,
+                                            HttpResponder responder)>;
+
+  enum class Mode : std::uint8_t { Inline, Async, Offload, Stream, WebSocket };
+
+  /**
+   * @brief Validators of what handler would answer request with, meant to
+   * be much cheaper than the response itself, e.g. a version counter.
+   */
+  using Precondition =
+      std::function<HttpValidators(const HttpRequest& request)>;
+
+  HttpHandler() = default;
+
+  template <typename F>
+    requires(!std::same_as<std::remove_cvref_t<F>, HttpHandler> &&
+             std::is_invocable_r_v<HttpResponse, F&, const HttpRequest&>)
+  HttpHandler(F handler)  // NOLINT(google-explicit-constructor)
+      : _mode{Mode::Inline}, _sync{std::move(handler)} {}
+
+  template <typename F>
+    requires(!std::same_as<std::remove_cvref_t<F>, HttpHandler> &&
+             std::is_invocable_v<F&, const HttpRequest&, HttpResponder>)
+  HttpHandler(F handler)  // NOLINT(google-explicit-constructor)
+      : _mode{Mode::Async}, _async{std::move(handler)} {}
+
+  static auto offload(Sync handler) -> HttpHandler {
+    auto result = HttpHandler{std::move(handler)};
+    result._mode = Mode::Offload;
+    return result;
+  }
+
+  static auto stream(Stream handler) -> HttpHandler {
+    auto result = HttpHandler{};
+    result._mode = Mode::Stream;
+    result._stream = std::move(handler);
+    return result;
+  }
+
+  static auto webSocket(WebSocketHandler handler) -> HttpHandler {
+    auto result = HttpHandler{};
+    result._mode = Mode::WebSocket;
+    result._websocket =
+        std::make_shared<const WebSocketHandler>(std::move(handler));
+    return result;
+  }
+
+  /**
+   * @brief Cache the GET responses of handler as described by policy.
+   * Only responses HttpResponseCache::cacheable() accepts are stored.
+   */
+  static auto cached(HttpHandler handler, HttpResponseCache::Policy policy)
+      -> HttpHandler {
+    handler._cache_policy =
+        std::make_shared<const HttpResponseCache::Policy>(std::move(policy));
+    return handler;
+  }
+
+  /**
+   * @brief Evaluate precondition before every GET or HEAD request and
+   * answer 304 when the client's If-None-Match or If-Modified-Since still
+   * matches, without running handler. Otherwise the validators are added
+   * to the 200 response. Checked before the response cache.
+   *
+   * With compression enabled, the 304 to a client that accepts gzip or
+   * deflate gets Vary and the weak ETag as if the 200 was compressed.
+   */
+  static auto conditional(HttpHandler handler, Precondition precondition)
+      -> HttpHandler {
+    handler._precondition =
+        std::make_shared<const Precondition>(std::move(precondition));
+    return handler;
+  }
+
+  auto mode() const { return _mode; }
+
+  auto cachePolicy() const { return _cache_policy.get(); }
+
+  auto precondition() const { return _precondition.get(); }
+
+  explicit operator bool() const {
+    switch (_mode) {
+      case Mode::Async:
+        return static_cast<bool>(_async);
+      case Mode::Stream:
+        return static_cast<bool>(_stream);
+      case Mode::WebSocket:
+        return static_cast<bool>(_websocket);
+      default:
+        return static_cast<bool>(_sync);
+    }
+  }
+
+  auto operator()(const HttpRequest& request) const -> HttpResponse {
+    return _sync(request);
+  }
+
+  auto operator()(const HttpRequest& request, HttpResponder responder) const
+      -> void {
+    _async(request, std::move(responder));
+  }
+
+  auto openBody(const HttpRequest& request, HttpResponder responder) const
+      -> BodyConsumer {
+    return _stream(request, std::move(responder));
+  }
+
+  auto& webSocketHandler() const { return _websocket; }
+
+ private:
+  Mode _mode{Mode::Inline};
+  Sync _sync;
+  Async _async;
+  Stream _stream;
+  std::shared_ptr<const WebSocketHandler> _websocket;
+  std::shared_ptr<const HttpResponseCache::Policy> _cache_policy;
+  std::shared_ptr<const Precondition> _precondition;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_HANDLER_H__
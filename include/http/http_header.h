@@ -0,0 +1,130 @@
+#ifndef __FZ_HTTP_HTTP_HEADER_H__
+#define __FZ_HTTP_HTTP_HEADER_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace fz::http {
+
+/**
+ * @brief Well-known header names. The parser interns these while reading a
+ * header block so the request can answer lookups for them by index.
+ */
+enum class HttpHeader : std::uint8_t {
+  UNKNOWN,
+  Accept,
+  AcceptEncoding,
+  AcceptLanguage,
+  Authorization,
+  CacheControl,
+  Connection,
+  ContentEncoding,
+  ContentLength,
+  ContentType,
+  Cookie,
+  Date,
+  ETag,
+  Expect,
+  Host,
+  IfModifiedSince,
+  IfNoneMatch,
+  KeepAlive,
+  LastModified,
+  Origin,
+  Range,
+  Referer,
+  SecWebSocketKey,
+  SecWebSocketVersion,
+  Server,
+  TransferEncoding,
+  Upgrade,
+  UserAgent,
+  XForwardedFor,
+  COUNT
+};
+
+constexpr inline auto HTTP_HEADER_COUNT =
+    static_cast<std::size_t>(HttpHeader::COUNT);
+
+constexpr inline std::array<std::string_view, HTTP_HEADER_COUNT>
+    HTTP_HEADER_NAMES = {
+        "",
+        "Accept",
+        "Accept-Encoding",
+        "Accept-Language",
+        "Authorization",
+        "Cache-Control",
+        "Connection",
+        "Content-Encoding",
+        "Content-Length",
+        "Content-Type",
+        "Cookie",
+        "Date",
+        "ETag",
+        "Expect",
+        "Host",
+        "If-Modified-Since",
+        "If-None-Match",
+        "Keep-Alive",
+        "Last-Modified",
+        "Origin",
+        "Range",
+        "Referer",
+        "Sec-WebSocket-Key",
+        "Sec-WebSocket-Version",
+        "Server",
+        "Transfer-Encoding",
+        "Upgrade",
+        "User-Agent",
+        "X-Forwarded-For",
+};
+
+constexpr auto toLower(char c) -> char {
+  return ('A' <= c && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/**
+ * @brief ASCII case-insensitive comparison, as header names and most header
+ * tokens are case-insensitive.
+ */
+constexpr auto equalsIgnoreCase(std::string_view lhs, std::string_view rhs)
+    -> bool {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    if (toLower(lhs[i]) != toLower(rhs[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+constexpr auto headerToString(HttpHeader header) -> std::string_view {
+  return HTTP_HEADER_NAMES[static_cast<std::size_t>(header)];
+}
+
+constexpr auto headerFromString(std::string_view name) -> HttpHeader {
+  // Most names are rejected on length or first letter before comparing.
+  for (std::size_t i = 1; i < HTTP_HEADER_COUNT; ++i) {
+    const auto known = HTTP_HEADER_NAMES[i];
+    if (known.size() == name.size() && toLower(known[0]) == toLower(name[0]) &&
+        equalsIgnoreCase(known, name)) {
+      return static_cast<HttpHeader>(i);
+    }
+  }
+
+  return HttpHeader::UNKNOWN;
+}
+
+static_assert(headerFromString("content-length") == HttpHeader::ContentLength);
+static_assert(headerFromString("X-Forwarded-For") == HttpHeader::XForwardedFor);
+static_assert(headerFromString("X-Unknown") == HttpHeader::UNKNOWN);
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_HEADER_H__
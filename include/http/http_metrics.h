@@ -0,0 +1,163 @@
+#ifndef __FZ_HTTP_HTTP_METRICS_H__
+#define __FZ_HTTP_HTTP_METRICS_H__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/http_request_parse.h"
+
+namespace fz::http {
+
+/**
+ * @brief Server counters: requests by route and status, handler latency,
+ * bytes in and out, parse errors and connections.
+ *
+ * Every thread updating the metrics gets a shard of its own, so an update
+ * is a plain load and store of a counter no other thread writes, with no
+ * locked instruction or shared cache line. The shards are summed when the
+ * metrics are read, e.g. by a scrape of the endpoint registered with
+ * HttpServer::enableMetrics().
+ *
+ * Latency goes into log-linear histograms in the style of HdrHistogram:
+ * each power of two of nanoseconds is split into 8 buckets, so a quantile
+ * is within 12.5% of the true value over the whole range.
+ */
+class HttpMetrics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  constexpr static auto LATENCY_SUB_BITS = 3;
+  constexpr static auto LATENCY_SUB_BUCKETS = std::size_t{1}
+                                              << LATENCY_SUB_BITS;
+  // Up to 2^40 ns (about 18 minutes), longer latencies land in the last
+  // bucket.
+  constexpr static auto LATENCY_BUCKETS =
+      LATENCY_SUB_BUCKETS * (40 - LATENCY_SUB_BITS + 1);
+  constexpr static auto PARSE_ERRORS =
+      static_cast<std::size_t>(HttpRequestParse::Error::NotImplemented) + 1;
+
+  /**
+   * @brief Bucket holding a latency of value nanoseconds.
+   */
+  static auto latencyBucket(std::uint64_t value) -> std::size_t;
+
+  /**
+   * @brief Largest latency in nanoseconds that falls into bucket.
+   */
+  static auto latencyUpperBound(std::size_t bucket) -> std::uint64_t;
+
+  struct Latency {
+    std::vector<std::uint64_t> buckets = std::vector<std::uint64_t>(
+        LATENCY_BUCKETS);
+    std::uint64_t count{0};
+    std::chrono::nanoseconds sum{0};
+
+    /**
+     * @brief Upper bound of the bucket holding the q-quantile, q in [0, 1].
+     */
+    auto quantile(double q) const -> std::chrono::nanoseconds;
+
+    /**
+     * @brief Number of latencies at most limit, to the precision of the
+     * buckets.
+     */
+    auto countAtMost(std::chrono::nanoseconds limit) const -> std::uint64_t;
+  };
+
+  /**
+   * @brief The metrics of every thread summed up.
+   */
+  struct Snapshot {
+    struct Route {
+      std::map<std::uint16_t, std::uint64_t> statuses;
+      Latency latency;
+    };
+
+    // By route pattern. Requests that matched no route, or never got that
+    // far, are under the empty pattern.
+    std::map<std::string, Route, std::less<>> routes;
+    std::uint64_t bytes_received{0};
+    std::uint64_t bytes_sent{0};
+    // Sends to connections, the write syscalls a request costs.
+    std::uint64_t writes{0};
+    std::uint64_t connections_opened{0};
+    std::uint64_t connections_closed{0};
+    // By HttpRequestParse::Error, None unused.
+    std::array<std::uint64_t, PARSE_ERRORS> parse_errors{};
+
+    auto connectionsActive() const -> std::uint64_t {
+      return connections_opened - connections_closed;
+    }
+  };
+
+  HttpMetrics();
+
+  ~HttpMetrics();
+
+  HttpMetrics(const HttpMetrics&) = delete;
+
+  auto operator=(const HttpMetrics&) -> HttpMetrics& = delete;
+
+  auto connectionOpened() -> void;
+
+  auto connectionClosed() -> void;
+
+  auto bytesReceived(std::size_t bytes) -> void;
+
+  /**
+   * @brief Count one send of bytes to a connection.
+   */
+  auto bytesSent(std::size_t bytes) -> void;
+
+  auto parseError(HttpRequestParse::Error error) -> void;
+
+  /**
+   * @brief Count a response with status to a request routed to route, the
+   * pattern it was registered with.
+   */
+  auto response(std::string_view route, std::uint16_t status) -> void;
+
+  /**
+   * @brief Count a response and record how long the request took, from
+   * the end of its headers until the response was handed to the session.
+   */
+  auto response(std::string_view route, std::uint16_t status,
+                Clock::duration latency) -> void;
+
+  auto snapshot() const -> Snapshot;
+
+  /**
+   * @brief The snapshot in the Prometheus text exposition format.
+   */
+  auto render() const -> std::string;
+
+ private:
+  struct Shard;
+  struct RouteStats;
+
+  /**
+   * @brief The shard of the calling thread, created on its first update.
+   */
+  auto local() -> Shard&;
+
+  auto route(Shard& shard, std::string_view pattern) -> RouteStats&;
+
+  auto count(Shard& shard, RouteStats& stats, std::uint16_t status) -> void;
+
+  std::uint64_t _id;
+  mutable std::mutex _mutex;
+  std::vector<std::unique_ptr<Shard>> _shards;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_METRICS_H__
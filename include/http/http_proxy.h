@@ -0,0 +1,132 @@
+#ifndef __FZ_HTTP_HTTP_PROXY_H__
+#define __FZ_HTTP_HTTP_PROXY_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/arena.h"
+#include "http/http_client.h"
+#include "http/http_handler.h"
+#include "http/http_request.h"
+#include "http/http_responder.h"
+#include "http/http_response.h"
+
+namespace fz::http {
+
+/**
+ * @brief Reverse proxy forwarding requests to a set of upstream servers
+ * over the keep-alive pools of an HttpClient. Proxies share one client, and
+ * so one loop thread and one set of pools, unless given their own.
+ *
+ * Bodies are relayed in both directions as they arrive instead of being
+ * buffered: the request body goes upstream piece by piece and reading it
+ * from the client pauses while too much of it waits to be sent, and the
+ * response is sent downstream from its head on, chunked unless the
+ * upstream declared a Content-Length.
+ *
+ * Hop-by-hop headers (Connection, the ones it lists, Keep-Alive, TE,
+ * Trailer, Upgrade, Proxy-*) are dropped in both directions. Upstream
+ * requests get the upstream's Host unless preserve_host is set, with the
+ * original one in X-Forwarded-Host. The request-target, path and query
+ * string, is forwarded byte for byte.
+ *
+ * X-Forwarded-For gets the client's address appended to the list the
+ * client sent, so an upstream trusting only its last element can't be
+ * fooled. Without the address (see HttpSession::peerAddress()) the
+ * client's list is dropped rather than passed on as if this proxy vouched
+ * for it.
+ *
+ * An upstream that can't be reached or answers garbage gets the client a
+ * 502, one that doesn't answer in time a 504. A failure after the response
+ * head was sent closes the client connection, so the truncation shows.
+ *
+ * Requests in flight when the proxy is destroyed run to completion while
+ * the client is still there: with a shared client they are answered, with
+ * a client only the proxy held they fail as it shuts down.
+ */
+class HttpProxy {
+ public:
+  struct Upstream {
+    std::string host;
+    std::uint16_t port{80};
+  };
+
+  enum class Balance : std::uint8_t {
+    RoundRobin,
+    // The upstream with the fewest requests in flight through this proxy.
+    LeastConnections
+  };
+
+  struct Options {
+    Balance balance{Balance::RoundRobin};
+    bool preserve_host{false};
+    // Null for the client shared by every proxy not given one, which has
+    // default options and lives as long as the last of them.
+    std::shared_ptr<HttpClient> client;
+  };
+
+  explicit HttpProxy(std::vector<Upstream> upstreams)
+      : HttpProxy{std::move(upstreams), Options{}} {}
+
+  HttpProxy(std::vector<Upstream> upstreams, const Options& options);
+
+  HttpProxy(const HttpProxy&) = delete;
+
+  auto operator=(const HttpProxy&) -> HttpProxy& = delete;
+
+  /**
+   * @brief Forward request, for use as an HttpHandler::Stream. Must not be
+   * called once the proxy is being destroyed.
+   */
+  auto forward(const HttpRequest& request, HttpResponder responder)
+      -> HttpHandler::BodyConsumer;
+
+  /**
+   * @brief Index of the upstream the next request goes to.
+   */
+  auto pick() -> std::size_t;
+
+  /**
+   * @brief Requests in flight to upstream index.
+   */
+  auto active(std::size_t index) const -> std::size_t {
+    return _active[index].load(std::memory_order_relaxed);
+  }
+
+  auto& upstreams() const { return _upstreams; }
+
+  auto& client() const { return *_client; }
+
+  /**
+   * @brief The request sent upstream for request from the client at peer
+   * (empty if unknown), with the strings it adds stored in arena.
+   */
+  auto upstreamRequest(const HttpRequest& request, const Upstream& upstream,
+                       Arena& arena, std::string_view peer = {}) const
+      -> HttpRequest;
+
+  /**
+   * @brief The head sent downstream for the head of an upstream response.
+   */
+  static auto downstreamResponse(const HttpResponse& head) -> HttpResponse;
+
+ private:
+  struct Exchange;
+
+  std::vector<Upstream> _upstreams;
+  Options _options;
+  // Shared with the requests in flight, which may outlive the proxy on a
+  // shared client.
+  std::shared_ptr<std::atomic<std::size_t>[]> _active;
+  std::atomic<std::size_t> _next{0};
+  std::shared_ptr<HttpClient> _client;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_PROXY_H__
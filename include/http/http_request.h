@@ -1,16 +1,28 @@
 #ifndef __FZ_HTTP_HTTP_REQUEST_H__
 #define __FZ_HTTP_HTTP_REQUEST_H__
 
+#include <array>
+#include <bitset>
 #include <cstddef>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 
+#include "http/arena.h"
+#include "http/http_fields.h"
+#include "http/http_header.h"
+#include "http/http_scan.h"
 #include "http/type_define.h"
 
 namespace fz::http {
 
+/**
+ * @brief A parsed request. Path, querys, headers and body are views into
+ * storage owned by whoever parsed the request (the caller's string for
+ * parse(), the connection's arena for HttpRequestParse), so a request must
+ * not outlive that storage.
+ */
 class HttpRequest {
  public:
   HttpRequest() { clear(); }
@@ -88,8 +100,29 @@ class HttpRequest {
 
   auto& querys() const { return _querys; }
 
+  /**
+   * @brief The request-target as received, path and query string, e.g. to
+   * pass it on unchanged. Serializing writes it instead of path and querys
+   * when set.
+   */
+  auto target() const { return _target; }
+
+  auto setTarget(std::string_view target) { _target = target; }
+
   auto addQuery(std::string_view key, std::string_view value) {
-    _querys.emplace(key, value);
+    _querys.add(key, value);
+  }
+
+  /**
+   * @brief Parameters captured by the route pattern that matched the path.
+   */
+  auto& params() const { return _params; }
+
+  auto& params() { return _params; }
+
+  auto param(std::string_view key) const -> std::string_view {
+    auto it = _params.find(key);
+    return it != _params.end() ? it->second : std::string_view{};
   }
 
   auto version() const { return _version; }
@@ -99,39 +132,183 @@ class HttpRequest {
   auto& headers() const { return _headers; }
 
   auto addHeader(std::string_view key, std::string_view value) {
-    _headers[std::string{key}] = std::string{value};
+    _headers.add(key, value);
+
+    const auto id = headerFromString(key);
+    if (id != HttpHeader::UNKNOWN) {
+      auto& known = _known_headers[static_cast<std::size_t>(id)];
+      if (known.data() == nullptr) {
+        known = value;
+      } else {
+        _repeated_headers.set(static_cast<std::size_t>(id));
+      }
+    }
+  }
+
+  /**
+   * @brief Value of a well-known header, or an empty view (with a null data
+   * pointer) when the request doesn't carry it.
+   */
+  auto header(HttpHeader id) const -> std::string_view {
+    return _known_headers[static_cast<std::size_t>(id)];
+  }
+
+  auto hasHeader(HttpHeader id) const -> bool {
+    return header(id).data() != nullptr;
+  }
+
+  /**
+   * @brief Whether a well-known header appears more than once, header(id)
+   * being the first.
+   */
+  auto headerRepeated(HttpHeader id) const -> bool {
+    return _repeated_headers.test(static_cast<std::size_t>(id));
+  }
+
+  /**
+   * @brief Call f with every element of the comma separated list a
+   * well-known header holds, trimmed and in order, empty ones included. A
+   * repeated header is one list, its fields joined in order.
+   */
+  template <typename F>
+  auto forEachHeaderElement(HttpHeader id, F&& f) const -> void {
+    const auto split = [&f](std::string_view value) {
+      for (auto comma = value.find(','); comma != std::string_view::npos;
+           comma = value.find(',')) {
+        f(trim(value.substr(0, comma)));
+        value.remove_prefix(comma + 1);
+      }
+      f(trim(value));
+    };
+
+    if (!headerRepeated(id)) {
+      if (hasHeader(id)) {
+        split(header(id));
+      }
+      return;
+    }
+
+    const auto name = headerToString(id);
+    for (const auto& [key, value] : _headers) {
+      if (equalsIgnoreCase(key, name)) {
+        split(value);
+      }
+    }
   }
 
-  auto& body() const { return _body; }
+  /**
+   * @brief Case-insensitive header lookup by name.
+   */
+  auto header(std::string_view key) const -> std::string_view {
+    const auto id = headerFromString(key);
+    if (id != HttpHeader::UNKNOWN) {
+      return header(id);
+    }
+
+    for (const auto& [name, value] : _headers) {
+      if (equalsIgnoreCase(name, key)) {
+        return value;
+      }
+    }
+
+    return {};
+  }
+
+  /**
+   * @brief Trailer fields sent after a chunked body.
+   */
+  auto& trailers() const { return _trailers; }
+
+  auto addTrailer(std::string_view key, std::string_view value) {
+    _trailers.add(key, value);
+  }
+
+  auto body() const { return _body; }
 
   auto setBody(std::string_view body) { _body = body; }
 
+  /**
+   * @brief Whether the client wants the connection kept open after this
+   * request: by default for HTTP/1.1 unless Connection lists "close", and
+   * only when Connection lists "keep-alive" for HTTP/1.0.
+   */
   auto keepAlive() const -> bool {
-    auto connection = _headers.find("Connection");
-    if (connection == _headers.end()) {
-      return false;
+    if (_version == HTTP_1_1) {
+      return !hasConnectionOption("close");
     }
-    return connection->second == "keep-alive";
+    return _version == HTTP_1_0 && hasConnectionOption("keep-alive");
+  }
+
+  /**
+   * @brief Whether the comma separated Connection header lists option.
+   */
+  auto hasConnectionOption(std::string_view option) const -> bool {
+    auto value = header(HttpHeader::Connection);
+    while (!value.empty()) {
+      const auto comma = value.find(',');
+      if (equalsIgnoreCase(trim(value.substr(0, comma)), option)) {
+        return true;
+      }
+      value = comma == std::string_view::npos ? std::string_view{}
+                                               : value.substr(comma + 1);
+    }
+    return false;
+  }
+
+  /**
+   * @brief Copy the request into arena, for a request that has to outlive
+   * the storage it was parsed from (e.g. handed to another thread).
+   */
+  auto copyTo(Arena& arena) const -> HttpRequest {
+    auto copy = HttpRequest{};
+    copy.setMethod(_method);
+    copy.setPath(arena.store(_path));
+    copy.setTarget(arena.store(_target));
+    for (const auto& [key, value] : _querys) {
+      copy.addQuery(arena.store(key), arena.store(value));
+    }
+    for (const auto& [key, value] : _params) {
+      copy._params.add(arena.store(key), arena.store(value));
+    }
+    copy.setVersion(_version);
+    for (const auto& [key, value] : _headers) {
+      copy.addHeader(arena.store(key), arena.store(value));
+    }
+    for (const auto& [key, value] : _trailers) {
+      copy.addTrailer(arena.store(key), arena.store(value));
+    }
+    copy.setBody(arena.store(_body));
+    return copy;
   }
 
   auto clear() -> void {
     _method = INVALID;
-    _path.clear();
+    _path = {};
+    _target = {};
     _querys.clear();
+    _params.clear();
     _version = UNKNOWN;
     _headers.clear();
-    _body.clear();
+    _known_headers.fill({});
+    _repeated_headers.reset();
+    _trailers.clear();
+    _body = {};
   }
 
   auto toString() const -> std::string {
     std::stringstream ss;
-    ss << methodToString(_method) << SPACE << _path;
-    if (!_querys.empty()) {
-      ss << "?";
-      for (const auto& [key, value] : _querys) {
-        ss << key << "=" << value << "&";
+    ss << methodToString(_method) << SPACE;
+    if (!_target.empty()) {
+      ss << _target;
+    } else {
+      ss << _path;
+      if (!_querys.empty()) {
+        ss << "?";
+        for (const auto& [key, value] : _querys) {
+          ss << key << "=" << value << "&";
+        }
+        ss.seekp(-1, std::ios_base::end);
       }
-      ss.seekp(-1, std::ios_base::end);
     }
 
     ss << SPACE << versionToString(_version) << CRLF;
@@ -154,59 +331,58 @@ class HttpRequest {
       return pos;
     }
 
-    auto request_line = data.substr(0, pos);
+    const auto request_line = data.substr(0, pos);
+    _positions.clear();
+    if (!HttpScanner::scan(request_line, _positions)) {
+      return std::string::npos;
+    }
 
-    const auto method_pos = request_line.find(SPACE);
-    if (method_pos == std::string::npos) {
-      return method_pos;
+    auto it = _positions.begin();
+    if (it == _positions.end() || request_line[*it] != ' ') {
+      return std::string::npos;
     }
+
+    const auto method_pos = *it++;
     auto method = methodFromString(request_line.substr(0, method_pos));
     if (method == INVALID) {
-      return method_pos;
+      return std::string::npos;
     }
     setMethod(method);
 
-    const auto url_pos = request_line.find(SPACE, method_pos + 1);
-    if (url_pos == std::string::npos) {
-      return url_pos;
+    // The Request-URI ends at the next SP, its first '?' starts the querys.
+    auto query_it = _positions.end();
+    for (; it != _positions.end() && request_line[*it] != ' '; ++it) {
+      if (request_line[*it] == '?' && query_it == _positions.end()) {
+        query_it = it;
+      }
     }
 
-    auto path = request_line.substr(method_pos + 1, url_pos - method_pos - 1);
-    const auto query_pos = path.find('?');
-    if (query_pos != std::string::npos) {
-      setPath(path.substr(0, query_pos));
-      auto querys = path.substr(query_pos + 1);
-      while (true) {
-        auto equal_pos = querys.find('=');
-        if (equal_pos == std::string::npos) {
-          break;
-        }
-
-        auto key = querys.substr(0, equal_pos);
-        querys.remove_prefix(equal_pos + 1);
-        auto and_pos = querys.find('&');
-        if (and_pos == std::string::npos) {
-          addQuery(key, querys);
-          break;
-        }
+    if (it == _positions.end()) {
+      return std::string::npos;
+    }
 
-        auto value = querys.substr(0, and_pos);
-        querys.remove_prefix(and_pos + 1);
-        addQuery(key, value);
-      }
+    const auto url_pos = *it;
+    setTarget(request_line.substr(method_pos + 1, url_pos - method_pos - 1));
+    if (query_it != _positions.end()) {
+      setPath(request_line.substr(method_pos + 1, *query_it - method_pos - 1));
+      parseQuerys(request_line, query_it, it);
     } else {
-      setPath(path);
+      setPath(request_line.substr(method_pos + 1, url_pos - method_pos - 1));
     }
 
     auto version = versionFromString(request_line.substr(url_pos + 1));
     if (version == UNKNOWN) {
-      return url_pos;
+      return std::string::npos;
     }
     setVersion(version);
 
     return pos + CRLF.size();  // skip CRLF
   }
 
+  /**
+   * @brief Parse a single header line, the value without the optional
+   * whitespace around it ("Key:value", "Key:  value " and "Key:" are valid).
+   */
   auto parseOneHeader(std::string_view data) -> std::string::size_type {
     const auto pos = data.find(CRLF);
     if (pos == std::string::npos) {
@@ -217,68 +393,189 @@ class HttpRequest {
       return pos;
     }
 
-    const auto colon_pos = header.find(COLON);
+    const auto colon_pos = header.find(':');
     if (colon_pos == std::string::npos) {
       return colon_pos;
     }
     auto key = header.substr(0, colon_pos);
-    auto value = header.substr(colon_pos + 2);
-    addHeader(key, value);
+    if (!isToken(key)) {
+      return std::string::npos;
+    }
+    addHeader(key, trim(header.substr(colon_pos + 1)));
 
     return pos + CRLF.size();
   }
 
+  /**
+   * @brief Parse header lines, each terminated by CRLF. Parsing stops at an
+   * empty line, which is not consumed.
+   *
+   * @return bytes consumed, or npos if data is malformed or ends in the
+   * middle of a line.
+   */
   auto parseHeaders(std::string_view data) -> std::string::size_type {
+    return parseFields(data, [this](std::string_view key,
+                                    std::string_view value) {
+      addHeader(key, value);
+    });
+  }
+
+  /**
+   * @brief Parse the trailer section of a chunked body, same format as
+   * parseHeaders().
+   */
+  auto parseTrailers(std::string_view data) -> std::string::size_type {
+    return parseFields(data, [this](std::string_view key,
+                                    std::string_view value) {
+      addTrailer(key, value);
+    });
+  }
+
+  auto parse(std::string_view data) -> bool {
+    auto bytes = parseRequestLine(data);
+    if (bytes == std::string::npos) {
+      return false;
+    }
+
+    data.remove_prefix(bytes);
+    if (data.substr(0, CRLF.size()) != CRLF) {
+      const auto end_pos = data.find("\r\n\r\n");
+      if (end_pos == std::string::npos) {
+        return false;
+      }
+
+      const auto block_size = end_pos + CRLF.size();
+      if (parseHeaders(data.substr(0, block_size)) != block_size) {
+        return false;
+      }
+
+      data.remove_prefix(block_size);
+    }
+
+    data.remove_prefix(CRLF.size());
+    setBody(data);
+
+    return true;
+  }
+
+ private:
+  using PositionIterator = HttpScanner::Positions::const_iterator;
+
+  template <typename AddField>
+  auto parseFields(std::string_view data, AddField add_field)
+      -> std::string::size_type {
     if (data.empty()) {
       return std::string::npos;
     }
 
-    std::string::size_type pos = 0;
-    while (true) {
-      if (data.empty()) {
-        break;
+    _positions.clear();
+    if (!HttpScanner::scan(data, _positions)) {
+      return std::string::npos;
+    }
+
+    std::string::size_type line_pos = 0;
+    auto colon_pos = std::string::npos;
+    for (const auto pos : _positions) {
+      const auto c = data[pos];
+      if (c == ':') {
+        if (colon_pos == std::string::npos) {
+          colon_pos = pos;
+        }
+        continue;
       }
 
-      auto bytes = parseOneHeader(data);
-      if (bytes == std::string::npos) {
-        return bytes;
+      if (c == '\n') {
+        if (pos == 0 || data[pos - 1] != '\r') {
+          return std::string::npos;  // bare LF
+        }
+        continue;
       }
-      if (bytes == 0) {
-        break;
+
+      if (c != '\r') {
+        continue;
       }
 
-      pos += bytes;
-      data.remove_prefix(bytes);
-    }
+      if (data.size() <= pos + 1 || data[pos + 1] != '\n') {
+        return std::string::npos;
+      }
 
-    return pos;
-  }
+      if (pos == line_pos) {
+        break;  // empty line
+      }
 
-  auto parse(std::string_view data) -> bool {
-    auto bytes = parseRequestLine(data);
-    if (bytes == std::string::npos) {
-      return false;
+      if (colon_pos == std::string::npos) {
+        return std::string::npos;
+      }
+
+      auto key = data.substr(line_pos, colon_pos - line_pos);
+      if (!isToken(key)) {
+        return std::string::npos;
+      }
+
+      add_field(key, trim(data.substr(colon_pos + 1, pos - colon_pos - 1)));
+      line_pos = pos + CRLF.size();
+      colon_pos = std::string::npos;
     }
 
-    data.remove_prefix(bytes);
-    bytes = parseHeaders(data);
-    if (bytes == std::string::npos) {
-      return false;
+    if (line_pos != data.size() && data.substr(line_pos, 2) != CRLF) {
+      return std::string::npos;
     }
 
-    data.remove_prefix(bytes + CRLF.size());
-    setBody(data);
+    return line_pos;
+  }
 
-    return true;
+  /**
+   * @brief Split the query string between the '?' at first and the SP at last
+   * into key=value pairs separated by '&'. Pairs without '=' are skipped.
+   */
+  auto parseQuerys(std::string_view request_line, PositionIterator first,
+                   PositionIterator last) -> void {
+    auto add_query = [&](std::size_t begin, std::size_t equal_pos,
+                         std::size_t end) {
+      if (equal_pos == std::string::npos) {
+        return;
+      }
+      addQuery(request_line.substr(begin, equal_pos - begin),
+               request_line.substr(equal_pos + 1, end - equal_pos - 1));
+    };
+
+    auto key_pos = *first + 1;
+    auto equal_pos = std::string::npos;
+    for (auto it = std::next(first); it != last; ++it) {
+      const auto c = request_line[*it];
+      if (c == '=' && equal_pos == std::string::npos) {
+        equal_pos = *it;
+      } else if (c == '&') {
+        add_query(key_pos, equal_pos, *it);
+        key_pos = *it + 1;
+        equal_pos = std::string::npos;
+      }
+    }
+    add_query(key_pos, equal_pos, *last);
+  }
+
+  constexpr static auto trim(std::string_view data) -> std::string_view {
+    constexpr auto whitespace = std::string_view{" \t"};
+    const auto begin = data.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos) {
+      return data.substr(data.size());
+    }
+    return data.substr(begin, data.find_last_not_of(whitespace) - begin + 1);
   }
 
  private:
   Method _method;
-  std::string _path;
-  std::unordered_map<std::string, std::string> _querys;
+  std::string_view _path;
+  std::string_view _target;
+  HttpFields _querys;
+  HttpFields _params;
   Version _version;
-  std::unordered_map<std::string, std::string> _headers;
-  std::string _body;
+  HttpFields _headers;
+  std::array<std::string_view, HTTP_HEADER_COUNT> _known_headers;
+  std::bitset<HTTP_HEADER_COUNT> _repeated_headers;
+  HttpFields _trailers;
+  std::string_view _body;
+  HttpScanner::Positions _positions;  // scratch space for the scanner
 };
 
 }  // namespace fz::http
@@ -1,109 +1,398 @@
 #ifndef __FZ_HTTP_HTTP_REQUEST_PARSE_H__
 #define __FZ_HTTP_HTTP_REQUEST_PARSE_H__
 
+#include <algorithm>
+#include <charconv>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
 
+#include "http/arena.h"
 #include "http/http_request.h"
+#include "http/type_define.h"
 #include "net/common/buffer.h"
 
 namespace fz::http {
 
+/**
+ * @brief Incremental request parser that works on the readable region of a
+ * net::Buffer in place. Bytes are only retrieved from the buffer once a whole
+ * request line, header block or body is available, and the scan position is
+ * kept between calls so a partial read never rescans from the beginning.
+ *
+ * Completed stages are copied once into an arena owned by the parser (one per
+ * connection), and the request keeps views into it until reset().
+ *
+ * Bodies are framed by Content-Length or by "Transfer-Encoding: chunked". A
+ * chunked body is decoded as chunks arrive into a buffer kept by the parser,
+ * and trailer fields end up in HttpRequest::trailers().
+ *
+ * A body can also be streamed instead of buffered: once the header block is
+ * parsed, the callback given to run() may call streamBody(), and the body is
+ * then handed to the consumer piece by piece as it arrives, without limit.
+ * Buffered bodies are limited by Limits::max_body_size, which is checked
+ * against Content-Length (or each chunk size) before any of the body is read.
+ */
 class HttpRequestParse {
  public:
   constexpr static auto MAX_REQUEST_LINE_SIZE = 4096;
+  constexpr static auto MAX_HEADERS_SIZE = 64 * 1024;
+  constexpr static auto MAX_CHUNK_SIZE_LINE_SIZE = 1024;
+  constexpr static auto MAX_BODY_SIZE = 8 * 1024 * 1024;
 
-  enum class Status : std::uint8_t { INVALID, RequestLine, Headers, Body, OK };
+  struct Limits {
+    std::size_t max_headers_size{MAX_HEADERS_SIZE};
+    std::size_t max_body_size{MAX_BODY_SIZE};
+  };
+
+  /**
+   * @brief Why the parser gave up on a request, so the server can answer
+   * with the matching status code.
+   */
+  enum class Error : std::uint8_t {
+    None,
+    BadRequest,
+    UriTooLong,
+    HeadersTooLarge,
+    BodyTooLarge,
+    // A transfer coding other than chunked.
+    NotImplemented
+  };
+
+  /**
+   * @brief Receives a streamed body: every piece as it arrives, then an empty
+   * view once the body is complete. Returning false pauses the parser after
+   * this piece until resume() is called.
+   */
+  using BodyConsumer = std::function<bool(std::string_view data)>;
+
+  enum class Status : std::uint8_t {
+    INVALID,
+    RequestLine,
+    Headers,
+    Body,
+    ChunkSize,
+    ChunkData,
+    Trailers,
+    OK
+  };
 
   auto status() const { return _status; }
 
+  auto error() const { return _error; }
+
+  auto& limits() const { return _limits; }
+
+  auto setLimits(const Limits& limits) -> void { _limits = limits; }
+
   auto& request() const { return _request; }
 
   auto& request() { return _request; }
 
   auto reset() {
     _status = Status::RequestLine;
+    _error = Error::None;
     _request.clear();
-    _data.clear();
-    _body_size = std::numeric_limits<std::size_t>::max();
+    _arena.reset();
+    _scan_pos = 0;
+    _body_size = 0;
+    _chunked_body.clear();
+    _body_consumer = nullptr;
+    _paused = false;
   }
 
-  auto markAsInvalid() {
+  auto markAsInvalid(Error error = Error::BadRequest) {
+    reset();
     _status = Status::INVALID;
-    _request.clear();
-    _data.clear();
-    _body_size = std::numeric_limits<std::size_t>::max();
+    _error = error;
   }
 
-  auto run(net::Buffer& buffer) {
-    if (buffer.empty()) {
+  /**
+   * @brief Stream the body of the current request to consumer instead of
+   * buffering it. Only valid from the callback passed to run().
+   */
+  auto streamBody(BodyConsumer consumer) -> void {
+    _body_consumer = std::move(consumer);
+  }
+
+  auto streaming() const { return static_cast<bool>(_body_consumer); }
+
+  auto paused() const { return _paused; }
+
+  auto resume() -> void { _paused = false; }
+
+  auto run(net::Buffer& buffer) { run(buffer, [](HttpRequest&) {}); }
+
+  /**
+   * @brief Parse what the buffer holds, calling on_headers(request) once the
+   * header block of a request is parsed and before its body is read.
+   */
+  template <typename OnHeaders>
+  auto run(net::Buffer& buffer, OnHeaders&& on_headers) -> void {
+    if (_paused || buffer.empty()) {
       return;
     }
 
-    if (status() == Status::INVALID || status() == Status::OK) {
+    if (status() == Status::INVALID) {
       buffer.retrieve(buffer.readableBytes());  // clear buffer
       return;
     }
 
-    _data += buffer.retrieveAllAsString();
-    while (parse()) {
+    // A finished request is waiting to be handled, anything left in the
+    // buffer belongs to the next one.
+    if (status() == Status::OK) {
+      return;
+    }
+
+    while (!_paused && parse(buffer, on_headers)) {
     }
   }
 
  private:
-  auto parse() -> bool {
+  /**
+   * @brief Find pattern in data, starting from the saved scan position. On
+   * failure the scan position is moved to the last offset where pattern could
+   * still begin once more bytes arrive.
+   */
+  auto scan(std::string_view data, std::string_view pattern)
+      -> std::string_view::size_type {
+    const auto pos = data.find(pattern, _scan_pos);
+    if (pos == std::string_view::npos) {
+      _scan_pos = pattern.size() <= data.size()
+                      ? data.size() - pattern.size() + 1
+                      : 0;
+    }
+    return pos;
+  }
+
+  template <typename OnHeaders>
+  auto parse(net::Buffer& buffer, OnHeaders& on_headers) -> bool {
+    const auto data = std::string_view{buffer.peek(), buffer.readableBytes()};
+
     switch (status()) {
       case Status::RequestLine: {
-        const auto bytes = _request.parseRequestLine(_data);
-        if (bytes == std::string::npos) {
-          if (MAX_REQUEST_LINE_SIZE < _data.size()) {
-            markAsInvalid();
+        // The limits are checked the same way whether the line is here in
+        // full or not, so where the input is split never changes the result.
+        const auto pos = scan(data, CRLF);
+        if (pos == std::string_view::npos) {
+          if (MAX_REQUEST_LINE_SIZE + CRLF.size() <= data.size()) {
+            markAsInvalid(Error::UriTooLong);
           }
 
           return false;
         }
 
-        _data.erase(0, bytes);
+        if (MAX_REQUEST_LINE_SIZE < pos) {
+          markAsInvalid(Error::UriTooLong);
+          return false;
+        }
+
+        const auto line_size = pos + CRLF.size();
+        const auto line = _arena.store(data.substr(0, line_size));
+        if (_request.parseRequestLine(line) != line_size) {
+          markAsInvalid();
+          return false;
+        }
+
+        buffer.retrieve(line_size);
+        _scan_pos = 0;
         _status = Status::Headers;
-        return !_data.empty();
+        return !buffer.empty();
       }
       case Status::Headers: {
-        const auto bytes = _request.parseHeaders(_data);
-        if (bytes == std::string::npos) {
+        constexpr auto end_of_headers = std::string_view{"\r\n\r\n"};
+
+        // The header block is terminated by an empty line, which is either
+        // right at the start (no headers) or follows the last header's CRLF.
+        auto block_size = std::string_view::size_type{0};
+        if (data.substr(0, CRLF.size()) != CRLF) {
+          const auto pos = scan(data, end_of_headers);
+          if (pos == std::string_view::npos) {
+            if (_limits.max_headers_size + CRLF.size() <= data.size()) {
+              markAsInvalid(Error::HeadersTooLarge);
+            }
+
+            return false;
+          }
+
+          block_size = pos + CRLF.size();
+        }
+
+        if (_limits.max_headers_size < block_size) {
+          markAsInvalid(Error::HeadersTooLarge);
           return false;
         }
 
-        if (bytes == 0) {
-          _status = Status::Body;
-          auto it = _request.headers().find("Content-Length");
-          if (it != _request.headers().end()) {
-            _body_size = std::stoul(it->second);
-          } else {
-            _body_size = 0;
+        if (block_size != 0) {
+          const auto block = _arena.store(data.substr(0, block_size));
+          if (_request.parseHeaders(block) != block_size) {
+            markAsInvalid();
+            return false;
           }
+        }
 
-          return !_data.empty();
+        const auto framing = parseFraming();
+        if (framing == Status::INVALID) {
+          markAsInvalid(_error);
+          return false;
         }
 
-        _data.erase(0, bytes);
-        return !_data.empty();
+        buffer.retrieve(block_size + CRLF.size());
+        _scan_pos = 0;
+        _status = framing;
+
+        on_headers(_request);
+        if (streaming() && framing == Status::OK) {
+          _body_consumer({});
+        }
+        if (!streaming() && framing == Status::Body &&
+            _limits.max_body_size < _body_size) {
+          markAsInvalid(Error::BodyTooLarge);
+          return false;
+        }
+        return true;
       }
       case Status::Body: {
-        if (_body_size == 0) {
+        if (streaming()) {
+          // Hand over whatever part of the body is here, the rest follows
+          // with later reads.
+          const auto size = std::min(data.size(), _body_size);
+          if (size != 0) {
+            _body_size -= size;
+            consumeBody(data.substr(0, size));
+            buffer.retrieve(size);
+          }
+
+          if (_body_size != 0) {
+            return false;
+          }
+
+          _paused = false;
+          _body_consumer({});
           _status = Status::OK;
           return false;
         }
 
-        if (!_data.empty() && _data.substr(0, 2) == CRLF) {
-          _data.erase(0, 2);
+        if (data.size() < _body_size) {
+          return false;
+        }
+
+        _request.setBody(_arena.store(data.substr(0, _body_size)));
+        buffer.retrieve(_body_size);
+        _status = Status::OK;
+        return false;
+      }
+      case Status::ChunkSize: {
+        // chunk-size [ chunk-ext ] CRLF
+        const auto pos = scan(data, CRLF);
+        if (pos == std::string_view::npos) {
+          if (MAX_CHUNK_SIZE_LINE_SIZE + CRLF.size() <= data.size()) {
+            markAsInvalid();
+          }
+
+          return false;
+        }
+
+        if (MAX_CHUNK_SIZE_LINE_SIZE < pos) {
+          markAsInvalid();
+          return false;
+        }
+
+        const auto line = data.substr(0, pos);
+        const auto size = line.substr(0, line.find(';'));
+        const auto* end = size.data() + size.size();
+        auto [ptr, ec] = std::from_chars(size.data(), end, _body_size, 16);
+        if (size.empty() || ec != std::errc{} || ptr != end ||
+            std::numeric_limits<std::size_t>::max() - CRLF.size() <
+                _body_size) {
+          markAsInvalid();
+          return false;
+        }
+
+        if (!streaming() && (_limits.max_body_size < _body_size ||
+                             _limits.max_body_size - _body_size <
+                                 _chunked_body.size())) {
+          markAsInvalid(Error::BodyTooLarge);
+          return false;
+        }
+
+        buffer.retrieve(pos + CRLF.size());
+        _scan_pos = 0;
+        _status = _body_size == 0 ? Status::Trailers : Status::ChunkData;
+        return true;
+      }
+      case Status::ChunkData: {
+        // The chunk data is taken as it arrives, _body_size counts what is
+        // still missing before the CRLF that closes the chunk.
+        if (_body_size != 0) {
+          const auto size = std::min(data.size(), _body_size);
+          if (size == 0) {
+            return false;
+          }
+
+          _body_size -= size;
+          if (streaming()) {
+            consumeBody(data.substr(0, size));
+          } else {
+            _chunked_body.append(data.substr(0, size));
+          }
+          buffer.retrieve(size);
+          return _body_size == 0 && !buffer.empty();
         }
 
-        if (_data.size() < _body_size) {
+        if (data.size() < CRLF.size()) {
           return false;
         }
 
-        _request.setBody(_data.substr(0, _body_size));
-        _data.clear();
+        if (data.substr(0, CRLF.size()) != CRLF) {
+          markAsInvalid();
+          return false;
+        }
+
+        buffer.retrieve(CRLF.size());
+        _status = Status::ChunkSize;
+        return true;
+      }
+      case Status::Trailers: {
+        // The last chunk is followed by optional trailer fields and an empty
+        // line, same as the header block.
+        auto block_size = std::string_view::size_type{0};
+        if (data.substr(0, CRLF.size()) != CRLF) {
+          const auto pos = scan(data, "\r\n\r\n");
+          if (pos == std::string_view::npos) {
+            if (_limits.max_headers_size + CRLF.size() <= data.size()) {
+              markAsInvalid(Error::HeadersTooLarge);
+            }
+
+            return false;
+          }
+
+          block_size = pos + CRLF.size();
+        }
+
+        if (_limits.max_headers_size < block_size) {
+          markAsInvalid(Error::HeadersTooLarge);
+          return false;
+        }
+
+        if (block_size != 0) {
+          const auto block = _arena.store(data.substr(0, block_size));
+          if (_request.parseTrailers(block) != block_size) {
+            markAsInvalid();
+            return false;
+          }
+        }
+
+        buffer.retrieve(block_size + CRLF.size());
+        _scan_pos = 0;
+        if (streaming()) {
+          _body_consumer({});
+        } else {
+          _request.setBody(_chunked_body);
+        }
         _status = Status::OK;
         return false;
       }
@@ -114,11 +403,87 @@ class HttpRequestParse {
     return false;
   }
 
+  auto consumeBody(std::string_view data) -> void {
+    if (!_body_consumer(data)) {
+      _paused = true;
+    }
+  }
+
+  /**
+   * @brief Decide how the body is framed.
+   *
+   * Repeated Transfer-Encoding fields are one list of codings, and repeated
+   * Content-Length fields (or a list in one) must all hold the same value
+   * (RFC 9112, 6.1 and 6.3), since a proxy in front may have framed the
+   * request by another one of them. Chunked is the only transfer coding
+   * implemented, a request with any other is refused with NotImplemented
+   * rather than having its coding ignored.
+   *
+   * @return Status::Body for Content-Length (or no body), Status::ChunkSize
+   * for chunked, Status::INVALID with error() set for a framing that can't
+   * be trusted: an unknown transfer coding, chunked more than once, a bad or
+   * ambiguous Content-Length, or both headers at once.
+   */
+  auto parseFraming() -> Status {
+    const auto invalid = [this](Error error = Error::BadRequest) {
+      _error = error;
+      return Status::INVALID;
+    };
+
+    _body_size = 0;
+    if (_request.hasHeader(HttpHeader::TransferEncoding)) {
+      if (_request.hasHeader(HttpHeader::ContentLength)) {
+        return invalid();
+      }
+
+      auto chunked = 0;
+      auto unknown = false;
+      _request.forEachHeaderElement(
+          HttpHeader::TransferEncoding, [&](std::string_view element) {
+            if (equalsIgnoreCase(element, "chunked")) {
+              ++chunked;
+            } else if (!element.empty()) {
+              unknown = true;
+            }
+          });
+      if (unknown) {
+        return invalid(Error::NotImplemented);
+      }
+      return chunked == 1 ? Status::ChunkSize : invalid();
+    }
+
+    if (!_request.hasHeader(HttpHeader::ContentLength)) {
+      return Status::Body;
+    }
+
+    auto valid = true;
+    auto first = true;
+    _request.forEachHeaderElement(
+        HttpHeader::ContentLength, [&](std::string_view element) {
+          auto size = std::size_t{0};
+          const auto* end = element.data() + element.size();
+          auto [ptr, ec] = std::from_chars(element.data(), end, size);
+          if (ec != std::errc{} || ptr != end || element.empty() ||
+              (!first && size != _body_size)) {
+            valid = false;
+          }
+          _body_size = size;
+          first = false;
+        });
+    return valid ? Status::Body : invalid();
+  }
+
  private:
   Status _status{Status::RequestLine};
+  Error _error{Error::None};
+  Limits _limits;
   HttpRequest _request;
-  std::string _data;
-  std::size_t _body_size{std::numeric_limits<std::size_t>::max()};
+  Arena _arena;
+  std::size_t _scan_pos{0};
+  std::size_t _body_size{0};
+  std::string _chunked_body;
+  BodyConsumer _body_consumer;
+  bool _paused{false};
 };
 
 }  // namespace fz::http
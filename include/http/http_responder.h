@@ -0,0 +1,334 @@
+#ifndef __FZ_HTTP_HTTP_RESPONDER_H__
+#define __FZ_HTTP_HTTP_RESPONDER_H__
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "http/http_compression.h"
+#include "http/http_metrics.h"
+#include "http/http_response.h"
+#include "http/http_response_cache.h"
+#include "http/http_session.h"
+#include "http/http_validators.h"
+
+namespace fz::http {
+
+/**
+ * @brief Body of a response started with HttpResponder::stream(). Every
+ * call may come from any thread and is posted to the session's loop, in
+ * order. A stream destroyed before finish() is aborted.
+ */
+class HttpResponseStream {
+ public:
+  HttpResponseStream() = default;
+
+  HttpResponseStream(std::weak_ptr<HttpSession> session, std::uint64_t slot)
+      : _session{std::move(session)}, _slot{slot} {}
+
+  HttpResponseStream(const HttpResponseStream&) = delete;
+
+  HttpResponseStream(HttpResponseStream&& other) noexcept
+      : _session{std::move(other._session)}, _slot{other._slot} {
+    other._session.reset();
+  }
+
+  auto operator=(const HttpResponseStream&) -> HttpResponseStream& = delete;
+
+  auto operator=(HttpResponseStream&& other) noexcept
+      -> HttpResponseStream& {
+    if (this != &other) {
+      abort();
+      _session = std::move(other._session);
+      _slot = other._slot;
+      other._session.reset();
+    }
+    return *this;
+  }
+
+  ~HttpResponseStream() { abort(); }
+
+  auto write(std::string_view data) const -> void {
+    if (auto session = _session.lock(); session && !data.empty()) {
+      session->post([session, slot = _slot, data = std::string{data}]() {
+        session->appendStreamed(slot, data);
+        session->flushLater();
+      });
+    }
+  }
+
+  auto finish() -> void {
+    auto session = _session.lock();
+    _session.reset();
+    if (session) {
+      session->post([session, slot = _slot]() {
+        session->endStreamed(slot);
+        session->flushLater();
+        session->updateTimer();
+      });
+    }
+  }
+
+  /**
+   * @brief See HttpResponder::resumeBody(), which no longer works once the
+   * responder started the stream.
+   */
+  auto resumeBody() const -> void {
+    if (auto session = _session.lock()) {
+      session->post([session]() { session->resumeReading(); });
+    }
+  }
+
+  /**
+   * @brief End the response without completing its body, which closes the
+   * connection after what was sent of it.
+   */
+  auto abort() -> void {
+    auto session = _session.lock();
+    _session.reset();
+    if (session) {
+      session->post([session, slot = _slot]() {
+        session->abortStreamed(slot);
+        session->flushLater();
+      });
+    }
+  }
+
+ private:
+  std::weak_ptr<HttpSession> _session;
+  std::uint64_t _slot{0};
+};
+
+/**
+ * @brief Completes one request handled by an async handler. send() may be
+ * called from any thread, the response is posted back to the session's loop
+ * and written in request order.
+ *
+ * A responder destroyed without sending answers 500, so a forgotten
+ * response can't stall the requests pipelined behind it.
+ *
+ * With compression enabled on the server, the response is compressed by the
+ * thread calling send(), which keeps that work off the loop for offloaded
+ * handlers. The same goes for serializing a response into the cache.
+ */
+class HttpResponder {
+ public:
+  HttpResponder(std::weak_ptr<HttpSession> session, std::uint64_t slot,
+                std::string_view server,
+                HttpCompression* compression = nullptr,
+                HttpCompression::Coding coding = {})
+      : _session{std::move(session)},
+        _slot{slot},
+        _server{server},
+        _compression{compression},
+        _coding{coding} {}
+
+  HttpResponder(const HttpResponder&) = delete;
+
+  HttpResponder(HttpResponder&& other) noexcept
+      : _session{std::move(other._session)},
+        _slot{other._slot},
+        _server{other._server},
+        _compression{other._compression},
+        _coding{other._coding},
+        _cache{other._cache},
+        _cache_shard{other._cache_shard},
+        _cache_key{std::move(other._cache_key)},
+        _cache_ttl{other._cache_ttl},
+        _metrics{other._metrics},
+        _route{other._route},
+        _start{other._start},
+        _validators{std::move(other._validators)},
+        _omit_body{other._omit_body} {
+    other._session.reset();
+  }
+
+  auto operator=(const HttpResponder&) -> HttpResponder& = delete;
+
+  auto operator=(HttpResponder&& other) noexcept -> HttpResponder& {
+    if (this != &other) {
+      finish();
+      _session = std::move(other._session);
+      _slot = other._slot;
+      _server = other._server;
+      _compression = other._compression;
+      _coding = other._coding;
+      _cache = other._cache;
+      _cache_shard = other._cache_shard;
+      _cache_key = std::move(other._cache_key);
+      _cache_ttl = other._cache_ttl;
+      _metrics = other._metrics;
+      _route = other._route;
+      _start = other._start;
+      _validators = std::move(other._validators);
+      _omit_body = other._omit_body;
+      other._session.reset();
+    }
+    return *this;
+  }
+
+  ~HttpResponder() { finish(); }
+
+  /**
+   * @brief Store the response in cache under key when it is cacheable, in
+   * the shard the calling loop looks in, whichever thread sends it.
+   */
+  auto cacheAs(HttpResponseCache* cache, std::string key,
+               std::chrono::milliseconds ttl) -> void {
+    _cache = cache;
+    _cache_shard = cache->shardOf(key);
+    _cache_key = std::move(key);
+    _cache_ttl = ttl;
+  }
+
+  /**
+   * @brief Count the response in metrics under route, with the time since
+   * start as its latency.
+   */
+  auto recordIn(HttpMetrics* metrics, std::string_view route,
+                HttpMetrics::Clock::time_point start) -> void {
+    _metrics = metrics;
+    _route = route;
+    _start = start;
+  }
+
+  /**
+   * @brief Add validators to a 200 response that doesn't set its own.
+   */
+  auto validateWith(HttpValidators validators) -> void {
+    _validators = std::move(validators);
+  }
+
+  /**
+   * @brief Send the head of the response only, for a HEAD request.
+   */
+  auto omitBody() -> void { _omit_body = true; }
+
+  /**
+   * @brief The client's address, empty if unknown (see
+   * HttpSession::peerAddress()). Must run on the session's loop.
+   */
+  auto peerAddress() const -> std::string {
+    auto session = _session.lock();
+    return session ? session->peerAddress() : std::string{};
+  }
+
+  /**
+   * @brief Resume reading a streamed request body after its consumer
+   * returned false.
+   */
+  auto resumeBody() const -> void {
+    if (auto session = _session.lock()) {
+      session->post([session]() { session->resumeReading(); });
+    }
+  }
+
+  /**
+   * @brief Send the head of response now and its body through the returned
+   * stream, as it becomes available. The body of response itself is
+   * ignored; it is sent as is when response declares a Content-Length with
+   * setContentLength(), chunked otherwise. Streamed responses are neither
+   * compressed nor cached.
+   */
+  auto stream(HttpResponse response) -> HttpResponseStream {
+    auto session = _session.lock();
+    _session.reset();
+    if (!session) {
+      return {};
+    }
+
+    if (_metrics != nullptr) {
+      _metrics->response(_route, response.statusCode(),
+                         HttpMetrics::Clock::now() - _start);
+    }
+
+    if (response.statusCode() == HttpResponse::OK) {
+      _validators.addTo(response);
+    }
+    if (_omit_body) {
+      // Keep the framing the body would have had.
+      if (!response.hasContentLength()) {
+        response.setChunkedBody([](HttpChunkedWriter&) { return false; });
+      }
+      response.omitBody();
+    }
+
+    session->post([session, slot = _slot, server = _server,
+                   response = std::move(response)]() mutable {
+      session->beginStreamed(slot, std::move(response), server);
+      session->flushLater();
+    });
+    return HttpResponseStream{session, _slot};
+  }
+
+  auto send(HttpResponse response) -> void {
+    auto session = _session.lock();
+    _session.reset();
+    if (!session) {
+      return;  // already sent, or the connection is gone
+    }
+
+    if (response.statusCode() == HttpResponse::OK) {
+      _validators.addTo(response);
+    }
+    if (_compression != nullptr) {
+      _compression->apply(_coding, response);
+    }
+    if (_omit_body) {
+      response.omitBody();
+    }
+
+    if (_metrics != nullptr) {
+      _metrics->response(_route, response.statusCode(),
+                         HttpMetrics::Clock::now() - _start);
+    }
+
+    if (_cache != nullptr && HttpResponseCache::cacheable(response)) {
+      auto bytes = std::make_shared<std::string>();
+      response.serialize(*bytes, _server);
+      _cache->insert(_cache_shard, std::move(_cache_key), bytes, _cache_ttl);
+      session->post([session, slot = _slot, bytes = std::move(bytes)]() {
+        session->completeSerialized(slot, bytes);
+        session->flushLater();
+        session->updateTimer();
+      });
+      return;
+    }
+
+    session->post([session, slot = _slot, server = _server,
+                   response = std::move(response)]() mutable {
+      session->completeResponse(slot, std::move(response), server);
+      session->flushLater();
+      session->updateTimer();
+    });
+  }
+
+ private:
+  auto finish() -> void {
+    if (!_session.expired()) {
+      send(HttpResponse::makeInternalServerError());
+    }
+  }
+
+  std::weak_ptr<HttpSession> _session;
+  std::uint64_t _slot;
+  std::string_view _server;
+  HttpCompression* _compression;
+  HttpCompression::Coding _coding;
+  HttpResponseCache* _cache{nullptr};
+  std::size_t _cache_shard{0};
+  std::string _cache_key;
+  std::chrono::milliseconds _cache_ttl{0};
+  HttpMetrics* _metrics{nullptr};
+  std::string_view _route;
+  HttpMetrics::Clock::time_point _start;
+  HttpValidators _validators;
+  bool _omit_body{false};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_RESPONDER_H__
@@ -1,11 +1,21 @@
 #ifndef __FZ_HTTP_HTTP_RESPONSE_H__
 #define __FZ_HTTP_HTTP_RESPONSE_H__
 
+#include <array>
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
-#include <sstream>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "http/http_chunked_writer.h"
+#include "http/http_date.h"
+#include "http/http_header.h"
 #include "http/type_define.h"
 
 namespace fz::http {
@@ -14,11 +24,35 @@ class HttpResponse {
  public:
   enum StatusCode : std::uint16_t {
     UNKNOW = 0,
+    SWITCHING_PROTOCOLS = 101,
     OK = 200,
+    CREATED = 201,
+    ACCEPTED = 202,
+    NO_CONTENT = 204,
+    PARTIAL_CONTENT = 206,
     MOVED_PERMANENTLY = 301,
+    FOUND = 302,
+    SEE_OTHER = 303,
+    NOT_MODIFIED = 304,
+    TEMPORARY_REDIRECT = 307,
+    PERMANENT_REDIRECT = 308,
     BAD_REQUEST = 400,
+    UNAUTHORIZED = 401,
+    FORBIDDEN = 403,
     NOT_FOUND = 404,
-    METHOD_NOT_ALLOWED = 405
+    METHOD_NOT_ALLOWED = 405,
+    REQUEST_TIMEOUT = 408,
+    CONFLICT = 409,
+    PAYLOAD_TOO_LARGE = 413,
+    URI_TOO_LONG = 414,
+    RANGE_NOT_SATISFIABLE = 416,
+    TOO_MANY_REQUESTS = 429,
+    REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
+    INTERNAL_SERVER_ERROR = 500,
+    NOT_IMPLEMENTED = 501,
+    BAD_GATEWAY = 502,
+    SERVICE_UNAVAILABLE = 503,
+    GATEWAY_TIMEOUT = 504
   };
 
   enum Version : std::uint8_t { UNKNOWN, HTTP_1_0, HTTP_1_1 };
@@ -34,19 +68,98 @@ class HttpResponse {
     }
   }
 
+  constexpr static auto STATUS_CODES =
+      std::array{SWITCHING_PROTOCOLS,
+                 OK,
+                 CREATED,
+                 ACCEPTED,
+                 NO_CONTENT,
+                 PARTIAL_CONTENT,
+                 MOVED_PERMANENTLY,
+                 FOUND,
+                 SEE_OTHER,
+                 NOT_MODIFIED,
+                 TEMPORARY_REDIRECT,
+                 PERMANENT_REDIRECT,
+                 BAD_REQUEST,
+                 UNAUTHORIZED,
+                 FORBIDDEN,
+                 NOT_FOUND,
+                 METHOD_NOT_ALLOWED,
+                 REQUEST_TIMEOUT,
+                 CONFLICT,
+                 PAYLOAD_TOO_LARGE,
+                 URI_TOO_LONG,
+                 RANGE_NOT_SATISFIABLE,
+                 TOO_MANY_REQUESTS,
+                 REQUEST_HEADER_FIELDS_TOO_LARGE,
+                 INTERNAL_SERVER_ERROR,
+                 NOT_IMPLEMENTED,
+                 BAD_GATEWAY,
+                 SERVICE_UNAVAILABLE,
+                 GATEWAY_TIMEOUT};
+
   constexpr static auto statusCodeToString(StatusCode status_code)
       -> std::string_view {
     switch (status_code) {
+      case SWITCHING_PROTOCOLS:
+        return "Switching Protocols";
       case OK:
         return "OK";
+      case CREATED:
+        return "Created";
+      case ACCEPTED:
+        return "Accepted";
+      case NO_CONTENT:
+        return "No Content";
+      case PARTIAL_CONTENT:
+        return "Partial Content";
       case MOVED_PERMANENTLY:
         return "Moved Permanently";
+      case FOUND:
+        return "Found";
+      case SEE_OTHER:
+        return "See Other";
+      case NOT_MODIFIED:
+        return "Not Modified";
+      case TEMPORARY_REDIRECT:
+        return "Temporary Redirect";
+      case PERMANENT_REDIRECT:
+        return "Permanent Redirect";
       case BAD_REQUEST:
         return "Bad Request";
+      case UNAUTHORIZED:
+        return "Unauthorized";
+      case FORBIDDEN:
+        return "Forbidden";
       case NOT_FOUND:
         return "Not Found";
       case METHOD_NOT_ALLOWED:
         return "Method Not Allowed";
+      case REQUEST_TIMEOUT:
+        return "Request Timeout";
+      case CONFLICT:
+        return "Conflict";
+      case PAYLOAD_TOO_LARGE:
+        return "Payload Too Large";
+      case URI_TOO_LONG:
+        return "URI Too Long";
+      case RANGE_NOT_SATISFIABLE:
+        return "Range Not Satisfiable";
+      case TOO_MANY_REQUESTS:
+        return "Too Many Requests";
+      case REQUEST_HEADER_FIELDS_TOO_LARGE:
+        return "Request Header Fields Too Large";
+      case INTERNAL_SERVER_ERROR:
+        return "Internal Server Error";
+      case NOT_IMPLEMENTED:
+        return "Not Implemented";
+      case BAD_GATEWAY:
+        return "Bad Gateway";
+      case SERVICE_UNAVAILABLE:
+        return "Service Unavailable";
+      case GATEWAY_TIMEOUT:
+        return "Gateway Timeout";
       default:
         return "Unknow";
     }
@@ -56,7 +169,6 @@ class HttpResponse {
     auto response = HttpResponse{};
     response.setVersion(HTTP_1_1);
     response.setStatusCode(OK);
-    response.addHeader("Content-Length", "0");
     return response;
   }
 
@@ -67,11 +179,17 @@ class HttpResponse {
     return response;
   }
 
+  static auto makeNotModified() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(NOT_MODIFIED);
+    return response;
+  }
+
   static auto makeBadRequest() -> HttpResponse {
     auto response = HttpResponse{};
     response.setStatusCode(BAD_REQUEST);
     response.setVersion(HTTP_1_1);
-    response.addHeader("Content-Length", "0");
     return response;
   }
 
@@ -79,7 +197,6 @@ class HttpResponse {
     auto response = HttpResponse{};
     response.setVersion(HTTP_1_1);
     response.setStatusCode(NOT_FOUND);
-    response.addHeader("Content-Length", "0");
     return response;
   }
 
@@ -87,7 +204,62 @@ class HttpResponse {
     auto response = HttpResponse{};
     response.setVersion(HTTP_1_1);
     response.setStatusCode(METHOD_NOT_ALLOWED);
-    response.addHeader("Content-Length", "0");
+    return response;
+  }
+
+  static auto makeRequestTimeout() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(REQUEST_TIMEOUT);
+    return response;
+  }
+
+  static auto makePayloadTooLarge() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(PAYLOAD_TOO_LARGE);
+    return response;
+  }
+
+  static auto makeUriTooLong() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(URI_TOO_LONG);
+    return response;
+  }
+
+  static auto makeRequestHeaderFieldsTooLarge() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(REQUEST_HEADER_FIELDS_TOO_LARGE);
+    return response;
+  }
+
+  static auto makeInternalServerError() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(INTERNAL_SERVER_ERROR);
+    return response;
+  }
+
+  static auto makeNotImplemented() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(NOT_IMPLEMENTED);
+    return response;
+  }
+
+  static auto makeBadGateway() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(BAD_GATEWAY);
+    return response;
+  }
+
+  static auto makeGatewayTimeout() -> HttpResponse {
+    auto response = HttpResponse{};
+    response.setVersion(HTTP_1_1);
+    response.setStatusCode(GATEWAY_TIMEOUT);
     return response;
   }
 
@@ -102,37 +274,321 @@ class HttpResponse {
     _status_code = status_code;
   }
 
+  /**
+   * @brief Reason phrase of the status line, empty unless set.
+   */
+  auto reason() const -> std::string_view { return _reason; }
+
+  /**
+   * @brief Write reason instead of the standard phrase of the status code,
+   * e.g. to pass on what an upstream server sent with a code this class
+   * doesn't know. An empty reason restores the standard phrase.
+   */
+  auto setReason(std::string_view reason) -> void { _reason = reason; }
+
   auto& headers() const { return _headers; }
 
+  /**
+   * @brief Value of a header (case-insensitive), empty if not set.
+   */
+  auto header(std::string_view key) const -> std::string_view {
+    for (const auto& [name, value] : _headers) {
+      if (equalsIgnoreCase(name, key)) {
+        return value;
+      }
+    }
+    return {};
+  }
+
+  /**
+   * @brief Set a header, replacing any header with the same name. Headers
+   * are written in the order they were first added.
+   *
+   * Content-Length is derived from the body during serialization, so setting
+   * it here is ignored. Date is filled in automatically unless set here.
+   */
   auto addHeader(std::string_view key, std::string_view value) -> void {
-    _headers[std::string{key}] = std::string{value};
+    switch (headerFromString(key)) {
+      case HttpHeader::ContentLength:
+        return;
+      case HttpHeader::Date:
+        _has_date = true;
+        break;
+      case HttpHeader::Server:
+        _has_server = true;
+        break;
+      case HttpHeader::Connection:
+        _close = equalsIgnoreCase(value, "close");
+        break;
+      default:
+        break;
+    }
+
+    for (auto& [name, old_value] : _headers) {
+      if (equalsIgnoreCase(name, key)) {
+        old_value = value;
+        return;
+      }
+    }
+    _headers.emplace_back(key, value);
   }
 
-  auto& body() const { return _body; }
+  /**
+   * @brief Add a header line after any with the same name instead of
+   * replacing them, for fields that can't be joined into a comma separated
+   * list, i.e. Set-Cookie (RFC 9110 section 5.3). header() returns the
+   * first of them.
+   */
+  auto appendHeader(std::string_view key, std::string_view value) -> void {
+    for (const auto& [name, old_value] : _headers) {
+      if (equalsIgnoreCase(name, key)) {
+        _headers.emplace_back(key, value);
+        return;
+      }
+    }
+    addHeader(key, value);
+  }
 
-  auto setBody(std::string_view body) -> void { _body = body; }
+  /**
+   * @brief Whether the response carries "Connection: close", after which
+   * the server closes the connection.
+   */
+  auto closesConnection() const { return _close; }
 
-  auto toString() const -> std::string {
-    auto ss = std::stringstream{};
-    ss << versionToString(_version) << SPACE << statusCode() << SPACE
-       << statusCodeToString(_status_code) << CRLF;
+  /**
+   * @brief Content-Length written for this response: the body size, unless
+   * it was overridden with setContentLength().
+   */
+  auto contentLength() const {
+    return _content_length != NO_CONTENT_LENGTH ? _content_length
+                                                : body().size();
+  }
+
+  /**
+   * @brief Declare a Content-Length that differs from the body actually
+   * sent. Only meant for responses whose body is omitted on the wire.
+   */
+  auto setContentLength(std::size_t length) -> void {
+    _content_length = length;
+  }
+
+  /**
+   * @brief Whether a Content-Length was declared with setContentLength().
+   */
+  auto hasContentLength() const -> bool {
+    return _content_length != NO_CONTENT_LENGTH;
+  }
+
+  auto body() const -> std::string_view {
+    return _body_owner ? _body_view : std::string_view{_body};
+  }
+
+  auto setBody(std::string_view body) -> void {
+    _body = body;
+    _body_view = {};
+    _body_owner.reset();
+  }
+
+  /**
+   * @brief Send body without copying it into the response. owner keeps the
+   * bytes alive until the response has been serialized, e.g. a cached file
+   * mapping.
+   */
+  auto setBody(std::string_view body, std::shared_ptr<const void> owner)
+      -> void {
+    _body.clear();
+    _body_view = body;
+    _body_owner = std::move(owner);
+  }
+
+  /**
+   * @brief Called repeatedly to produce the body chunk by chunk, returns
+   * false once the body is complete.
+   */
+  using BodyProducer = std::function<bool(HttpChunkedWriter& writer)>;
+
+  /**
+   * @brief Send the body with "Transfer-Encoding: chunked". The session
+   * serializes the head, then calls producer until it returns false and
+   * writes the last chunk. The calls are made on the connection's loop in
+   * batches of about 64 KiB, one batch per turn of the loop, so other
+   * connections are served in between. The body set with setBody() is
+   * ignored.
+   */
+  auto setChunkedBody(BodyProducer producer) -> void {
+    _body_producer = std::move(producer);
+  }
+
+  auto isChunked() const -> bool {
+    return static_cast<bool>(_body_producer);
+  }
+
+  /**
+   * @brief Send the head only, as the answer to a HEAD request. It keeps the
+   * Content-Length or Transfer-Encoding the body would have had, but the
+   * body is dropped and a chunked one is never produced.
+   */
+  auto omitBody() -> void {
+    if (!isChunked() && !hasContentLength()) {
+      _content_length = body().size();
+    }
+    setBody({});
+    _body_omitted = true;
+  }
+
+  auto bodyOmitted() const -> bool { return _body_omitted; }
+
+  auto& bodyProducer() const { return _body_producer; }
+
+  auto produceBody(HttpChunkedWriter& writer) const -> bool {
+    return _body_producer && _body_producer(writer);
+  }
+
+  /**
+   * @brief 1xx, 204 and 304 responses never carry a body or Content-Length.
+   */
+  auto hasBody() const -> bool {
+    const auto code = static_cast<std::uint16_t>(_status_code);
+    return 200 <= code && code != NO_CONTENT && code != NOT_MODIFIED;
+  }
+
+  /**
+   * @brief Append the serialized response to out, which can be anything with
+   * append(const char*, std::size_t), e.g. std::string or net::Buffer.
+   *
+   * @param server value of the Server header, written unless the response
+   * sets its own. Nothing is written when empty.
+   *
+   * For a chunked response only the head is written, see setChunkedBody().
+   */
+  template <typename Output>
+  auto serialize(Output& out, std::string_view server = {}) const -> void {
+    const auto status_line =
+        _reason.empty() ? statusLine(_version, _status_code)
+                        : std::string_view{};
+    if (!status_line.empty()) {
+      append(out, status_line);
+    } else {
+      append(out, versionToString(_version));
+      append(out, SPACE);
+      appendNumber(out, static_cast<std::uint16_t>(_status_code));
+      append(out, SPACE);
+      append(out, _reason.empty() ? statusCodeToString(_status_code)
+                                  : std::string_view{_reason});
+      append(out, CRLF);
+    }
+
+    if (hasBody() && isChunked()) {
+      append(out, headerToString(HttpHeader::TransferEncoding));
+      append(out, COLON);
+      append(out, "chunked");
+      append(out, CRLF);
+    } else if (hasBody()) {
+      append(out, headerToString(HttpHeader::ContentLength));
+      append(out, COLON);
+      appendNumber(out, contentLength());
+      append(out, CRLF);
+    }
+
+    if (!_has_date) {
+      append(out, headerToString(HttpHeader::Date));
+      append(out, COLON);
+      append(out, HttpDate::now());
+      append(out, CRLF);
+    }
+
+    if (!_has_server && !server.empty()) {
+      append(out, headerToString(HttpHeader::Server));
+      append(out, COLON);
+      append(out, server);
+      append(out, CRLF);
+    }
 
     for (const auto& [key, value] : _headers) {
-      ss << key << COLON << value << CRLF;
+      append(out, key);
+      append(out, COLON);
+      append(out, value);
+      append(out, CRLF);
+    }
+    append(out, CRLF);
+
+    if (hasBody() && !isChunked()) {
+      append(out, body());
+    }
+  }
+
+  auto toString() const -> std::string {
+    auto str = std::string{};
+    serialize(str);
+    return str;
+  }
+
+  /**
+   * @brief Cached "HTTP-Version SP Status-Code SP Reason-Phrase CRLF", or an
+   * empty view for a status code without a cached line.
+   */
+  static auto statusLine(Version version, StatusCode status_code)
+      -> std::string_view {
+    static const auto lines = [] {
+      auto lines = std::array<std::array<std::string, STATUS_CODES.size()>,
+                              HTTP_1_1 + 1>{};
+      for (auto version : {UNKNOWN, HTTP_1_0, HTTP_1_1}) {
+        for (std::size_t i = 0; i < STATUS_CODES.size(); ++i) {
+          auto& line = lines[version][i];
+          line += versionToString(version);
+          line += SPACE;
+          appendNumber(line, static_cast<std::uint16_t>(STATUS_CODES[i]));
+          line += SPACE;
+          line += statusCodeToString(STATUS_CODES[i]);
+          line += CRLF;
+        }
+      }
+      return lines;
+    }();
+
+    if (HTTP_1_1 < version) {
+      return {};
     }
-    ss << CRLF;
 
-    ss << _body;
+    for (std::size_t i = 0; i < STATUS_CODES.size(); ++i) {
+      if (STATUS_CODES[i] == status_code) {
+        return lines[version][i];
+      }
+    }
+    return {};
+  }
+
+ private:
+  constexpr static auto NO_CONTENT_LENGTH =
+      std::numeric_limits<std::size_t>::max();
+
+  template <typename Output>
+  static auto append(Output& out, std::string_view data) -> void {
+    out.append(data.data(), data.size());
+  }
 
-    return ss.str();
+  template <typename Output, typename T>
+  static auto appendNumber(Output& out, T value) -> void {
+    auto digits = std::array<char, std::numeric_limits<T>::digits10 + 1>{};
+    auto [ptr, ec] =
+        std::to_chars(digits.data(), digits.data() + digits.size(), value);
+    out.append(digits.data(), static_cast<std::size_t>(ptr - digits.data()));
   }
 
  private:
   Version _version{UNKNOWN};
   StatusCode _status_code{UNKNOW};
-  std::unordered_map<std::string, std::string> _headers;
+  std::string _reason;
+  std::size_t _content_length{NO_CONTENT_LENGTH};
+  bool _has_date{false};
+  bool _has_server{false};
+  bool _close{false};
+  bool _body_omitted{false};
+  std::vector<std::pair<std::string, std::string>> _headers;
   std::string _body;
-  std::string _status_message;
+  std::string_view _body_view;
+  std::shared_ptr<const void> _body_owner;
+  BodyProducer _body_producer;
 };
 
 }  // namespace fz::http
@@ -0,0 +1,119 @@
+#ifndef __FZ_HTTP_HTTP_RESPONSE_CACHE_H__
+#define __FZ_HTTP_HTTP_RESPONSE_CACHE_H__
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "http/http_request.h"
+#include "http/http_response.h"
+#include "http/loop_local.h"
+
+namespace fz::http {
+
+/**
+ * @brief Serialized responses of cacheable routes, so a hit is written to the
+ * connection without running the handler or serializing anything.
+ *
+ * Entries expire after the TTL of their route and are evicted least recently
+ * used first once the cache is over its memory cap. The cache is split into
+ * shards with a lock each, picked by the hash of the key, so loop threads
+ * rarely wait on each other. With Options::per_thread every thread keeps to
+ * shards of its own instead.
+ *
+ * The cached bytes are the response as first written, Date included.
+ */
+class HttpResponseCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    std::size_t max_bytes{std::size_t{64} << 20};
+    std::size_t shards{16};
+    // Give each thread its own shard rather than picking one by key, so no
+    // two loops touch the same entries or lock, at the cost of every loop
+    // caching its own copy of a response. Threads share shards once there
+    // are more of them than shards.
+    bool per_thread{false};
+  };
+
+  /**
+   * @brief Which requests share a cached response: same method and path,
+   * and the same values of the listed query parameters and headers.
+   * Anything else in the request is ignored.
+   */
+  struct Policy {
+    std::chrono::milliseconds ttl{std::chrono::seconds{1}};
+    std::vector<std::string> query;
+    std::vector<std::string> headers;
+  };
+
+  HttpResponseCache() : HttpResponseCache{Options{}} {}
+
+  explicit HttpResponseCache(Options options);
+
+  ~HttpResponseCache();
+
+  HttpResponseCache(const HttpResponseCache&) = delete;
+
+  auto operator=(const HttpResponseCache&) -> HttpResponseCache& = delete;
+
+  /**
+   * @brief Key of request under policy. extra is appended as is, for
+   * whatever else the response depends on (e.g. the content coding).
+   */
+  static auto makeKey(const HttpRequest& request, const Policy& policy,
+                      std::string_view extra = {}) -> std::string;
+
+  /**
+   * @brief Whether a response may be stored: a complete 200 that doesn't
+   * set cookies, close the connection or forbid caching.
+   */
+  static auto cacheable(const HttpResponse& response) -> bool;
+
+  /**
+   * @brief The bytes stored under key, null if missing or expired.
+   */
+  auto find(std::string_view key) -> std::shared_ptr<const std::string>;
+
+  auto insert(std::string key, std::shared_ptr<const std::string> bytes,
+              Clock::duration ttl) -> void {
+    const auto shard = shardOf(key);
+    insert(shard, std::move(key), std::move(bytes), ttl);
+  }
+
+  /**
+   * @brief The shard find(key) looks in on the calling thread. A response
+   * made on another thread on behalf of a loop (offloaded, or relayed by the
+   * client) is inserted into the shard of that loop, taken beforehand on
+   * the loop, or with Options::per_thread the loop would never find it.
+   */
+  auto shardOf(std::string_view key) const -> std::size_t;
+
+  auto insert(std::size_t shard, std::string key,
+              std::shared_ptr<const std::string> bytes, Clock::duration ttl)
+      -> void;
+
+  auto size() const -> std::size_t;
+
+  auto bytes() const -> std::size_t;
+
+ private:
+  struct Shard;
+
+
+  Options _options;
+  std::vector<std::unique_ptr<Shard>> _shards;
+  // Index of the calling thread, for Options::per_thread.
+  mutable LoopLocal<std::size_t> _thread_index;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_RESPONSE_CACHE_H__
@@ -0,0 +1,510 @@
+#ifndef __FZ_HTTP_HTTP_RESPONSE_PARSE_H__
+#define __FZ_HTTP_HTTP_RESPONSE_PARSE_H__
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "http/http_header.h"
+#include "http/http_response.h"
+#include "http/type_define.h"
+#include "net/common/buffer.h"
+
+namespace fz::http {
+
+/**
+ * @brief Incremental response parser, the client side mirror of
+ * HttpRequestParse: it works on the readable region of a net::Buffer in
+ * place, retrieves a stage from the buffer once it is complete and keeps the
+ * scan position between calls.
+ *
+ * The parsed response is an HttpResponse with the headers as received (a
+ * repeated header is joined with ", ", except Set-Cookie, whose lines are
+ * kept apart) and the body decoded and stored once, shared with the
+ * response instead of copied into it. Content-Length and Transfer-Encoding
+ * describe the message on the wire and are not kept.
+ *
+ * Bodies are framed by Content-Length, "Transfer-Encoding: chunked" or the
+ * end of the connection, see finish(). Responses to HEAD requests carry no
+ * body whatever their headers say, which the parser has to be told with
+ * expectNoBody(). Interim 1xx responses are skipped. A declared
+ * Content-Length is kept with HttpResponse::setContentLength().
+ *
+ * As with HttpRequestParse, the callback given to run() may call
+ * streamBody() once the headers are parsed, to have the body handed over
+ * piece by piece instead of stored, without limit.
+ */
+class HttpResponseParse {
+ public:
+  constexpr static auto MAX_STATUS_LINE_SIZE = 4096;
+  constexpr static auto MAX_HEADERS_SIZE = 64 * 1024;
+  constexpr static auto MAX_CHUNK_SIZE_LINE_SIZE = 1024;
+  constexpr static auto MAX_BODY_SIZE = 64 * 1024 * 1024;
+
+  struct Limits {
+    std::size_t max_headers_size{MAX_HEADERS_SIZE};
+    std::size_t max_body_size{MAX_BODY_SIZE};
+  };
+
+  /**
+   * @brief Receives a streamed body: every piece as it arrives, then an empty
+   * view once the body is complete.
+   */
+  using BodyConsumer = std::function<void(std::string_view data)>;
+
+  enum class Status : std::uint8_t {
+    INVALID,
+    StatusLine,
+    Headers,
+    Body,
+    BodyUntilClose,
+    ChunkSize,
+    ChunkData,
+    Trailers,
+    OK
+  };
+
+  auto status() const { return _status; }
+
+  auto& limits() const { return _limits; }
+
+  auto setLimits(const Limits& limits) -> void { _limits = limits; }
+
+  auto& response() const { return _response; }
+
+  auto& response() { return _response; }
+
+  auto reset() -> void {
+    _status = Status::StatusLine;
+    _response = HttpResponse{};
+    _scan_pos = 0;
+    _body_size = 0;
+    _body.reset();
+    _body_consumer = nullptr;
+    _no_body = false;
+  }
+
+  /**
+   * @brief The response being parsed answers a HEAD request. Call before
+   * its status line is parsed.
+   */
+  auto expectNoBody() -> void { _no_body = true; }
+
+  /**
+   * @brief Stream the body of the current response to consumer instead of
+   * storing it. Only valid from the callback passed to run().
+   */
+  auto streamBody(BodyConsumer consumer) -> void {
+    _body_consumer = std::move(consumer);
+  }
+
+  auto streaming() const { return static_cast<bool>(_body_consumer); }
+
+  auto run(net::Buffer& buffer) { run(buffer, [](HttpResponse&) {}); }
+
+  /**
+   * @brief Parse what the buffer holds, calling on_headers(response) once
+   * the header block of the final response is parsed and before its body is
+   * read.
+   */
+  template <typename OnHeaders>
+  auto run(net::Buffer& buffer, OnHeaders&& on_headers) -> void {
+    if (_status == Status::INVALID) {
+      buffer.retrieve(buffer.readableBytes());
+      return;
+    }
+
+    while (_status != Status::OK && parse(buffer, on_headers)) {
+    }
+  }
+
+  /**
+   * @brief The connection was closed. Completes a body delimited by the
+   * close, a response cut short anywhere else becomes invalid.
+   */
+  auto finish() -> void {
+    if (_status == Status::BodyUntilClose) {
+      completeBody();
+    } else if (_status != Status::OK) {
+      _status = Status::INVALID;
+    }
+  }
+
+ private:
+  auto scan(std::string_view data, std::string_view pattern)
+      -> std::string_view::size_type {
+    const auto pos = data.find(pattern, _scan_pos);
+    if (pos == std::string_view::npos) {
+      _scan_pos = pattern.size() <= data.size()
+                      ? data.size() - pattern.size() + 1
+                      : 0;
+    }
+    return pos;
+  }
+
+  template <typename OnHeaders>
+  auto parse(net::Buffer& buffer, OnHeaders& on_headers) -> bool {
+    const auto data = std::string_view{buffer.peek(), buffer.readableBytes()};
+
+    switch (_status) {
+      case Status::StatusLine: {
+        const auto pos = scan(data, CRLF);
+        if (pos == std::string_view::npos) {
+          if (MAX_STATUS_LINE_SIZE < data.size()) {
+            _status = Status::INVALID;
+          }
+          return false;
+        }
+
+        if (!parseStatusLine(data.substr(0, pos))) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        buffer.retrieve(pos + CRLF.size());
+        _scan_pos = 0;
+        _status = Status::Headers;
+        return !buffer.empty();
+      }
+      case Status::Headers:
+      case Status::Trailers: {
+        auto block_size = std::string_view::size_type{0};
+        if (data.substr(0, CRLF.size()) != CRLF) {
+          const auto pos = scan(data, "\r\n\r\n");
+          if (pos == std::string_view::npos) {
+            if (_limits.max_headers_size < data.size()) {
+              _status = Status::INVALID;
+            }
+            return false;
+          }
+          block_size = pos + CRLF.size();
+        }
+
+        if (_limits.max_headers_size < block_size ||
+            !parseFields(data.substr(0, block_size),
+                         _status == Status::Headers)) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        buffer.retrieve(block_size + CRLF.size());
+        _scan_pos = 0;
+        if (_status == Status::Trailers) {
+          completeBody();
+          return false;
+        }
+
+        const auto framing = parseFraming();
+        if (framing == Status::StatusLine) {
+          // Interim response, the final one follows.
+          const auto no_body = _no_body;
+          reset();
+          _no_body = no_body;
+          return !buffer.empty();
+        }
+
+        if (framing == Status::INVALID) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        _status = framing;
+        on_headers(_response);
+        if (!streaming()) {
+          if (framing == Status::Body && _limits.max_body_size < _body_size) {
+            _status = Status::INVALID;
+            return false;
+          }
+          _body = std::make_shared<std::string>();
+          _body->reserve(framing == Status::Body ? _body_size : 0);
+        }
+
+        if (framing == Status::OK) {
+          completeBody();
+          return false;
+        }
+        return true;
+      }
+      case Status::Body: {
+        if (streaming()) {
+          const auto size = std::min(data.size(), _body_size);
+          if (size != 0) {
+            _body_size -= size;
+            _body_consumer(data.substr(0, size));
+            buffer.retrieve(size);
+          }
+          if (_body_size == 0) {
+            completeBody();
+          }
+          return false;
+        }
+
+        if (data.size() < _body_size) {
+          return false;
+        }
+
+        _body->append(data.substr(0, _body_size));
+        buffer.retrieve(_body_size);
+        completeBody();
+        return false;
+      }
+      case Status::BodyUntilClose: {
+        if (streaming()) {
+          // An empty view would end the body.
+          if (!data.empty()) {
+            _body_consumer(data);
+            buffer.retrieve(data.size());
+          }
+          return false;
+        }
+
+        if (_limits.max_body_size - _body->size() < data.size()) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        _body->append(data);
+        buffer.retrieve(data.size());
+        return false;
+      }
+      case Status::ChunkSize: {
+        const auto pos = scan(data, CRLF);
+        if (pos == std::string_view::npos) {
+          if (MAX_CHUNK_SIZE_LINE_SIZE < data.size()) {
+            _status = Status::INVALID;
+          }
+          return false;
+        }
+
+        const auto line = data.substr(0, pos);
+        const auto size = line.substr(0, line.find(';'));
+        const auto* end = size.data() + size.size();
+        auto [ptr, ec] = std::from_chars(size.data(), end, _body_size, 16);
+        if (size.empty() || ec != std::errc{} || ptr != end ||
+            (!streaming() &&
+             (_limits.max_body_size < _body_size ||
+              _limits.max_body_size - _body_size < _body->size()))) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        buffer.retrieve(pos + CRLF.size());
+        _scan_pos = 0;
+        _status = _body_size == 0 ? Status::Trailers : Status::ChunkData;
+        return !buffer.empty();
+      }
+      case Status::ChunkData: {
+        if (_body_size != 0) {
+          const auto size = std::min(data.size(), _body_size);
+          if (size == 0) {
+            return false;
+          }
+
+          if (streaming()) {
+            _body_consumer(data.substr(0, size));
+          } else {
+            _body->append(data.substr(0, size));
+          }
+          _body_size -= size;
+          buffer.retrieve(size);
+          return _body_size == 0 && !buffer.empty();
+        }
+
+        if (!CRLF.starts_with(data.substr(0, CRLF.size()))) {
+          _status = Status::INVALID;
+          return false;
+        }
+
+        if (data.size() < CRLF.size()) {
+          return false;
+        }
+
+        buffer.retrieve(CRLF.size());
+        _status = Status::ChunkSize;
+        return !buffer.empty();
+      }
+      default:
+        break;
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief HTTP-version SP status-code SP [ reason-phrase ]
+   */
+  auto parseStatusLine(std::string_view line) -> bool {
+    constexpr auto version_size = std::string_view{"HTTP/1.1"}.size();
+    const auto version = HttpResponse::Version{
+        line.starts_with("HTTP/1.1 ")   ? HttpResponse::HTTP_1_1
+        : line.starts_with("HTTP/1.0 ") ? HttpResponse::HTTP_1_0
+                                        : HttpResponse::UNKNOWN};
+    if (version == HttpResponse::UNKNOWN ||
+        line.size() < version_size + 4 ||
+        (line.size() > version_size + 4 && line[version_size + 4] != ' ')) {
+      return false;
+    }
+
+    const auto digits = line.substr(version_size + 1, 3);
+    auto code = std::uint16_t{0};
+    auto [ptr, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), code);
+    if (ec != std::errc{} || ptr != digits.data() + digits.size() ||
+        code < 100 || 599 < code) {
+      return false;
+    }
+
+    const auto status_code = static_cast<HttpResponse::StatusCode>(code);
+    const auto reason = line.substr(std::min(line.size(), version_size + 5));
+    _response.setVersion(version);
+    _response.setStatusCode(status_code);
+    // Keep the reason only where it differs, the standard one is cached.
+    if (reason != HttpResponse::statusCodeToString(status_code)) {
+      _response.setReason(reason);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Header or trailer lines, each ending in CRLF. Framing headers
+   * are remembered here since HttpResponse derives its own Content-Length.
+   */
+  auto parseFields(std::string_view block, bool headers) -> bool {
+    if (headers) {
+      _content_length.reset();
+      _transfer_encoding.clear();
+    }
+
+    while (!block.empty()) {
+      const auto end = block.find(CRLF);
+      const auto line = block.substr(0, end);
+      block.remove_prefix(end + CRLF.size());
+
+      const auto colon = line.find(':');
+      if (colon == 0 || colon == std::string_view::npos ||
+          line.front() == ' ' || line.front() == '\t') {
+        return false;
+      }
+
+      const auto key = line.substr(0, colon);
+      if (key.find_first_of(" \t") != std::string_view::npos) {
+        return false;
+      }
+      const auto value = trim(line.substr(colon + 1));
+
+      if (headers && equalsIgnoreCase(key, "Content-Length")) {
+        auto length = std::size_t{0};
+        auto [ptr, ec] =
+            std::from_chars(value.data(), value.data() + value.size(), length);
+        if (value.empty() || ec != std::errc{} ||
+            ptr != value.data() + value.size() ||
+            (_content_length && *_content_length != length)) {
+          return false;
+        }
+        _content_length = length;
+        continue;
+      }
+
+      if (headers && equalsIgnoreCase(key, "Transfer-Encoding")) {
+        // The body is stored decoded, so the coding is not kept.
+        if (!_transfer_encoding.empty()) {
+          _transfer_encoding += ", ";
+        }
+        _transfer_encoding += value;
+        continue;
+      }
+
+      // A cookie's Expires contains a comma, so Set-Cookie lines stay apart.
+      const auto existing = _response.header(key);
+      if (equalsIgnoreCase(key, "Set-Cookie")) {
+        _response.appendHeader(key, value);
+      } else if (existing.empty()) {
+        _response.addHeader(key, value);
+      } else {
+        _response.addHeader(key, std::string{existing} + ", " +
+                                     std::string{value});
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief How the body after the headers is framed, RFC 9112 section 6.3.
+   *
+   * @return Status::StatusLine for an interim response, Status::OK for no
+   * body, Status::INVALID for a framing that can't be trusted.
+   */
+  auto parseFraming() -> Status {
+    const auto code = static_cast<std::uint16_t>(_response.statusCode());
+    if (100 <= code && code < 200 && code != 101) {
+      return Status::StatusLine;
+    }
+
+    _body_size = 0;
+    if (_content_length) {
+      _response.setContentLength(*_content_length);
+    }
+    if (_no_body || code < 200 || code == 204 || code == 304) {
+      return Status::OK;
+    }
+
+    if (!_transfer_encoding.empty()) {
+      if (_content_length) {
+        return Status::INVALID;
+      }
+
+      auto coding = std::string_view{_transfer_encoding};
+      coding = trim(coding.substr(coding.rfind(',') + 1));
+      return equalsIgnoreCase(coding, "chunked") ? Status::ChunkSize
+                                                 : Status::BodyUntilClose;
+    }
+
+    if (_content_length) {
+      _body_size = *_content_length;
+      return _body_size == 0 ? Status::OK : Status::Body;
+    }
+
+    return Status::BodyUntilClose;
+  }
+
+  auto completeBody() -> void {
+    if (streaming()) {
+      _body_consumer({});
+    } else if (_body && !_body->empty()) {
+      _response.setBody(*_body, _body);
+    }
+    _status = Status::OK;
+  }
+
+  constexpr static auto trim(std::string_view data) -> std::string_view {
+    while (!data.empty() && (data.front() == ' ' || data.front() == '\t')) {
+      data.remove_prefix(1);
+    }
+    while (!data.empty() && (data.back() == ' ' || data.back() == '\t')) {
+      data.remove_suffix(1);
+    }
+    return data;
+  }
+
+  Status _status{Status::StatusLine};
+  Limits _limits;
+  HttpResponse _response;
+  std::size_t _scan_pos{0};
+  std::size_t _body_size{0};
+  std::shared_ptr<std::string> _body;
+  BodyConsumer _body_consumer;
+  std::optional<std::size_t> _content_length;
+  std::string _transfer_encoding;
+  bool _no_body{false};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_RESPONSE_PARSE_H__
@@ -0,0 +1,83 @@
+#ifndef __FZ_HTTP_HTTP_ROUTER_H__
+#define __FZ_HTTP_HTTP_ROUTER_H__
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/http_fields.h"
+#include "http/http_handler.h"
+#include "http/http_request.h"
+
+namespace fz::http {
+
+/**
+ * @brief Compressed radix tree mapping path patterns to per-method handlers.
+ *
+ * Patterns are made of static text, ":name" segments that capture one path
+ * segment, and a trailing "*name" segment that captures the rest of the
+ * path, e.g. "/users/:id" or "/assets/" followed by "*file". At every node
+ * static children are tried first, then the parameter child, then the
+ * wildcard.
+ */
+class HttpRouter {
+ public:
+  using Handler = HttpHandler;
+
+  struct Match {
+    // Null when no route matched or the route has no handler for the method.
+    const Handler* handler{nullptr};
+    // Bit mask of the methods the matched route answers, 0 if none.
+    std::uint32_t allowed{0};
+    // Pattern of the matched route, empty if none.
+    std::string_view pattern;
+  };
+
+  HttpRouter();
+
+  HttpRouter(const HttpRouter&) = delete;
+
+  HttpRouter(HttpRouter&&) noexcept;
+
+  auto operator=(const HttpRouter&) -> HttpRouter& = delete;
+
+  auto operator=(HttpRouter&&) noexcept -> HttpRouter&;
+
+  ~HttpRouter();
+
+  /**
+   * @brief Register handler for method on pattern. HttpRequest::INVALID
+   * registers a handler for any method without a handler of its own.
+   *
+   * @throw std::invalid_argument if the pattern is malformed or conflicts
+   * with an existing parameter or wildcard name.
+   */
+  auto add(HttpRequest::Method method, std::string_view pattern,
+           Handler handler) -> void;
+
+  /**
+   * @brief Find the handler for method and path. Captured parameters are
+   * appended to params as views into path. HEAD requests go to the GET
+   * handler unless the route has one for HEAD; the server sends only the
+   * head of its response.
+   */
+  auto match(HttpRequest::Method method, std::string_view path,
+             HttpFields& params) const -> Match;
+
+  /**
+   * @brief Value for the Allow header of a 405 response.
+   */
+  static auto allowToString(std::uint32_t allowed) -> std::string;
+
+ private:
+  struct Node;
+
+  std::unique_ptr<Node> _root;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_ROUTER_H__
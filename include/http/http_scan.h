@@ -0,0 +1,86 @@
+#ifndef __FZ_HTTP_HTTP_SCAN_H__
+#define __FZ_HTTP_HTTP_SCAN_H__
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief Single pass scanner for the structural characters of a request head
+ * (CR, LF, SP, ':', '?', '=' and '&'). The request line and header parsers
+ * walk the recorded offsets instead of calling find() once per delimiter.
+ *
+ * The kernel is chosen at runtime: AVX2 or SSE4.2 on x86 when the CPU
+ * supports them, a table driven scalar loop otherwise.
+ */
+class HttpScanner {
+ public:
+  enum class Kernel : std::uint8_t { Scalar, SSE42, AVX2 };
+
+  using Positions = std::vector<std::uint32_t>;
+
+  /**
+   * @brief Append the offset of every structural character in data to
+   * positions.
+   *
+   * @return false if data contains a control character other than HTAB, CR
+   * and LF, which is never valid in a request head.
+   */
+  static auto scan(std::string_view data, Positions& positions) -> bool;
+
+  static auto scan(Kernel kernel, std::string_view data, Positions& positions)
+      -> bool;
+
+  static auto kernel() -> Kernel;
+
+  static auto supported(Kernel kernel) -> bool;
+
+  static auto kernelToString(Kernel kernel) -> std::string_view {
+    switch (kernel) {
+      case Kernel::SSE42:
+        return "sse4.2";
+      case Kernel::AVX2:
+        return "avx2";
+      default:
+        return "scalar";
+    }
+  }
+};
+
+constexpr inline auto HTTP_TOKEN_CHARS = [] {
+  // tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+  //         "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+  auto table = std::array<bool, 256>{};
+  for (auto c = '0'; c <= '9'; ++c) {
+    table[static_cast<unsigned char>(c)] = true;
+  }
+  for (auto c = 'a'; c <= 'z'; ++c) {
+    table[static_cast<unsigned char>(c)] = true;
+    table[static_cast<unsigned char>(c - 'a' + 'A')] = true;
+  }
+  for (auto c : std::string_view{"!#$%&'*+-.^_`|~"}) {
+    table[static_cast<unsigned char>(c)] = true;
+  }
+  return table;
+}();
+
+constexpr auto isToken(std::string_view data) -> bool {
+  if (data.empty()) {
+    return false;
+  }
+
+  for (auto c : data) {
+    if (!HTTP_TOKEN_CHARS[static_cast<unsigned char>(c)]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_SCAN_H__
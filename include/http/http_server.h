@@ -1,47 +1,266 @@
 #ifndef __FZ_HTTP_HTTP_SERVER_H__
 #define __FZ_HTTP_HTTP_SERVER_H__
 
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
-#include <unordered_map>
+#include <string>
+#include <vector>
 
+#include "http/http_compression.h"
+#include "http/http_handler.h"
+#include "http/http_metrics.h"
+#include "http/http_proxy.h"
 #include "http/http_request.h"
+#include "http/http_request_parse.h"
 #include "http/http_response.h"
+#include "http/http_response_cache.h"
+#include "http/http_router.h"
+#include "http/http_static_files.h"
 #include "http/http_session.h"
+#include "http/thread_pool.h"
+#include "http/websocket.h"
 #include "net/session.h"
 #include "net/tcp_server.h"
 
 namespace fz::http {
 
-// TODO(franzero): is necessary to inherit from TcpServer?
-class HttpServer : private fz::net::TcpServer {
+/**
+ * @brief HTTP/1.1 server on fz_net's loops. Configure it before start().
+ */
+class HttpServer {
  public:
+  /**
+   * @brief How connections reach the loops.
+   */
+  enum class AcceptMode : std::uint8_t {
+    // One listener, whose thread hands every connection to one of the
+    // thread_num loops.
+    Shared,
+    // A listener per loop, all bound to the same address with
+    // SO_REUSEPORT, so the kernel spreads the connections over them instead
+    // of one thread accepting every connection. Every listener is a
+    // TcpServer with a single loop, which needs fz_net to open listening
+    // sockets with SO_REUSEPORT (Linux 3.9+); the second one fails to bind
+    // otherwise.
+    ReusePort
+  };
+
   HttpServer(std::size_t thread_num, std::string_view ip, uint16_t port)
-      : fz::net::TcpServer(thread_num, ip, port) {
-    this->setReadCallback([this](const auto& session, auto& buffer) {
-      this->readCallback(session, buffer);
-    });
-    this->setNewSessionCallback<HttpSession>();
+      : _thread_num{thread_num}, _ip{ip}, _port{port} {}
+
+  auto start() -> void;
+
+  auto stop() -> void;
+
+  auto setAcceptMode(AcceptMode mode) -> void { _accept_mode = mode; }
+
+  auto acceptMode() const -> AcceptMode { return _accept_mode; }
+
+  /**
+   * @brief Pin every loop thread to one of cpus, round robin, with every
+   * CPU the process may run on by default. A loop is pinned when it first
+   * reads from a connection; with AcceptMode::Shared the listener's thread
+   * stays unpinned. Does nothing outside Linux. Call before start().
+   *
+   * Handler state in a LoopLocal and a response cache with
+   * HttpResponseCache::Options::per_thread then stay on one core as well.
+   */
+  auto pinThreads(std::vector<int> cpus = {}) -> void;
+
+  /**
+   * @brief Register a handler for every method on a route pattern, see
+   * HttpRouter for the pattern syntax and HttpHandler for the handler forms.
+   */
+  auto registerHandler(std::string_view path, HttpHandler handler) -> void;
+
+  /**
+   * @brief Register a handler for one method. Requests with another method
+   * get 405 with an Allow header unless an any-method handler exists.
+   */
+  auto registerHandler(HttpRequest::Method method, std::string_view path,
+                       HttpHandler handler) -> void;
+
+  /**
+   * @brief Start a pool of thread_num threads for handlers registered with
+   * HttpHandler::offload(). Without a pool they run on the event loop. Call
+   * before start().
+   */
+  auto setOffloadThreads(std::size_t thread_num) -> void {
+    _offload_pool = std::make_unique<ThreadPool>(thread_num);
   }
 
-  auto start() -> void { TcpServer::start(); }
+  /**
+   * @brief Header and body size limits. Requests over them are answered
+   * with 431 or 413 as soon as the size is known, and the connection is
+   * closed. Bodies of stream handlers are not limited.
+   */
+  auto setLimits(const HttpRequestParse::Limits& limits) -> void {
+    _limits = limits;
+  }
 
-  auto stop() -> void { TcpServer::stop(); }
+  /**
+   * @brief Header, body and idle timeouts of every connection, see
+   * HttpSession::Timeouts.
+   */
+  auto setTimeouts(const HttpSession::Timeouts& timeouts) -> void {
+    _timeouts = timeouts;
+  }
 
-  auto registerHandler(
-      std::string_view path,
-      std::function<HttpResponse(const HttpRequest& request)> handler) -> void;
+  /**
+   * @brief Close a connection after it served this many requests, zero for
+   * no limit. Connections are otherwise kept alive as long as the client
+   * asks for it (HTTP/1.1 by default, HTTP/1.0 with keep-alive).
+   */
+  auto setMaxRequestsPerConnection(std::size_t max_requests) -> void {
+    _max_requests = max_requests;
+  }
+
+  /**
+   * @brief Compress responses for clients that accept gzip or deflate, see
+   * HttpCompression. Does nothing when FzHttp is built without zlib.
+   */
+  auto enableCompression(HttpCompression::Options options = {}) -> void {
+    _compression = std::make_unique<HttpCompression>(std::move(options));
+  }
+
+  /**
+   * @brief Size and sharding of the cache behind HttpHandler::cached()
+   * routes. A cache with default options is created otherwise. Call before
+   * start().
+   */
+  auto setResponseCache(HttpResponseCache::Options options) -> void {
+    _response_cache = std::make_unique<HttpResponseCache>(std::move(options));
+  }
+
+  auto responseCache() const -> const HttpResponseCache* {
+    return _response_cache.get();
+  }
+
+  /**
+   * @brief Collect HttpMetrics and serve them in the Prometheus text format
+   * at GET path. An empty path collects them without an endpoint, see
+   * metrics(). Call before start().
+   */
+  auto enableMetrics(std::string_view path = "/metrics") -> void;
+
+  /**
+   * @brief The metrics collected since enableMetrics(), null without.
+   */
+  auto metrics() const -> const HttpMetrics* { return _metrics.get(); }
+
+  /**
+   * @brief Serve the files below root for GET requests under prefix, e.g.
+   * serveStatic("/assets/", "./public").
+   */
+  auto serveStatic(std::string_view prefix, std::filesystem::path root,
+                   HttpStaticFiles::Options options = {}) -> void;
+
+  /**
+   * @brief Accept WebSocket upgrades of GET requests to path and hand the
+   * connections to handler. The handshake is answered with 400 when it is
+   * malformed or pipelined behind requests still being answered.
+   */
+  auto webSocket(std::string_view path, WebSocketHandler handler) -> void;
+
+  /**
+   * @brief Forward requests of any method under prefix to upstreams, see
+   * HttpProxy, e.g. proxy("/api/", {{"10.0.0.1", 8080}, {"10.0.0.2", 8080}}).
+   */
+  auto proxy(std::string_view prefix,
+             std::vector<HttpProxy::Upstream> upstreams,
+             const HttpProxy::Options& options = {}) -> void;
 
   auto response(const std::shared_ptr<HttpSession>& http_session,
                 const HttpResponse& response) -> void;
 
+  auto serverName() const -> std::string_view { return _server_name; }
+
+  /**
+   * @brief Value of the Server header added to every response that doesn't
+   * set one. An empty name disables the header.
+   */
+  auto setServerName(std::string_view name) -> void { _server_name = name; }
+
  private:
+  /**
+   * @brief Pin the calling loop thread on its first read, to the CPU of
+   * acceptor index, or the next CPU with a shared listener.
+   */
+  auto pinLoop(std::size_t index) -> void;
+
   auto readCallback(const std::shared_ptr<net::Session>& session,
                     net::Buffer& buffer) -> void;
 
+  auto processInput(const std::shared_ptr<HttpSession>& http_session,
+                    net::Buffer& buffer) -> void;
+
+  /**
+   * @brief Route a request whose headers are parsed. A stream handler gets
+   * the body from here on, any other route is kept for handleRequest().
+   */
+  auto routeRequest(const std::shared_ptr<HttpSession>& http_session,
+                    HttpRequest& request) -> void;
+
+  auto handleRequest(const std::shared_ptr<HttpSession>& http_session,
+                     const HttpRequest& request) -> void;
+
+  /**
+   * @brief Answer the handshake of a WebSocket route and switch the
+   * connection over when it is valid.
+   */
+  auto upgradeWebSocket(const std::shared_ptr<HttpSession>& http_session,
+                        const HttpRequest& request, std::uint64_t slot)
+      -> void;
+
+  /**
+   * @brief Parse the frames of an upgraded connection and dispatch them.
+   */
+  auto processWebSocket(const std::shared_ptr<HttpSession>& http_session,
+                        net::Buffer& buffer) -> void;
+
+  /**
+   * @brief Reserve the response slot of a request and decide whether the
+   * connection stays open after it.
+   */
+  auto reserveResponse(const std::shared_ptr<HttpSession>& http_session,
+                       const HttpRequest& request) -> std::uint64_t;
+
+  /**
+   * @brief Responder for a request answered later, compressing like the
+   * inline path does.
+   */
+  auto makeResponder(const std::shared_ptr<HttpSession>& http_session,
+                     const HttpRequest& request, std::uint64_t slot)
+      -> HttpResponder;
+
+  /**
+   * @brief Count a response the server produced itself in the metrics.
+   */
+  auto recordResponse(const HttpRoute& route, std::uint16_t status) -> void;
+
  private:
-  std::unordered_map<std::string,
-                     std::function<HttpResponse(const HttpRequest& request)>>
-      _handlers;
+  HttpRouter _router;
+  std::string _server_name{"fz"};
+  HttpRequestParse::Limits _limits;
+  HttpSession::Timeouts _timeouts;
+  std::size_t _max_requests{0};
+  std::unique_ptr<HttpCompression> _compression;
+  std::unique_ptr<HttpResponseCache> _response_cache;
+  // Shared with the sessions, which may outlive the server.
+  std::shared_ptr<HttpMetrics> _metrics;
+  // After the state its tasks use: ~ThreadPool still runs the queued ones,
+  // whose responders compress and cache.
+  std::unique_ptr<ThreadPool> _offload_pool;
+  std::size_t _thread_num;
+  std::string _ip;
+  uint16_t _port;
+  AcceptMode _accept_mode{AcceptMode::Shared};
+  std::vector<int> _cpus;
+  std::atomic<std::size_t> _next_cpu{0};
+  // Last, so the connections go before the state their callbacks use.
+  std::vector<std::unique_ptr<net::TcpServer>> _acceptors;
 };
 
 }  // namespace fz::http
@@ -1,17 +1,86 @@
 #ifndef __FZ_HTTP_HTTP_SESSION_H__
 #define __FZ_HTTP_HTTP_SESSION_H__
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "http/http_metrics.h"
 #include "http/http_request_parse.h"
+#include "http/http_response.h"
+#include "http/timer_wheel.h"
+#include "http/websocket.h"
+#include "http/websocket_frame.h"
+#include "http/websocket_parse.h"
 #include "net/common/buffer.h"
+#include "net/loop.h"
 #include "net/session.h"
 
 namespace fz::http {
 
+class HttpHandler;
+
+/**
+ * @brief Where a request was routed, resolved as soon as its headers are
+ * parsed so a streaming handler can take the body as it arrives.
+ */
+struct HttpRoute {
+  const HttpHandler* handler{nullptr};
+  std::uint32_t allowed{0};
+  std::string_view pattern;
+  // When the headers were parsed, only set with metrics enabled.
+  HttpMetrics::Clock::time_point routed_at;
+};
+
+/**
+ * @brief Connection state on top of fz_net's Session: the request parser,
+ * the response order for pipelined requests, read backpressure and the
+ * connection lifecycle.
+ *
+ * A session closes after the response to a request that doesn't keep the
+ * connection alive, and when the client is too slow: a single timer per
+ * session, on a timer wheel shared by every session of the loop, tracks the
+ * header, body or idle timeout depending on what the connection waits for.
+ *
+ * Output is gathered in one buffer and sent once per read callback, or
+ * once per turn of the loop for what is completed outside of one (see
+ * flushLater()), since every send is a write syscall for fz_net.
+ *
+ * After a WebSocket upgrade the same timer paces the pings, and the
+ * session speaks frames until it closes.
+ */
 class HttpSession : public fz::net::Session {
  public:
+  /**
+   * @brief How long the connection waits on the client, zero disables a
+   * timeout. header runs from the first byte of a request to the end of its
+   * headers, body between two reads of a body, and idle between requests.
+   */
+  struct Timeouts {
+    std::chrono::milliseconds header{std::chrono::seconds{10}};
+    std::chrono::milliseconds body{std::chrono::seconds{30}};
+    std::chrono::milliseconds idle{std::chrono::seconds{60}};
+  };
+
   explicit HttpSession(std::shared_ptr<fz::net::Loop> loop)
       : fz::net::Session{std::move(loop)} {}
 
+  ~HttpSession() {
+    if (_websocket && !_websocket->closed && _websocket->handler->on_close) {
+      _websocket->handler->on_close(webSocket(), WebSocketFrame::ABNORMAL);
+    }
+    if (_metrics) {
+      _metrics->connectionClosed();
+    }
+  }
+
   auto parseRequest(net::Buffer& buffer) -> void {
     _http_request_parse.run(buffer);
   }
@@ -20,8 +89,688 @@ class HttpSession : public fz::net::Session {
 
   auto& httpRequestParse() { return _http_request_parse; }
 
+  auto& timeouts() const { return _timeouts; }
+
+  auto setTimeouts(const Timeouts& timeouts) -> void { _timeouts = timeouts; }
+
+  auto& route() const { return _route; }
+
+  auto setRoute(const HttpRoute& route) -> void { _route = route; }
+
+  auto metrics() const { return _metrics.get(); }
+
+  /**
+   * @brief Address of the client, e.g. "192.0.2.1", for whoever accepts the
+   * connection to set. Empty while unknown: fz_net doesn't report it to
+   * new sessions yet.
+   */
+  auto& peerAddress() const { return _peer_address; }
+
+  auto setPeerAddress(std::string address) -> void {
+    _peer_address = std::move(address);
+  }
+
+  /**
+   * @brief Count this connection and its traffic in metrics, from now on.
+   * Later calls are ignored.
+   */
+  auto setMetrics(const std::shared_ptr<HttpMetrics>& metrics) -> void {
+    if (!_metrics && metrics) {
+      _metrics = metrics;
+      _metrics->connectionOpened();
+    }
+  }
+
+  /**
+   * @brief Count what a read appended to buffer, which starts with the
+   * bytes earlier reads left unparsed. Call before parsing, and
+   * setUnparsed() after.
+   */
+  auto countReceived(const net::Buffer& buffer) -> void {
+    if (_metrics && _unparsed < buffer.readableBytes()) {
+      _metrics->bytesReceived(buffer.readableBytes() - _unparsed);
+    }
+  }
+
+  auto setUnparsed(const net::Buffer& buffer) -> void {
+    _unparsed = buffer.readableBytes();
+  }
+
+  /**
+   * @brief Bytes read but not parsed while reading was paused. They are fed
+   * to the parser before anything read afterwards.
+   */
+  auto& backlog() { return _backlog; }
+
+  auto readingPaused() const { return _reading_paused; }
+
+  /**
+   * @brief Stop reading from the socket until resumeReading(), so a slow
+   * body consumer pushes back on the client instead of buffering. What is
+   * left in buffer moves to the backlog, and on_resume is run on resume to
+   * parse it.
+   */
+  auto pauseReading(net::Buffer& buffer, std::function<void()> on_resume)
+      -> void {
+    if (&buffer != &_backlog) {
+      _backlog.append(buffer.peek(), buffer.readableBytes());
+      buffer.retrieve(buffer.readableBytes());
+    }
+
+    _on_resume = std::move(on_resume);
+    if (!_reading_paused) {
+      _reading_paused = true;
+      stopRead();
+    }
+  }
+
+  /**
+   * @brief Undo pauseReading(). Must run on the session's loop.
+   */
+  auto resumeReading() -> void {
+    _http_request_parse.resume();
+    if (!_reading_paused) {
+      return;
+    }
+
+    _reading_paused = false;
+    startRead();
+    auto on_resume = std::move(_on_resume);
+    _on_resume = nullptr;
+    if (on_resume) {
+      on_resume();
+    }
+  }
+
+  /**
+   * @brief Run task on the loop this session belongs to. Safe to call from
+   * any thread.
+   */
+  auto post(std::function<void()> task) -> void {
+    loop()->post(std::move(task));
+  }
+
+  /**
+   * @brief Reserve the next slot in the response order. Every request gets
+   * one when it is parsed, so responses completed out of order (async
+   * handlers) are still written in request order.
+   */
+  auto reserveResponse() -> std::uint64_t { return _next_response++; }
+
+  /**
+   * @brief Number of requests seen on this connection.
+   */
+  auto requestCount() const { return _next_response; }
+
+  /**
+   * @brief Close the connection once the response in slot is written. The
+   * response gets "Connection: close", and nothing after it is read.
+   */
+  auto closeAfter(std::uint64_t slot) -> void {
+    _close_slot = std::min(_close_slot, slot);
+  }
+
+  auto closing() const { return _close_slot != NO_SLOT; }
+
+  /**
+   * @brief Answer every response with "Connection: keep-alive", for HTTP/1.0
+   * clients that only keep the connection open when told so.
+   */
+  auto setKeepAliveHeader(bool enable) -> void { _keep_alive_header = enable; }
+
+  /**
+   * @brief Fill a reserved slot. The response is written to the output
+   * buffer right away if every earlier slot has been written, otherwise it
+   * waits for them. Must run on the session's loop.
+   */
+  auto completeResponse(std::uint64_t slot, HttpResponse response,
+                        std::string_view server = {}) -> void {
+    complete(slot, PendingResponse{std::move(response), server, nullptr});
+  }
+
+  /**
+   * @brief Fill a reserved slot with a response serialized beforehand, e.g.
+   * from the response cache. The bytes are written as they are, except for
+   * the Connection header the session adds itself.
+   */
+  auto completeSerialized(std::uint64_t slot,
+                          std::shared_ptr<const std::string> bytes) -> void {
+    complete(slot, PendingResponse{{}, {}, std::move(bytes)});
+  }
+
+  /**
+   * @brief Fill a reserved slot with the head of a response whose body is
+   * pushed afterwards with appendStreamed() and ended with endStreamed(),
+   * e.g. relayed from an upstream as it arrives. The body is written as is
+   * when the head declares a Content-Length, chunked otherwise, and the
+   * responses after it wait until it has ended. Must run on the session's
+   * loop.
+   */
+  auto beginStreamed(std::uint64_t slot, HttpResponse head,
+                     std::string_view server = {}) -> void {
+    auto pending = PendingResponse{std::move(head), server, nullptr};
+    pending.streamed = true;
+    pending.chunked = pending.response.hasBody() &&
+                      !pending.response.hasContentLength() &&
+                      !pending.response.bodyOmitted();
+    if (pending.chunked) {
+      // Only makes serialize() write the chunked head, the chunks come
+      // from appendStreamed().
+      pending.response.setChunkedBody(
+          [](HttpChunkedWriter&) { return false; });
+    }
+    complete(slot, std::move(pending));
+  }
+
+  auto appendStreamed(std::uint64_t slot, std::string_view data) -> void {
+    auto it = _pending_responses.find(slot);
+    if (it == _pending_responses.end() || !it->second.streamed ||
+        !it->second.response.hasBody() ||
+        it->second.response.bodyOmitted()) {
+      return;
+    }
+
+    auto& pending = it->second;
+    if (pending.chunked) {
+      HttpChunkedWriter{pending.body}.write(data);
+    } else {
+      pending.body.append(data);
+    }
+    writeReady();
+  }
+
+  auto endStreamed(std::uint64_t slot) -> void {
+    auto it = _pending_responses.find(slot);
+    if (it == _pending_responses.end() || !it->second.streamed) {
+      return;
+    }
+
+    it->second.ended = true;
+    writeReady();
+  }
+
+  /**
+   * @brief End a streamed response whose body is incomplete. The connection
+   * is closed after what was written of it, so the client can tell.
+   */
+  auto abortStreamed(std::uint64_t slot) -> void {
+    auto it = _pending_responses.find(slot);
+    if (it == _pending_responses.end() || !it->second.streamed) {
+      return;
+    }
+
+    it->second.ended = true;
+    it->second.aborted = true;
+    writeReady();
+    if (_output.empty() && closing() && _close_slot < _next_write) {
+      cancelTimer();
+      close();
+    }
+  }
+
+  /**
+   * @brief Arm the timer for what the connection waits for now. has_input
+   * tells whether part of the next request is buffered. Nothing is armed
+   * while a response is pending, reading is paused or the connection is
+   * closing, since it's the server that is behind then. Must run on the
+   * session's loop.
+   */
+  auto updateTimer(bool has_input) -> void {
+    _has_input = has_input;
+    updateTimer();
+  }
+
+  auto updateTimer() -> void {
+    if (_websocket) {
+      return;  // the ping timer runs on its own
+    }
+
+    auto phase = Phase::None;
+    auto timeout = std::chrono::milliseconds{0};
+    switch (_http_request_parse.status()) {
+      case HttpRequestParse::Status::RequestLine:
+        if (_has_input) {
+          phase = Phase::Header;
+          timeout = _timeouts.header;
+        } else if (_next_response == _next_write) {
+          phase = Phase::Idle;
+          timeout = _timeouts.idle;
+        }
+        break;
+      case HttpRequestParse::Status::Headers:
+        phase = Phase::Header;
+        timeout = _timeouts.header;
+        break;
+      case HttpRequestParse::Status::Body:
+      case HttpRequestParse::Status::ChunkSize:
+      case HttpRequestParse::Status::ChunkData:
+      case HttpRequestParse::Status::Trailers:
+        phase = Phase::Body;
+        timeout = _timeouts.body;
+        break;
+      default:
+        break;
+    }
+
+    if (_reading_paused || closing() || timeout.count() == 0) {
+      phase = Phase::None;
+    }
+
+    // The header timeout covers the whole header block, only the idle and
+    // body timers restart with every read.
+    if (phase == _phase && phase == Phase::Header) {
+      return;
+    }
+
+    cancelTimer();
+    _phase = phase;
+    if (phase == Phase::None) {
+      return;
+    }
+
+    _timer = timerWheel().add(timeout, [weak = weak_from_this()]() {
+      if (auto session = weak.lock()) {
+        static_cast<HttpSession&>(*session).onTimeout();
+      }
+    });
+  }
+
+  /**
+   * @brief Queue a response behind the ones already queued. Responses are
+   * kept in request order and written out together by flushResponses().
+   */
+  auto queueResponse(const HttpResponse& response,
+                     std::string_view server = {}) -> void {
+    completeResponse(reserveResponse(), response, server);
+  }
+
+  auto hasQueuedResponses() const { return !_output.empty(); }
+
+  /**
+   * @brief Number of responses reserved but not written yet.
+   */
+  auto pendingResponses() const { return _next_response - _next_write; }
+
+  /**
+   * @brief Speak WebSocket frames from now on. Call once the 101 response
+   * is queued. Must run on the session's loop.
+   */
+  auto upgrade(std::shared_ptr<const WebSocketHandler> handler) -> void {
+    _websocket = std::make_unique<WebSocketState>();
+    _websocket->parse.setLimits({handler->max_message_size});
+    _websocket->handler = std::move(handler);
+    armWebSocketTimer();
+  }
+
+  auto upgraded() const { return _websocket != nullptr; }
+
+  auto& webSocketParse() { return _websocket->parse; }
+
+  auto& webSocketHandler() const { return *_websocket->handler; }
+
+  auto webSocket() -> WebSocket { return WebSocket{weak_from_this()}; }
+
+  /**
+   * @brief Note that the client was heard from, so it isn't pinged.
+   */
+  auto webSocketActivity() -> void {
+    _websocket->alive = true;
+    _websocket->ping_sent = false;
+  }
+
+  /**
+   * @brief Send a frame, unless the closing handshake started. Must run on
+   * the session's loop, like the other WebSocket calls.
+   */
+  auto sendFrame(WebSocketFrame::Opcode opcode, std::string_view payload)
+      -> void {
+    if (_websocket && !_websocket->close_sent) {
+      WebSocketFrame::serialize(_output, opcode, payload);
+      flushLater();
+    }
+  }
+
+  auto sendSerialized(std::string_view frame) -> void {
+    if (_websocket && !_websocket->close_sent) {
+      _output.append(frame.data(), frame.size());
+      flushLater();
+    }
+  }
+
+  /**
+   * @brief Send a close frame and wait a little for the client's answer,
+   * after which nothing else is sent.
+   */
+  auto closeWebSocket(std::uint16_t code, std::string_view reason = {})
+      -> void {
+    if (!_websocket || _websocket->close_sent) {
+      return;
+    }
+
+    WebSocketFrame::serialize(_output, WebSocketFrame::Opcode::Close,
+                              WebSocketFrame::closePayload(code, reason));
+    sendOutput();
+    _websocket->close_sent = true;
+    armWebSocketTimer();
+  }
+
+  /**
+   * @brief Tell the handler that the connection ended, once.
+   */
+  auto webSocketClosed(std::uint16_t code) -> void {
+    if (!_websocket || _websocket->closed) {
+      return;
+    }
+
+    _websocket->closed = true;
+    cancelTimer();
+    if (_websocket->handler->on_close) {
+      _websocket->handler->on_close(webSocket(), code);
+    }
+  }
+
+  /**
+   * @brief Flush once the tasks already posted to the loop have run, so
+   * what several of them complete (async responses, stream writes,
+   * WebSocket frames) goes out with one send instead of one each. Must run
+   * on the session's loop.
+   */
+  auto flushLater() -> void {
+    if (_flush_posted) {
+      return;
+    }
+
+    _flush_posted = true;
+    post([weak = weak_from_this()]() {
+      if (auto session = weak.lock()) {
+        auto& http_session = static_cast<HttpSession&>(*session);
+        http_session._flush_posted = false;
+        http_session.flushResponses();
+      }
+    });
+  }
+
+  /**
+   * @brief Send every queued response with a single send.
+   */
+  auto flushResponses() -> void {
+    if (_output.empty()) {
+      return;
+    }
+
+    sendOutput();
+    if (closing() && _close_slot < _next_write) {
+      cancelTimer();
+      close();
+    }
+  }
+
+ private:
+  enum class Phase : std::uint8_t { None, Idle, Header, Body };
+
+  constexpr static auto NO_SLOT = std::numeric_limits<std::uint64_t>::max();
+  constexpr static auto CHUNKED_FLUSH_SIZE = std::size_t{64} << 10;
+
+  /**
+   * @brief The timer wheel of the calling loop thread, ticked by that loop.
+   */
+  auto timerWheel() -> TimerWheel& {
+    thread_local auto wheel = std::unique_ptr<TimerWheel>{};
+    if (!wheel) {
+      wheel = std::make_unique<TimerWheel>();
+      loop()->runEvery(TimerWheel::DEFAULT_TICK,
+                       [wheel = wheel.get()]() { wheel->advance(); });
+    }
+    return *wheel;
+  }
+
+  auto sendOutput() -> void {
+    if (_metrics) {
+      _metrics->bytesSent(_output.readableBytes());
+    }
+    send(_output);
+    _output.retrieve(_output.readableBytes());
+  }
+
+  auto cancelTimer() -> void {
+    if (_timer != TimerWheel::INVALID_TIMER) {
+      timerWheel().cancel(_timer);
+      _timer = TimerWheel::INVALID_TIMER;
+    }
+    _phase = Phase::None;
+  }
+
+  auto onTimeout() -> void {
+    _timer = TimerWheel::INVALID_TIMER;
+    if (_phase != Phase::Idle) {
+      // The client stalled in the middle of a request.
+      auto response = HttpResponse::makeRequestTimeout();
+      response.addHeader("Connection", "close");
+      response.serialize(_output);
+      sendOutput();
+      if (_metrics) {
+        _metrics->response({}, HttpResponse::REQUEST_TIMEOUT);
+      }
+    }
+    _phase = Phase::None;
+    close();
+  }
+
+  constexpr static auto WEBSOCKET_CLOSE_TIMEOUT = std::chrono::seconds{5};
+
+  struct WebSocketState {
+    WebSocketParse parse;
+    std::shared_ptr<const WebSocketHandler> handler;
+    // Heard from the client during the current ping interval.
+    bool alive{false};
+    bool ping_sent{false};
+    bool close_sent{false};
+    bool closed{false};
+  };
+
+  auto armWebSocketTimer() -> void {
+    cancelTimer();
+    const auto delay = _websocket->close_sent
+                           ? std::chrono::milliseconds{WEBSOCKET_CLOSE_TIMEOUT}
+                           : _websocket->handler->ping_interval;
+    if (delay.count() == 0) {
+      return;
+    }
+
+    _timer = timerWheel().add(delay, [weak = weak_from_this()]() {
+      if (auto session = weak.lock()) {
+        static_cast<HttpSession&>(*session).onWebSocketTimeout();
+      }
+    });
+  }
+
+  auto onWebSocketTimeout() -> void {
+    _timer = TimerWheel::INVALID_TIMER;
+    auto& websocket = *_websocket;
+    if (!websocket.close_sent && websocket.alive) {
+      websocket.alive = false;
+      armWebSocketTimer();
+      return;
+    }
+    if (!websocket.close_sent && !websocket.ping_sent) {
+      websocket.ping_sent = true;
+      sendFrame(WebSocketFrame::Opcode::Ping, {});
+      armWebSocketTimer();
+      return;
+    }
+
+    // Silent for two intervals, or no answer to our close frame.
+    webSocketClosed(WebSocketFrame::ABNORMAL);
+    close();
+  }
+
+  struct PendingResponse {
+    HttpResponse response;
+    std::string_view server;
+    std::shared_ptr<const std::string> serialized;
+    // A streamed response: its body so far, framed and not written yet.
+    bool streamed{false};
+    bool chunked{false};
+    // Streamed from the response's own chunk producer, a batch per turn of
+    // the loop; batch_posted while the next batch waits for its turn.
+    bool producing{false};
+    bool batch_posted{false};
+    bool head_written{false};
+    bool ended{false};
+    bool aborted{false};
+    std::string body{};
+  };
+
+  auto complete(std::uint64_t slot, PendingResponse pending) -> void {
+    if (!pending.streamed && !pending.serialized &&
+        pending.response.isChunked() && pending.response.hasBody() &&
+        !pending.response.bodyOmitted()) {
+      pending.streamed = true;
+      pending.chunked = true;
+      pending.producing = true;
+    }
+
+    if (slot == _next_write && !pending.streamed) {
+      writeResponse(pending);
+      ++_next_write;
+    } else {
+      _pending_responses.emplace(slot, std::move(pending));
+    }
+    writeReady();
+  }
+
+  /**
+   * @brief Write the responses whose turn has come, up to the first one
+   * still missing or still streaming.
+   */
+  auto writeReady() -> void {
+    for (auto it = _pending_responses.begin();
+         it != _pending_responses.end() && it->first == _next_write;
+         it = _pending_responses.erase(it)) {
+      // Nothing goes after a response that closes the connection.
+      if (closing() && _close_slot < _next_write) {
+        return;
+      }
+
+      auto& pending = it->second;
+      if (!pending.streamed) {
+        writeResponse(pending);
+        ++_next_write;
+        continue;
+      }
+
+      if (!pending.head_written) {
+        writeHead(pending.response, pending.server);
+        pending.head_written = true;
+      }
+      _output.append(pending.body.data(), pending.body.size());
+      pending.body.clear();
+      if (pending.producing && !pending.ended && !pending.batch_posted) {
+        produceBatch(pending);
+      }
+      if (!pending.ended) {
+        return;
+      }
+
+      if (pending.aborted) {
+        closeAfter(_next_write);
+      } else if (pending.chunked) {
+        HttpChunkedWriter{_output}.finish();
+      }
+      ++_next_write;
+    }
+  }
+
+  /**
+   * @brief Produce chunks of a producing response until CHUNKED_FLUSH_SIZE
+   * bytes are out or the body ends, and post the next batch to the loop.
+   *
+   * The loop serves its other connections between two batches. fz_net
+   * doesn't tell when its send buffer drains, so a client reading slower
+   * than the producer still lets the body pile up there; the batches only
+   * keep one producer from holding the loop.
+   */
+  auto produceBatch(PendingResponse& pending) -> void {
+    auto writer = HttpChunkedWriter{_output};
+    const auto limit = _output.readableBytes() + CHUNKED_FLUSH_SIZE;
+    while (_output.readableBytes() < limit) {
+      if (!pending.response.produceBody(writer)) {
+        pending.ended = true;
+        return;
+      }
+    }
+
+    pending.batch_posted = true;
+    post([weak = weak_from_this(), slot = _next_write]() {
+      auto session = weak.lock();
+      if (!session) {
+        return;
+      }
+
+      auto& http_session = static_cast<HttpSession&>(*session);
+      auto it = http_session._pending_responses.find(slot);
+      if (it != http_session._pending_responses.end()) {
+        it->second.batch_posted = false;
+      }
+      http_session.writeReady();
+      http_session.flushResponses();
+    });
+  }
+
+  auto writeResponse(PendingResponse& pending) -> void {
+    if (!pending.serialized) {
+      writeHead(pending.response, pending.server);
+      return;
+    }
+
+    // The Connection header goes right after the status line.
+    const auto bytes = std::string_view{*pending.serialized};
+    const auto status_line = bytes.substr(0, bytes.find(CRLF) + CRLF.size());
+    _output.append(status_line.data(), status_line.size());
+    auto connection = std::string_view{};
+    if (_next_write == _close_slot) {
+      connection = "Connection: close\r\n";
+    } else if (_keep_alive_header) {
+      connection = "Connection: keep-alive\r\n";
+    }
+    _output.append(connection.data(), connection.size());
+    _output.append(bytes.data() + status_line.size(),
+                   bytes.size() - status_line.size());
+  }
+
+  auto writeHead(HttpResponse& response, std::string_view server) -> void {
+    if (_next_write == _close_slot) {
+      response.addHeader("Connection", "close");
+    } else if (response.closesConnection()) {
+      closeAfter(_next_write);
+    } else if (_keep_alive_header) {
+      response.addHeader("Connection", "keep-alive");
+    }
+
+    response.serialize(_output, server);
+  }
+
  private:
   HttpRequestParse _http_request_parse;
+  HttpRoute _route;
+  net::Buffer _backlog;
+  std::function<void()> _on_resume;
+  bool _reading_paused{false};
+  net::Buffer _output;
+  std::uint64_t _next_response{0};
+  std::uint64_t _next_write{0};
+  std::map<std::uint64_t, PendingResponse> _pending_responses;
+  std::uint64_t _close_slot{NO_SLOT};
+  bool _keep_alive_header{false};
+  Timeouts _timeouts;
+  TimerWheel::TimerId _timer{TimerWheel::INVALID_TIMER};
+  Phase _phase{Phase::None};
+  bool _has_input{false};
+  std::shared_ptr<HttpMetrics> _metrics;
+  std::string _peer_address;
+  std::size_t _unparsed{0};
+  std::unique_ptr<WebSocketState> _websocket;
+  bool _flush_posted{false};
 };
 
 }  // namespace fz::http
@@ -0,0 +1,82 @@
+#ifndef __FZ_HTTP_HTTP_STATIC_FILES_H__
+#define __FZ_HTTP_HTTP_STATIC_FILES_H__
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http/http_request.h"
+#include "http/http_response.h"
+
+namespace fz::http {
+
+/**
+ * @brief Serves files below a root directory.
+ *
+ * Files are mapped with mmap(2) and kept in an LRU cache of open mappings
+ * keyed by path and validated against the file's mtime, size and inode on
+ * every request, so a hot file costs one stat(2) and no read(2). Responses
+ * borrow the mapping instead of copying the file into a string.
+ *
+ * Supports ETag/Last-Modified with 304 responses (If-None-Match, exact
+ * If-Modified-Since) and single byte ranges.
+ *
+ * Files should be replaced atomically (write elsewhere, then rename) rather
+ * than rewritten in place, which would change or truncate mappings that
+ * responses still reference.
+ */
+class HttpStaticFiles {
+ public:
+  struct Options {
+    std::size_t max_cached_files{1024};
+    std::size_t max_cached_bytes{std::size_t{256} << 20};
+    std::string index{"index.html"};
+  };
+
+  explicit HttpStaticFiles(std::filesystem::path root)
+      : HttpStaticFiles{std::move(root), Options{}} {}
+
+  HttpStaticFiles(std::filesystem::path root, Options options);
+
+  ~HttpStaticFiles();
+
+  HttpStaticFiles(const HttpStaticFiles&) = delete;
+
+  auto operator=(const HttpStaticFiles&) -> HttpStaticFiles& = delete;
+
+  /**
+   * @brief Serve the file at path, relative to the root. The path is
+   * percent-decoded first; a malformed escape, an escaped '/' or a NUL gets
+   * 400, paths that try to leave the root 403, missing files 404.
+   */
+  auto serve(const HttpRequest& request, std::string_view path)
+      -> HttpResponse;
+
+  static auto contentType(std::string_view path) -> std::string_view;
+
+ private:
+  struct File;
+
+  auto open(const std::filesystem::path& path) -> std::shared_ptr<const File>;
+
+  auto evict() -> void;
+
+  std::filesystem::path _root;
+  Options _options;
+
+  std::mutex _mutex;
+  std::list<std::shared_ptr<const File>> _lru;  // most recently used first
+  std::unordered_map<std::string,
+                     std::list<std::shared_ptr<const File>>::iterator>
+      _files;
+  std::size_t _cached_bytes{0};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_STATIC_FILES_H__
@@ -0,0 +1,86 @@
+#ifndef __FZ_HTTP_HTTP_VALIDATORS_H__
+#define __FZ_HTTP_HTTP_VALIDATORS_H__
+
+#include <string>
+#include <string_view>
+
+#include "http/http_header.h"
+#include "http/http_request.h"
+#include "http/http_response.h"
+
+namespace fz::http {
+
+/**
+ * @brief ETag and Last-Modified of a representation, which let a client
+ * that already holds it revalidate with If-None-Match or If-Modified-Since
+ * and get a 304 instead of the body. Either may be empty.
+ */
+struct HttpValidators {
+  // Quoted, optionally weak: "\"v42\"" or "W/\"v42\"".
+  std::string etag;
+  // An IMF-fixdate, see HttpDate.
+  std::string last_modified;
+
+  /**
+   * @brief Whether the client's copy is current: If-None-Match lists etag
+   * (weak comparison) or "*", or without If-None-Match, If-Modified-Since
+   * is last_modified. The date is compared as is, clients send back the
+   * one they were given.
+   */
+  auto notModified(const HttpRequest& request) const -> bool {
+    if (request.hasHeader(HttpHeader::IfNoneMatch)) {
+      return !etag.empty() &&
+             etagMatches(request.header(HttpHeader::IfNoneMatch), etag);
+    }
+    return !last_modified.empty() &&
+           request.header(HttpHeader::IfModifiedSince) == last_modified;
+  }
+
+  /**
+   * @brief Add the ETag and Last-Modified headers response doesn't set.
+   */
+  auto addTo(HttpResponse& response) const -> void {
+    if (!etag.empty() && response.header("ETag").empty()) {
+      response.addHeader("ETag", etag);
+    }
+    if (!last_modified.empty() && response.header("Last-Modified").empty()) {
+      response.addHeader("Last-Modified", last_modified);
+    }
+  }
+
+  /**
+   * @brief Whether the If-None-Match list if_none_match holds etag, ignoring
+   * the weak prefix on both sides.
+   */
+  static auto etagMatches(std::string_view if_none_match,
+                          std::string_view etag) -> bool {
+    if (etag.starts_with("W/")) {
+      etag.remove_prefix(2);
+    }
+    while (!if_none_match.empty()) {
+      const auto comma = if_none_match.find(',');
+      auto candidate = if_none_match.substr(0, comma);
+      while (!candidate.empty() && candidate.front() == ' ') {
+        candidate.remove_prefix(1);
+      }
+      while (!candidate.empty() && candidate.back() == ' ') {
+        candidate.remove_suffix(1);
+      }
+      if (candidate.starts_with("W/")) {
+        candidate.remove_prefix(2);
+      }
+      if (candidate == "*" || candidate == etag) {
+        return true;
+      }
+      if (comma == std::string_view::npos) {
+        break;
+      }
+      if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+  }
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_HTTP_VALIDATORS_H__
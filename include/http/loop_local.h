@@ -0,0 +1,84 @@
+#ifndef __FZ_HTTP_LOOP_LOCAL_H__
+#define __FZ_HTTP_LOOP_LOCAL_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief A T for every thread that uses it, e.g. the state of a handler
+ * that each loop keeps to itself instead of sharing one behind a lock.
+ *
+ * local() gives the calling thread its own value, made on its first call,
+ * and after that is a short scan of a thread_local list without a lock.
+ * With the loops pinned (HttpServer::pinThreads()), a value is only ever
+ * touched from one core.
+ *
+ * The values live as long as the LoopLocal. forEach() reads them from
+ * another thread, so whatever it reads while loops may write has to be
+ * atomic.
+ */
+template <typename T>
+class LoopLocal {
+ public:
+  LoopLocal() : LoopLocal{[] { return T{}; }} {}
+
+  /**
+   * @brief make creates the value of each thread, called with a lock held
+   * so it may count the values made before.
+   */
+  explicit LoopLocal(std::function<T()> make)
+      : _id{next_id.fetch_add(1)}, _make{std::move(make)} {}
+
+  LoopLocal(const LoopLocal&) = delete;
+
+  auto operator=(const LoopLocal&) -> LoopLocal& = delete;
+
+  auto local() -> T& {
+    // An entry left behind by a destroyed instance is never matched again,
+    // since ids aren't reused.
+    thread_local auto values = std::vector<std::pair<std::uint64_t, T*>>{};
+    for (const auto& [id, value] : values) {
+      if (id == _id) {
+        return *value;
+      }
+    }
+
+    auto lock = std::lock_guard{_mutex};
+    _values.push_back(std::unique_ptr<T>{new T(_make())});
+    values.emplace_back(_id, _values.back().get());
+    return *_values.back();
+  }
+
+  template <typename F>
+  auto forEach(F&& f) const -> void {
+    auto lock = std::lock_guard{_mutex};
+    for (const auto& value : _values) {
+      f(static_cast<const T&>(*value));
+    }
+  }
+
+  auto size() const -> std::size_t {
+    auto lock = std::lock_guard{_mutex};
+    return _values.size();
+  }
+
+ private:
+  inline static std::atomic<std::uint64_t> next_id{1};
+
+  std::uint64_t _id;
+  std::function<T()> _make;
+  mutable std::mutex _mutex;
+  std::vector<std::unique_ptr<T>> _values;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_LOOP_LOCAL_H__
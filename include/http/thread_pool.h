@@ -0,0 +1,78 @@
+#ifndef __FZ_HTTP_THREAD_POOL_H__
+#define __FZ_HTTP_THREAD_POOL_H__
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief Fixed size pool for work that must not run on an event loop. The
+ * destructor finishes the queued tasks before joining.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(std::size_t thread_num) {
+    _threads.reserve(thread_num);
+    for (std::size_t i = 0; i < thread_num; ++i) {
+      _threads.emplace_back([this] { run(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+  ~ThreadPool() {
+    {
+      auto lock = std::lock_guard{_mutex};
+      _stopped = true;
+    }
+    _cv.notify_all();
+    for (auto& thread : _threads) {
+      thread.join();
+    }
+  }
+
+  auto submit(std::function<void()> task) -> void {
+    {
+      auto lock = std::lock_guard{_mutex};
+      _tasks.push(std::move(task));
+    }
+    _cv.notify_one();
+  }
+
+  auto size() const { return _threads.size(); }
+
+ private:
+  auto run() -> void {
+    while (true) {
+      auto task = std::function<void()>{};
+      {
+        auto lock = std::unique_lock{_mutex};
+        _cv.wait(lock, [this] { return _stopped || !_tasks.empty(); });
+        if (_tasks.empty()) {
+          return;
+        }
+        task = std::move(_tasks.front());
+        _tasks.pop();
+      }
+      task();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::queue<std::function<void()>> _tasks;
+  bool _stopped{false};
+  std::vector<std::thread> _threads;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_THREAD_POOL_H__
@@ -0,0 +1,219 @@
+#ifndef __FZ_HTTP_TIMER_WHEEL_H__
+#define __FZ_HTTP_TIMER_WHEEL_H__
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace fz::http {
+
+/**
+ * @brief Hierarchical timing wheel: LEVELS wheels of SLOTS slots, where a
+ * slot of level n spans SLOTS^n ticks. Adding and cancelling a timer is
+ * O(1), and a tick only visits one slot of the lowest level, plus one slot
+ * of a higher level every SLOTS ticks to move its timers down. The cost of a
+ * tick doesn't depend on how many timers are waiting.
+ *
+ * Timers fire on the first tick at or after their deadline, so they are at
+ * most one tick late. Delays beyond the range of the wheel are clamped to
+ * it. Not thread safe, meant to be owned and advanced by one loop.
+ */
+class TimerWheel {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+  using TimerId = std::uint64_t;
+
+  constexpr static auto DEFAULT_TICK = std::chrono::milliseconds{100};
+  constexpr static auto SLOT_BITS = 6;
+  constexpr static auto SLOTS = std::size_t{1} << SLOT_BITS;
+  constexpr static auto LEVELS = 4;
+  constexpr static auto INVALID_TIMER = TimerId{0};
+
+  explicit TimerWheel(Clock::duration tick = DEFAULT_TICK,
+                      Clock::time_point now = Clock::now())
+      : _tick{tick}, _start{now} {
+    _heads.fill(NIL);
+  }
+
+  auto tick() const { return _tick; }
+
+  /**
+   * @brief Number of timers waiting to fire.
+   */
+  auto size() const { return _size; }
+
+  /**
+   * @brief Run callback once delay has passed.
+   */
+  auto add(Clock::duration delay, Callback callback) -> TimerId {
+    auto ticks = (delay + _tick - Clock::duration{1}) / _tick;
+    ticks = std::clamp<decltype(ticks)>(ticks, 1, MAX_TICKS);
+
+    auto index = NIL;
+    if (_free != NIL) {
+      index = _free;
+      _free = _nodes[index].next;
+    } else {
+      index = static_cast<std::uint32_t>(_nodes.size());
+      _nodes.emplace_back();
+    }
+
+    auto& node = _nodes[index];
+    node.callback = std::move(callback);
+    node.expire = _now + static_cast<std::uint64_t>(ticks);
+    node.active = true;
+    place(index);
+    ++_size;
+    return (static_cast<TimerId>(node.generation) << 32) | (index + 1);
+  }
+
+  /**
+   * @brief Cancel a timer that hasn't fired yet. Ids of timers that already
+   * fired or were cancelled are ignored.
+   */
+  auto cancel(TimerId id) -> void {
+    const auto index = static_cast<std::uint32_t>(id) - 1;
+    if (id == INVALID_TIMER || _nodes.size() <= index) {
+      return;
+    }
+
+    const auto& node = _nodes[index];
+    const auto generation = static_cast<std::uint32_t>(id >> 32);
+    if (!node.active || node.generation != generation) {
+      return;
+    }
+
+    unlink(index);
+    release(index);
+  }
+
+  /**
+   * @brief Fire every timer whose deadline is at or before now. Callbacks may
+   * add and cancel timers.
+   */
+  auto advance(Clock::time_point now = Clock::now()) -> void {
+    if (now < _start) {
+      return;
+    }
+
+    const auto target = static_cast<std::uint64_t>((now - _start) / _tick);
+    while (_now < target) {
+      ++_now;
+      cascade();
+
+      const auto slot = static_cast<std::size_t>(_now & (SLOTS - 1));
+      while (_heads[slot] != NIL) {
+        const auto index = _heads[slot];
+        unlink(index);
+        auto callback = std::move(_nodes[index].callback);
+        release(index);
+        callback();
+      }
+    }
+  }
+
+ private:
+  constexpr static auto NIL = std::numeric_limits<std::uint32_t>::max();
+  constexpr static auto MAX_TICKS =
+      static_cast<std::int64_t>((std::uint64_t{1} << (SLOT_BITS * LEVELS)) -
+                                1);
+
+  struct Node {
+    Callback callback;
+    std::uint64_t expire{0};
+    std::uint32_t prev{NIL};
+    std::uint32_t next{NIL};
+    std::uint32_t generation{1};
+    std::uint16_t slot{0};
+    bool active{false};
+  };
+
+  /**
+   * @brief Put a node in the slot for its deadline: the lowest level whose
+   * span still covers the distance to it.
+   */
+  auto place(std::uint32_t index) -> void {
+    auto& node = _nodes[index];
+    const auto delta = node.expire - _now;
+
+    auto level = 0;
+    while (level + 1 < LEVELS && (SLOTS << (SLOT_BITS * level)) <= delta) {
+      ++level;
+    }
+
+    const auto slot = level * SLOTS +
+                      ((node.expire >> (SLOT_BITS * level)) & (SLOTS - 1));
+    node.slot = static_cast<std::uint16_t>(slot);
+    node.prev = NIL;
+    node.next = _heads[slot];
+    if (node.next != NIL) {
+      _nodes[node.next].prev = index;
+    }
+    _heads[slot] = index;
+  }
+
+  auto unlink(std::uint32_t index) -> void {
+    auto& node = _nodes[index];
+    if (node.prev != NIL) {
+      _nodes[node.prev].next = node.next;
+    } else {
+      _heads[node.slot] = node.next;
+    }
+
+    if (node.next != NIL) {
+      _nodes[node.next].prev = node.prev;
+    }
+  }
+
+  auto release(std::uint32_t index) -> void {
+    auto& node = _nodes[index];
+    node.callback = nullptr;
+    node.active = false;
+    ++node.generation;
+    node.next = _free;
+    _free = index;
+    --_size;
+  }
+
+  /**
+   * @brief Each time a level wraps around, move the timers of the next
+   * level's current slot down to where they belong now.
+   */
+  auto cascade() -> void {
+    for (auto level = 1; level < LEVELS; ++level) {
+      if ((_now & ((std::uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+        break;
+      }
+
+      const auto slot =
+          level * SLOTS + ((_now >> (SLOT_BITS * level)) & (SLOTS - 1));
+      auto index = _heads[slot];
+      _heads[slot] = NIL;
+      while (index != NIL) {
+        const auto next = _nodes[index].next;
+        place(index);
+        index = next;
+      }
+    }
+  }
+
+ private:
+  Clock::duration _tick;
+  Clock::time_point _start;
+  std::uint64_t _now{0};
+  std::size_t _size{0};
+  std::vector<Node> _nodes;
+  std::uint32_t _free{NIL};
+  std::array<std::uint32_t, SLOTS * LEVELS> _heads;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_TIMER_WHEEL_H__
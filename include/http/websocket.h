@@ -0,0 +1,168 @@
+#ifndef __FZ_HTTP_WEBSOCKET_H__
+#define __FZ_HTTP_WEBSOCKET_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/http_request.h"
+#include "http/websocket_frame.h"
+#include "net/loop.h"
+#include "net/session.h"
+
+namespace fz::http {
+
+/**
+ * @brief Handle to an upgraded connection, cheap to copy and to keep. Every
+ * call may come from any thread and is posted to the connection's loop, in
+ * order; calls on a closed connection do nothing.
+ */
+class WebSocket {
+ public:
+  WebSocket() = default;
+
+  explicit WebSocket(std::weak_ptr<net::Session> session)
+      : _session{std::move(session)} {}
+
+  auto send(std::string_view text) const -> void {
+    sendFrame(WebSocketFrame::Opcode::Text, text);
+  }
+
+  auto sendBinary(std::string_view data) const -> void {
+    sendFrame(WebSocketFrame::Opcode::Binary, data);
+  }
+
+  /**
+   * @brief Send a frame serialized with WebSocketFrame::serialize(), e.g.
+   * to send the same message to many connections without encoding it for
+   * each. See WebSocketBroadcast for that.
+   */
+  auto sendSerialized(std::shared_ptr<const std::string> frame) const -> void;
+
+  auto ping(std::string_view payload = {}) const -> void {
+    sendFrame(WebSocketFrame::Opcode::Ping,
+              payload.substr(0, WebSocketFrame::MAX_CONTROL_PAYLOAD));
+  }
+
+  /**
+   * @brief Start the closing handshake. The connection closes once the
+   * client answers, or after a few seconds without an answer.
+   */
+  auto close(std::uint16_t code = WebSocketFrame::NORMAL,
+             std::string_view reason = {}) const -> void;
+
+  /**
+   * @brief Whether the connection is still open, which may change right
+   * after the call.
+   */
+  auto connected() const -> bool { return !_session.expired(); }
+
+  /**
+   * @brief Handles of the same connection compare equal, also after it
+   * closed.
+   */
+  auto operator==(const WebSocket& other) const -> bool {
+    return !_session.owner_before(other._session) &&
+           !other._session.owner_before(_session);
+  }
+
+ private:
+  friend class WebSocketBroadcast;
+
+  auto sendFrame(WebSocketFrame::Opcode opcode, std::string_view payload) const
+      -> void;
+
+  std::weak_ptr<net::Session> _session;
+};
+
+/**
+ * @brief Callbacks and settings of a WebSocket route, see
+ * HttpServer::webSocket(). The callbacks run on the connection's loop and
+ * must not block it.
+ */
+struct WebSocketHandler {
+  // After the handshake, with the upgrade request.
+  std::function<void(const WebSocket& socket, const HttpRequest& request)>
+      on_open;
+  // Every complete Text or Binary message.
+  std::function<void(const WebSocket& socket, std::string_view message,
+                     bool binary)>
+      on_message;
+  // Once per connection, with the code of the client's close frame or
+  // WebSocketFrame::ABNORMAL when the connection ended without one. The
+  // handle can't send anymore but still compares equal to the others.
+  std::function<void(const WebSocket& socket, std::uint16_t code)> on_close;
+
+  std::size_t max_message_size{std::size_t{1} << 20};
+  // A connection is pinged after an interval without hearing from the
+  // client, and closed if the next interval passes in silence too. Zero
+  // disables pings.
+  std::chrono::milliseconds ping_interval{std::chrono::seconds{30}};
+
+  /**
+   * @brief Sec-WebSocket-Accept for the client's Sec-WebSocket-Key.
+   */
+  static auto acceptKey(std::string_view key) -> std::string;
+};
+
+/**
+ * @brief A set of connections that receive the same messages, e.g. the
+ * subscribers of a feed. Safe to use from any thread.
+ *
+ * publish() serializes the frame once and posts a single task per loop,
+ * which writes the same bytes to every subscriber on that loop. The
+ * subscriber lists are copied on write, so publishing never copies them
+ * and never waits for a subscription change for longer than a pointer
+ * copy.
+ *
+ * Closed connections are skipped and dropped on the next subscription
+ * change; unsubscribing them in on_close frees them sooner.
+ */
+class WebSocketBroadcast {
+ public:
+  auto subscribe(const WebSocket& socket) -> void;
+
+  auto unsubscribe(const WebSocket& socket) -> void;
+
+  auto size() const -> std::size_t;
+
+  auto publish(std::string_view message, bool binary = false) const -> void {
+    auto frame = std::make_shared<std::string>();
+    WebSocketFrame::serialize(*frame,
+                              binary ? WebSocketFrame::Opcode::Binary
+                                     : WebSocketFrame::Opcode::Text,
+                              message);
+    publishSerialized(std::move(frame));
+  }
+
+  auto publishSerialized(std::shared_ptr<const std::string> frame) const
+      -> void;
+
+ private:
+  using Members = std::vector<std::weak_ptr<net::Session>>;
+
+  struct Group {
+    std::shared_ptr<net::Loop> loop;
+    std::shared_ptr<Members> members;
+  };
+
+  /**
+   * @brief The members of group, copied first if a publish still reads
+   * them. Called with the mutex held.
+   */
+  static auto writable(Group& group) -> Members&;
+
+  mutable std::mutex _mutex;
+  // One per loop, so a publish posts one task per loop.
+  std::vector<Group> _groups;
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_WEBSOCKET_H__
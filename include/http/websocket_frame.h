@@ -0,0 +1,138 @@
+#ifndef __FZ_HTTP_WEBSOCKET_FRAME_H__
+#define __FZ_HTTP_WEBSOCKET_FRAME_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace fz::http {
+
+/**
+ * @brief WebSocket frame encoding (RFC 6455, section 5): frames written by
+ * the server, which are never masked, and the masking of the frames clients
+ * send.
+ *
+ * Unmasking touches every byte a client sends, so the kernel is chosen at
+ * runtime like HttpScanner's: AVX2 or SSE2 on x86 when the CPU supports
+ * them, eight bytes at a time otherwise.
+ */
+class WebSocketFrame {
+ public:
+  enum class Opcode : std::uint8_t {
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xa
+  };
+
+  enum CloseCode : std::uint16_t {
+    NORMAL = 1000,
+    GOING_AWAY = 1001,
+    PROTOCOL_ERROR = 1002,
+    UNSUPPORTED_DATA = 1003,
+    // Never sent, reported when a close frame carries no code.
+    NO_STATUS = 1005,
+    // Never sent, reported when the connection ended without a close frame.
+    ABNORMAL = 1006,
+    INVALID_PAYLOAD = 1007,
+    POLICY_VIOLATION = 1008,
+    MESSAGE_TOO_BIG = 1009,
+    INTERNAL_ERROR = 1011
+  };
+
+  enum class Kernel : std::uint8_t { Scalar, SSE2, AVX2 };
+
+  using MaskingKey = std::array<std::uint8_t, 4>;
+
+  constexpr static auto MAX_HEADER_SIZE = std::size_t{14};
+  constexpr static auto MAX_CONTROL_PAYLOAD = std::size_t{125};
+
+  constexpr static auto isControl(Opcode opcode) -> bool {
+    return (static_cast<std::uint8_t>(opcode) & 0x8) != 0;
+  }
+
+  /**
+   * @brief Append a frame to out, which can be anything with
+   * append(const char*, std::size_t), e.g. std::string or net::Buffer.
+   * Clear fin for every fragment of a message but the last.
+   */
+  template <typename Output>
+  static auto serialize(Output& out, Opcode opcode, std::string_view payload,
+                        bool fin = true) -> void {
+    auto header = std::array<char, MAX_HEADER_SIZE>{};
+    header[0] = static_cast<char>((fin ? 0x80 : 0x00) |
+                                  static_cast<std::uint8_t>(opcode));
+    auto size = std::size_t{2};
+    if (payload.size() < 126) {
+      header[1] = static_cast<char>(payload.size());
+    } else if (payload.size() <= 0xffff) {
+      header[1] = 126;
+      size = 4;
+    } else {
+      header[1] = 127;
+      size = 10;
+    }
+
+    // The extended length is big endian.
+    auto length = static_cast<std::uint64_t>(payload.size());
+    for (auto i = size; i > 2; --i) {
+      header[i - 1] = static_cast<char>(length & 0xff);
+      length >>= 8;
+    }
+
+    out.append(header.data(), size);
+    out.append(payload.data(), payload.size());
+  }
+
+  static auto make(Opcode opcode, std::string_view payload) -> std::string {
+    auto frame = std::string{};
+    frame.reserve(MAX_HEADER_SIZE + payload.size());
+    serialize(frame, opcode, payload);
+    return frame;
+  }
+
+  /**
+   * @brief Payload of a close frame: the code, then reason cut to fit a
+   * control frame.
+   */
+  static auto closePayload(std::uint16_t code, std::string_view reason = {})
+      -> std::string;
+
+  /**
+   * @brief XOR size bytes at data with key, starting offset bytes into it.
+   * Masking and unmasking are the same operation.
+   */
+  static auto mask(char* data, std::size_t size, MaskingKey key,
+                   std::size_t offset = 0) -> void;
+
+  static auto mask(Kernel kernel, char* data, std::size_t size,
+                   MaskingKey key, std::size_t offset = 0) -> void;
+
+  /**
+   * @brief Whether data is well-formed UTF-8, as text messages must be.
+   */
+  static auto validUtf8(std::string_view data) -> bool;
+
+  static auto kernel() -> Kernel;
+
+  static auto supported(Kernel kernel) -> bool;
+
+  static auto kernelToString(Kernel kernel) -> std::string_view {
+    switch (kernel) {
+      case Kernel::SSE2:
+        return "sse2";
+      case Kernel::AVX2:
+        return "avx2";
+      default:
+        return "scalar";
+    }
+  }
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_WEBSOCKET_FRAME_H__
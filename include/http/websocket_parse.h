@@ -0,0 +1,231 @@
+#ifndef __FZ_HTTP_WEBSOCKET_PARSE_H__
+#define __FZ_HTTP_WEBSOCKET_PARSE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "http/websocket_frame.h"
+#include "net/common/buffer.h"
+
+namespace fz::http {
+
+/**
+ * @brief Incremental parser for the frames a client sends on an upgraded
+ * connection.
+ *
+ * A frame is handled once it is in the buffer as a whole. Its payload is
+ * unmasked in place, so a message that fits in one frame is handed over
+ * without a copy; the fragments of a longer one are gathered first. Control
+ * frames are handed over as they come, also between two fragments.
+ *
+ * Anything RFC 6455 forbids makes the parser INVALID with the close code
+ * to answer with: unmasked or reserved bits, unknown opcodes, fragmented or
+ * oversized control frames, fragments out of sequence, text that isn't
+ * UTF-8 and messages over the size limit, which is checked before the
+ * frame is buffered.
+ */
+class WebSocketParse {
+ public:
+  using Opcode = WebSocketFrame::Opcode;
+
+  enum class Status : std::uint8_t {
+    // Waiting for the rest of a frame, possibly with part of a message.
+    Frame,
+    // A close frame was parsed, nothing after it is read.
+    Closed,
+    INVALID
+  };
+
+  struct Limits {
+    std::size_t max_message_size{std::size_t{1} << 20};
+  };
+
+  auto status() const { return _status; }
+
+  /**
+   * @brief Close code for an INVALID parser.
+   */
+  auto closeCode() const { return _close_code; }
+
+  auto setLimits(const Limits& limits) -> void { _limits = limits; }
+
+  /**
+   * @brief Parse every complete frame in buffer. on_message(opcode, payload)
+   * gets each Text or Binary message once all its fragments are in, and
+   * each Ping, Pong and Close frame. The payload is only valid during the
+   * call.
+   */
+  template <typename OnMessage>
+  auto run(net::Buffer& buffer, OnMessage&& on_message) -> void {
+    while (_status == Status::Frame && parseFrame(buffer, on_message)) {
+    }
+  }
+
+  auto reset() -> void {
+    _status = Status::Frame;
+    _close_code = WebSocketFrame::NORMAL;
+    _message.clear();
+    _fragmented = false;
+  }
+
+ private:
+  template <typename OnMessage>
+  auto parseFrame(net::Buffer& buffer, OnMessage& on_message) -> bool {
+    const auto data = std::string_view{buffer.peek(), buffer.readableBytes()};
+    if (data.size() < 2) {
+      return false;
+    }
+
+    const auto first = static_cast<std::uint8_t>(data[0]);
+    const auto second = static_cast<std::uint8_t>(data[1]);
+    const auto fin = (first & 0x80) != 0;
+    const auto opcode = static_cast<Opcode>(first & 0x0f);
+    const auto control = WebSocketFrame::isControl(opcode);
+    auto length = static_cast<std::uint64_t>(second & 0x7f);
+
+    // Clients must mask every frame, and no extension is negotiated that
+    // would give meaning to the reserved bits.
+    if ((first & 0x70) != 0 || (second & 0x80) == 0 || !known(opcode) ||
+        (control && (!fin || length > WebSocketFrame::MAX_CONTROL_PAYLOAD))) {
+      return invalid(WebSocketFrame::PROTOCOL_ERROR);
+    }
+    if (opcode == Opcode::Continuation ? !_fragmented
+                                       : (!control && _fragmented)) {
+      return invalid(WebSocketFrame::PROTOCOL_ERROR);
+    }
+
+    auto header_size = std::size_t{2};
+    if (length >= 126) {
+      const auto extended = std::size_t{length == 126 ? 2U : 8U};
+      if (data.size() < header_size + extended) {
+        return false;
+      }
+      length = 0;
+      for (std::size_t i = 0; i < extended; ++i) {
+        length = (length << 8) | static_cast<std::uint8_t>(data[2 + i]);
+      }
+      header_size += extended;
+    }
+
+    if (!control && (_limits.max_message_size < length ||
+                     _limits.max_message_size - length < _message.size())) {
+      return invalid(WebSocketFrame::MESSAGE_TOO_BIG);
+    }
+
+    auto key = WebSocketFrame::MaskingKey{};
+    if (data.size() < header_size + key.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < key.size(); ++i) {
+      key[i] = static_cast<std::uint8_t>(data[header_size + i]);
+    }
+    header_size += key.size();
+
+    if (data.size() - header_size < length) {
+      return false;
+    }
+
+    // The buffer owns these bytes; peek() is only const to keep callers
+    // from writing by accident.
+    auto* payload = const_cast<char*>(data.data()) + header_size;
+    const auto size = static_cast<std::size_t>(length);
+    WebSocketFrame::mask(payload, size, key);
+    const auto frame_size = header_size + size;
+
+    if (control) {
+      const auto view = std::string_view{payload, size};
+      if (opcode == Opcode::Close && !validClose(view)) {
+        return invalid(WebSocketFrame::PROTOCOL_ERROR);
+      }
+      if (opcode == Opcode::Close) {
+        _status = Status::Closed;
+      }
+      on_message(opcode, view);
+      buffer.retrieve(frame_size);
+      return true;
+    }
+
+    if (fin && !_fragmented) {
+      const auto view = std::string_view{payload, size};
+      if (opcode == Opcode::Text && !WebSocketFrame::validUtf8(view)) {
+        return invalid(WebSocketFrame::INVALID_PAYLOAD);
+      }
+      on_message(opcode, view);
+      buffer.retrieve(frame_size);
+      return true;
+    }
+
+    if (!_fragmented) {
+      _fragmented = true;
+      _message_opcode = opcode;
+    }
+    _message.append(payload, size);
+    buffer.retrieve(frame_size);
+    if (!fin) {
+      return true;
+    }
+
+    _fragmented = false;
+    if (_message_opcode == Opcode::Text &&
+        !WebSocketFrame::validUtf8(_message)) {
+      return invalid(WebSocketFrame::INVALID_PAYLOAD);
+    }
+    on_message(_message_opcode, std::string_view{_message});
+    _message.clear();
+    return true;
+  }
+
+  constexpr static auto known(Opcode opcode) -> bool {
+    switch (opcode) {
+      case Opcode::Continuation:
+      case Opcode::Text:
+      case Opcode::Binary:
+      case Opcode::Close:
+      case Opcode::Ping:
+      case Opcode::Pong:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * @brief A close payload is empty or a code a peer may send, followed by
+   * a UTF-8 reason.
+   */
+  static auto validClose(std::string_view payload) -> bool {
+    if (payload.empty()) {
+      return true;
+    }
+    if (payload.size() < 2) {
+      return false;
+    }
+
+    const auto code = static_cast<std::uint16_t>(
+        (static_cast<std::uint8_t>(payload[0]) << 8) |
+        static_cast<std::uint8_t>(payload[1]));
+    const auto registered =
+        (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011);
+    return (registered || (code >= 3000 && code <= 4999)) &&
+           WebSocketFrame::validUtf8(payload.substr(2));
+  }
+
+  auto invalid(std::uint16_t close_code) -> bool {
+    _status = Status::INVALID;
+    _close_code = close_code;
+    return false;
+  }
+
+  Status _status{Status::Frame};
+  std::uint16_t _close_code{WebSocketFrame::NORMAL};
+  Limits _limits;
+  std::string _message;
+  Opcode _message_opcode{Opcode::Text};
+  bool _fragmented{false};
+};
+
+}  // namespace fz::http
+
+#endif  // __FZ_HTTP_WEBSOCKET_PARSE_H__
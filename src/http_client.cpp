@@ -0,0 +1,896 @@
+#include "http/http_client.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <system_error>
+#include <utility>
+
+#include "http/http_chunked_writer.h"
+#include "net/common/buffer.h"
+
+namespace fz::http {
+
+namespace {
+
+// epoll data of the eventfd, connections are numbered from 1.
+constexpr auto WAKE_ID = std::uint64_t{0};
+constexpr auto READ_SIZE = std::size_t{64 * 1024};
+
+auto poolKey(std::string_view host, std::uint16_t port) -> std::string {
+  auto key = std::string{host};
+  key += ':';
+  key += std::to_string(port);
+  return key;
+}
+
+/**
+ * @brief Request line, Host and the request's headers except the framing
+ * ones, without the empty line that ends the head.
+ */
+auto appendHead(std::string& out, const HttpRequest& request,
+                std::string_view host, std::uint16_t port) -> void {
+  const auto version = request.version() == HttpRequest::UNKNOWN
+                           ? HttpRequest::HTTP_1_1
+                           : request.version();
+
+  out += HttpRequest::methodToString(request.method());
+  out += SPACE;
+  if (!request.target().empty()) {
+    out += request.target();
+  } else {
+    out += request.path().empty() ? std::string_view{"/"} : request.path();
+    auto separator = '?';
+    for (const auto& [key, value] : request.querys()) {
+      out += separator;
+      out += key;
+      out += '=';
+      out += value;
+      separator = '&';
+    }
+  }
+  out += SPACE;
+  out += HttpRequest::versionToString(version);
+  out += CRLF;
+
+  if (!request.hasHeader(HttpHeader::Host)) {
+    out += "Host: ";
+    out += host;
+    if (port != 80) {
+      out += ':';
+      out += std::to_string(port);
+    }
+    out += CRLF;
+  }
+
+  for (const auto& [key, value] : request.headers()) {
+    const auto id = headerFromString(key);
+    if (id == HttpHeader::ContentLength || id == HttpHeader::TransferEncoding) {
+      continue;
+    }
+    out += key;
+    out += COLON;
+    out += value;
+    out += CRLF;
+  }
+}
+
+/**
+ * @brief The transfer codings of request other than chunked, which the
+ * caller applied to the body and are sent on as they are, e.g. "gzip".
+ */
+auto transferCodings(const HttpRequest& request) -> std::string {
+  auto codings = std::string{};
+  request.forEachHeaderElement(
+      HttpHeader::TransferEncoding, [&codings](std::string_view coding) {
+        if (coding.empty() || equalsIgnoreCase(coding, "chunked")) {
+          return;
+        }
+        if (!codings.empty()) {
+          codings += ", ";
+        }
+        codings += coding;
+      });
+  return codings;
+}
+
+auto appendTransferEncoding(std::string& out, const HttpRequest& request)
+    -> void {
+  const auto codings = transferCodings(request);
+  out += "Transfer-Encoding: ";
+  if (!codings.empty()) {
+    out += codings;
+    out += ", ";
+  }
+  out += "chunked";
+  out += CRLF;
+}
+
+}  // namespace
+
+struct HttpClient::Pending {
+  std::string data;
+  bool head{false};
+  Callback callback;
+  TimerWheel::TimerId timer{TimerWheel::INVALID_TIMER};
+  // Only for stream().
+  std::shared_ptr<RequestBody> body;
+  HeadCallback on_head;
+};
+
+struct HttpClient::Submission {
+  std::string host;
+  std::uint16_t port{0};
+  Pending pending;
+};
+
+struct HttpClient::Connection {
+  std::uint64_t id{0};
+  int fd{-1};
+  Pool* pool{nullptr};
+  bool connected{false};
+  // The server announced it closes the connection after the current
+  // response, so nothing more is sent on it.
+  bool closing{false};
+  bool want_write{false};
+  TimerWheel::TimerId timer{TimerWheel::INVALID_TIMER};
+  std::string output;
+  std::size_t written{0};
+  // A streamed request body still being written, nothing else is sent
+  // until it is finished.
+  std::shared_ptr<RequestBody> upload;
+  // Bytes of it in output.
+  std::size_t upload_bytes{0};
+  net::Buffer input;
+  HttpResponseParse parse;
+  std::deque<Pending> in_flight;
+};
+
+struct HttpClient::Pool {
+  std::string host;
+  std::uint16_t port{0};
+  bool resolved{false};
+  sockaddr_storage address{};
+  socklen_t address_size{0};
+  std::vector<Connection*> connections;
+  std::deque<Pending> waiting;
+};
+
+auto HttpClient::RequestBody::write(std::string_view data) -> bool {
+  if (data.empty()) {
+    return true;
+  }
+
+  {
+    auto lock = std::lock_guard{_mutex};
+    if (_finished) {
+      return true;
+    }
+
+    const auto size = _queued.size();
+    if (_chunked) {
+      HttpChunkedWriter{_queued}.write(data);
+    } else {
+      _queued.append(data);
+    }
+    _unsent += _queued.size() - size;
+  }
+  _client->pushBody(shared_from_this());
+
+  if (_unsent < HIGH_WATER_MARK) {
+    return true;
+  }
+
+  // The loop may have sent everything in the meantime, and then it won't
+  // call the drain callback.
+  _blocked = true;
+  return _unsent < HIGH_WATER_MARK && _blocked.exchange(false);
+}
+
+auto HttpClient::RequestBody::finish() -> void {
+  {
+    auto lock = std::lock_guard{_mutex};
+    if (_finished) {
+      return;
+    }
+
+    _finished = true;
+    if (_chunked) {
+      HttpChunkedWriter{_queued}.finish();
+    }
+  }
+  _client->pushBody(shared_from_this());
+}
+
+auto HttpClient::Awaitable::await_suspend(std::coroutine_handle<> handle)
+    -> void {
+  _client->submit(std::move(_host), _port, std::move(_data), _head,
+                  [this, handle](Result result) {
+                    _result = std::move(result);
+                    handle.resume();
+                  });
+}
+
+HttpClient::HttpClient(const Options& options) : _options{options} {
+  _options.max_connections_per_host =
+      std::max<std::size_t>(_options.max_connections_per_host, 1);
+  _options.pipeline_depth = std::max<std::size_t>(_options.pipeline_depth, 1);
+
+  _epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  _wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (_epoll_fd < 0 || _wake_fd < 0) {
+    const auto error = errno;
+    ::close(_epoll_fd);
+    ::close(_wake_fd);
+    throw std::system_error{error, std::generic_category(), "HttpClient"};
+  }
+
+  auto event = epoll_event{};
+  event.events = EPOLLIN;
+  event.data.u64 = WAKE_ID;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &event);
+
+  _thread = std::thread{[this] { run(); }};
+}
+
+HttpClient::~HttpClient() {
+  {
+    auto lock = std::lock_guard{_mutex};
+    _stopped = true;
+  }
+  _running = false;
+  wake();
+  _thread.join();
+
+  ::close(_wake_fd);
+  ::close(_epoll_fd);
+}
+
+auto HttpClient::request(std::string_view host, std::uint16_t port,
+                         const HttpRequest& request, Callback callback)
+    -> void {
+  submit(std::string{host}, port, serialize(request, host, port),
+         request.method() == HttpRequest::HEAD, std::move(callback));
+}
+
+auto HttpClient::request(std::string_view host, std::uint16_t port,
+                         const HttpRequest& request) -> std::future<Result> {
+  auto promise = std::make_shared<std::promise<Result>>();
+  auto future = promise->get_future();
+  this->request(host, port, request, [promise](Result result) {
+    promise->set_value(std::move(result));
+  });
+  return future;
+}
+
+auto HttpClient::fetch(std::string_view host, std::uint16_t port,
+                       const HttpRequest& request) -> Awaitable {
+  return Awaitable{*this, std::string{host}, port,
+                   serialize(request, host, port),
+                   request.method() == HttpRequest::HEAD};
+}
+
+auto HttpClient::stream(std::string_view host, std::uint16_t port,
+                        const HttpRequest& request, HeadCallback on_head,
+                        Callback done) -> std::shared_ptr<RequestBody> {
+  auto data = std::string{};
+  appendHead(data, request, host, port);
+  const auto chunked = request.hasHeader(HttpHeader::TransferEncoding);
+  if (chunked) {
+    appendTransferEncoding(data, request);
+  } else if (request.hasHeader(HttpHeader::ContentLength)) {
+    data += "Content-Length: ";
+    data += request.header(HttpHeader::ContentLength);
+    data += CRLF;
+  }
+  data += CRLF;
+
+  auto body = std::shared_ptr<RequestBody>{new RequestBody{*this, chunked}};
+  auto pending = Pending{std::move(data), request.method() == HttpRequest::HEAD,
+                         std::move(done), TimerWheel::INVALID_TIMER, body,
+                         std::move(on_head)};
+  if (!pending.on_head) {
+    pending.on_head = [](const HttpResponse&) {
+      return HttpResponseParse::BodyConsumer{};
+    };
+  }
+  submit(std::string{host}, port, std::move(pending));
+  return body;
+}
+
+auto HttpClient::serialize(const HttpRequest& request, std::string_view host,
+                           std::uint16_t port) -> std::string {
+  auto out = std::string{};
+  out.reserve(256 + request.body().size());
+  appendHead(out, request, host, port);
+
+  // A body with codings of its own keeps them, and goes out as one chunk.
+  if (!transferCodings(request).empty()) {
+    appendTransferEncoding(out, request);
+    out += CRLF;
+    auto writer = HttpChunkedWriter{out};
+    writer.write(request.body());
+    writer.finish();
+    return out;
+  }
+
+  const auto method = request.method();
+  if (!request.body().empty() || method == HttpRequest::POST ||
+      method == HttpRequest::PUT) {
+    out += "Content-Length: ";
+    out += std::to_string(request.body().size());
+    out += CRLF;
+  }
+  out += CRLF;
+  out += request.body();
+  return out;
+}
+
+auto HttpClient::submit(std::string host, std::uint16_t port,
+                        std::string data, bool head, Callback callback)
+    -> void {
+  submit(std::move(host), port,
+         Pending{std::move(data), head, std::move(callback),
+                 TimerWheel::INVALID_TIMER, nullptr, nullptr});
+}
+
+auto HttpClient::submit(std::string host, std::uint16_t port, Pending pending)
+    -> void {
+  {
+    auto lock = std::lock_guard{_mutex};
+    if (!_stopped) {
+      _submissions.push_back({std::move(host), port, std::move(pending)});
+      if (_submissions.size() + _body_updates.size() == 1) {
+        wake();
+      }
+      return;
+    }
+  }
+  fail(pending, Error::Shutdown);
+}
+
+auto HttpClient::pushBody(std::shared_ptr<RequestBody> body) -> void {
+  auto lock = std::lock_guard{_mutex};
+  if (!_stopped) {
+    _body_updates.push_back(std::move(body));
+    if (_submissions.size() + _body_updates.size() == 1) {
+      wake();
+    }
+  }
+}
+
+auto HttpClient::wake() -> void {
+  const auto one = std::uint64_t{1};
+  [[maybe_unused]] const auto n = ::write(_wake_fd, &one, sizeof(one));
+}
+
+auto HttpClient::run() -> void {
+  auto events = std::array<epoll_event, 64>{};
+  const auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        _timers.tick())
+                        .count();
+
+  while (_running) {
+    const auto timeout = _timers.size() != 0 ? static_cast<int>(tick) : -1;
+    const auto n = ::epoll_wait(_epoll_fd, events.data(),
+                                static_cast<int>(events.size()), timeout);
+    for (auto i = 0; i < n; ++i) {
+      if (events[i].data.u64 == WAKE_ID) {
+        auto count = std::uint64_t{0};
+        [[maybe_unused]] const auto r =
+            ::read(_wake_fd, &count, sizeof(count));
+        takeSubmissions();
+      } else {
+        handleEvent(events[i].data.u64, events[i].events);
+      }
+    }
+    _timers.advance();
+  }
+
+  failAll(Error::Shutdown);
+}
+
+auto HttpClient::takeSubmissions() -> void {
+  auto submissions = std::vector<Submission>{};
+  auto body_updates = std::vector<std::shared_ptr<RequestBody>>{};
+  {
+    auto lock = std::lock_guard{_mutex};
+    submissions.swap(_submissions);
+    body_updates.swap(_body_updates);
+  }
+
+  // Bodies of requests still waiting for a connection are picked up when
+  // they get one.
+  for (const auto& body : body_updates) {
+    const auto it = _connections.find(body->_connection);
+    if (body->_connection != 0 && it != _connections.end() &&
+        it->second->upload == body) {
+      drainBody(*it->second);
+    }
+  }
+
+  auto touched = std::vector<Pool*>{};
+  for (auto& submission : submissions) {
+    const auto key = poolKey(submission.host, submission.port);
+    auto it = _pools.find(key);
+    if (it == _pools.end()) {
+      auto pool = std::make_unique<Pool>();
+      pool->host = std::move(submission.host);
+      pool->port = submission.port;
+      it = _pools.emplace(key, std::move(pool)).first;
+    }
+
+    auto& pool = *it->second;
+    pool.waiting.push_back(std::move(submission.pending));
+    if (std::find(touched.begin(), touched.end(), &pool) == touched.end()) {
+      touched.push_back(&pool);
+    }
+  }
+
+  for (auto* pool : touched) {
+    dispatch(*pool);
+  }
+}
+
+auto HttpClient::dispatch(Pool& pool) -> void {
+  while (!pool.waiting.empty()) {
+    // Prefer an idle connection, then a new one, then pipelining behind
+    // the fewest requests.
+    auto* best = static_cast<Connection*>(nullptr);
+    for (auto* connection : pool.connections) {
+      if (!connection->closing && !connection->upload &&
+          connection->in_flight.size() < _options.pipeline_depth &&
+          (best == nullptr ||
+           connection->in_flight.size() < best->in_flight.size())) {
+        best = connection;
+      }
+    }
+
+    if ((best == nullptr || !best->in_flight.empty()) &&
+        pool.connections.size() < _options.max_connections_per_host) {
+      auto* connection = connect(pool);
+      if (connection == nullptr) {
+        // Resolution or socket setup failed, every waiting request would
+        // fail the same way.
+        auto waiting = std::move(pool.waiting);
+        pool.waiting.clear();
+        for (auto& pending : waiting) {
+          fail(pending, Error::Connect);
+        }
+        return;
+      }
+      best = connection;
+    }
+
+    if (best == nullptr) {
+      return;
+    }
+
+    auto pending = std::move(pool.waiting.front());
+    pool.waiting.pop_front();
+    assign(*best, std::move(pending));
+  }
+}
+
+auto HttpClient::connect(Pool& pool) -> Connection* {
+  if (!pool.resolved) {
+    // Resolved once per pool, on the loop thread.
+    auto hints = addrinfo{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    auto* result = static_cast<addrinfo*>(nullptr);
+    const auto service = std::to_string(pool.port);
+    if (::getaddrinfo(pool.host.c_str(), service.c_str(), &hints, &result) !=
+            0 ||
+        result == nullptr) {
+      return nullptr;
+    }
+    std::memcpy(&pool.address, result->ai_addr, result->ai_addrlen);
+    pool.address_size = result->ai_addrlen;
+    pool.resolved = true;
+    ::freeaddrinfo(result);
+  }
+
+  const auto fd =
+      ::socket(pool.address.ss_family,
+               SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  const auto on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  auto connection = std::make_unique<Connection>();
+  connection->id = _next_id++;
+  connection->fd = fd;
+  connection->pool = &pool;
+  connection->parse.setLimits(_options.limits);
+  connection->want_write = true;
+
+  const auto result = ::connect(
+      fd, reinterpret_cast<const sockaddr*>(&pool.address), pool.address_size);
+  if (result < 0 && errno != EINPROGRESS) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  auto event = epoll_event{};
+  event.events = EPOLLIN | EPOLLOUT;
+  event.data.u64 = connection->id;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+  const auto id = connection->id;
+  connection->timer = _timers.add(_options.connect_timeout, [this, id] {
+    if (auto it = _connections.find(id); it != _connections.end()) {
+      it->second->timer = TimerWheel::INVALID_TIMER;
+      close(*it->second, Error::Connect, Error::Connect);
+    }
+  });
+
+  auto* raw = connection.get();
+  pool.connections.push_back(raw);
+  _connections.emplace(id, std::move(connection));
+  return raw;
+}
+
+auto HttpClient::assign(Connection& connection, Pending pending) -> void {
+  if (connection.connected && connection.in_flight.empty()) {
+    _timers.cancel(connection.timer);
+    connection.timer = TimerWheel::INVALID_TIMER;
+  }
+
+  armTimeout(connection, pending);
+  connection.output += pending.data;
+  pending.data = {};
+  auto body = pending.body;
+  const auto first = connection.in_flight.empty();
+  connection.in_flight.push_back(std::move(pending));
+  if (first) {
+    expectResponse(connection);
+  }
+
+  if (body) {
+    body->_connection = connection.id;
+    connection.upload = std::move(body);
+    drainBody(connection);
+    return;
+  }
+
+  if (connection.connected && flush(connection)) {
+    updateEvents(connection);
+  }
+}
+
+auto HttpClient::armTimeout(Connection& connection, Pending& pending)
+    -> void {
+  _timers.cancel(pending.timer);
+  const auto id = connection.id;
+  pending.timer = _timers.add(_options.request_timeout, [this, id] {
+    if (auto it = _connections.find(id); it != _connections.end()) {
+      close(*it->second, Error::Timeout, Error::Closed);
+    }
+  });
+}
+
+auto HttpClient::drainBody(Connection& connection) -> void {
+  auto& body = *connection.upload;
+  auto finished = false;
+  {
+    auto lock = std::lock_guard{body._mutex};
+    connection.output += body._queued;
+    connection.upload_bytes += body._queued.size();
+    body._queued.clear();
+    finished = body._finished;
+  }
+
+  if (finished) {
+    // Whoever wrote it doesn't wait for a drain anymore.
+    body._connection = 0;
+    connection.upload.reset();
+    connection.upload_bytes = 0;
+  }
+
+  if (connection.connected && !flush(connection)) {
+    return;
+  }
+  updateEvents(connection);
+  if (finished) {
+    dispatch(*connection.pool);
+  }
+}
+
+auto HttpClient::handleEvent(std::uint64_t id, std::uint32_t events) -> void {
+  auto it = _connections.find(id);
+  if (it == _connections.end()) {
+    return;
+  }
+
+  auto& connection = *it->second;
+  if (!connection.connected) {
+    if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0) {
+      onConnected(connection);
+    }
+    return;
+  }
+
+  if ((events & EPOLLOUT) != 0) {
+    if (!flush(connection)) {
+      return;
+    }
+    updateEvents(connection);
+  }
+
+  if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+    onReadable(connection);
+  }
+}
+
+auto HttpClient::onConnected(Connection& connection) -> void {
+  auto error = 0;
+  auto size = socklen_t{sizeof(error)};
+  if (::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &size) < 0 ||
+      error != 0) {
+    close(connection, Error::Connect, Error::Connect);
+    return;
+  }
+
+  connection.connected = true;
+  _timers.cancel(connection.timer);
+  connection.timer = TimerWheel::INVALID_TIMER;
+  if (connection.in_flight.empty()) {
+    setIdle(connection);
+  }
+  if (flush(connection)) {
+    updateEvents(connection);
+  }
+}
+
+auto HttpClient::onReadable(Connection& connection) -> void {
+  // One read per event, the loop comes back for the rest. A streamed body
+  // is then handed over in pieces of at most READ_SIZE.
+  auto data = std::array<char, READ_SIZE>{};
+  auto n = ::read(connection.fd, data.data(), data.size());
+  while (n < 0 && errno == EINTR) {
+    n = ::read(connection.fd, data.data(), data.size());
+  }
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+
+  const auto eof = n <= 0;
+  if (!eof) {
+    connection.input.append(data.data(), static_cast<std::size_t>(n));
+    if (!connection.in_flight.empty() && connection.in_flight.front().body) {
+      armTimeout(connection, connection.in_flight.front());
+    }
+  }
+
+  // complete() may close the connection, so keep track of it by id.
+  const auto id = connection.id;
+  auto alive = [this, id] { return _connections.contains(id); };
+  const auto on_headers = [&connection](HttpResponse& head) {
+    auto& pending = connection.in_flight.front();
+    if (pending.on_head) {
+      auto consumer = pending.on_head(head);
+      connection.parse.streamBody(
+          consumer ? std::move(consumer) : [](std::string_view) {});
+    }
+  };
+
+  while (alive() && !connection.in_flight.empty() &&
+         !connection.input.empty()) {
+    connection.parse.run(connection.input, on_headers);
+    const auto status = connection.parse.status();
+    if (status == HttpResponseParse::Status::INVALID) {
+      close(connection, Error::BadResponse, Error::Closed);
+      return;
+    }
+    if (status != HttpResponseParse::Status::OK) {
+      break;
+    }
+    complete(connection);
+  }
+
+  if (!alive()) {
+    return;
+  }
+
+  if (eof) {
+    if (!connection.in_flight.empty()) {
+      connection.parse.finish();
+      if (connection.parse.status() == HttpResponseParse::Status::OK) {
+        complete(connection);
+        if (!alive()) {
+          return;
+        }
+      }
+    }
+    close(connection, Error::Closed, Error::Closed);
+  } else if (connection.in_flight.empty() && !connection.input.empty()) {
+    // Bytes nobody asked for, the connection can't be trusted anymore.
+    close(connection, Error::Closed, Error::Closed);
+  }
+}
+
+auto HttpClient::flush(Connection& connection) -> bool {
+  while (connection.written < connection.output.size()) {
+    const auto n = ::send(connection.fd,
+                          connection.output.data() + connection.written,
+                          connection.output.size() - connection.written,
+                          MSG_NOSIGNAL);
+    if (n >= 0) {
+      connection.written += static_cast<std::size_t>(n);
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return true;
+    }
+    close(connection, Error::Closed, Error::Closed);
+    return false;
+  }
+
+  connection.output.clear();
+  connection.written = 0;
+  if (connection.upload && connection.upload_bytes != 0) {
+    auto& body = *connection.upload;
+    body._unsent -= connection.upload_bytes;
+    connection.upload_bytes = 0;
+    if (body._unsent < RequestBody::HIGH_WATER_MARK &&
+        body._blocked.exchange(false) && body._on_drain) {
+      body._on_drain();
+    }
+  }
+  return true;
+}
+
+auto HttpClient::updateEvents(Connection& connection) -> void {
+  // A connecting socket waits for EPOLLOUT anyway.
+  if (!connection.connected) {
+    return;
+  }
+
+  const auto want_write = !connection.output.empty();
+  if (want_write == connection.want_write) {
+    return;
+  }
+
+  connection.want_write = want_write;
+  auto event = epoll_event{};
+  event.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.u64 = connection.id;
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+auto HttpClient::expectResponse(Connection& connection) -> void {
+  connection.parse.reset();
+  if (connection.in_flight.front().head) {
+    connection.parse.expectNoBody();
+  }
+}
+
+auto HttpClient::complete(Connection& connection) -> void {
+  auto pending = std::move(connection.in_flight.front());
+  connection.in_flight.pop_front();
+  _timers.cancel(pending.timer);
+
+  auto response = std::move(connection.parse.response());
+  const auto keep_alive =
+      !response.closesConnection() &&
+      (response.version() == HttpResponse::HTTP_1_1 ||
+       equalsIgnoreCase(response.header("Connection"), "keep-alive"));
+  connection.closing = connection.closing || !keep_alive;
+
+  if (pending.body && connection.upload == pending.body) {
+    // Answered before its body was sent, the rest of the body is dropped
+    // and the connection can't carry another request.
+    {
+      auto lock = std::lock_guard{pending.body->_mutex};
+      pending.body->_finished = true;
+      pending.body->_queued.clear();
+    }
+    pending.body->_connection = 0;
+    connection.upload.reset();
+    connection.upload_bytes = 0;
+    connection.closing = true;
+  }
+
+  if (!connection.in_flight.empty()) {
+    expectResponse(connection);
+  }
+
+  // Callbacks can only queue requests, so the connection is still there
+  // afterwards.
+  pending.callback(Result{Error::None, std::move(response)});
+
+  if (connection.closing) {
+    close(connection, Error::Closed, Error::Closed);
+    return;
+  }
+
+  if (connection.in_flight.empty()) {
+    setIdle(connection);
+  }
+  dispatch(*connection.pool);
+}
+
+auto HttpClient::setIdle(Connection& connection) -> void {
+  const auto id = connection.id;
+  connection.timer = _timers.add(_options.idle_timeout, [this, id] {
+    if (auto it = _connections.find(id); it != _connections.end()) {
+      it->second->timer = TimerWheel::INVALID_TIMER;
+      close(*it->second, Error::Closed, Error::Closed);
+    }
+  });
+}
+
+auto HttpClient::close(Connection& connection, Error error, Error rest)
+    -> void {
+  ::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, connection.fd, nullptr);
+  ::close(connection.fd);
+  _timers.cancel(connection.timer);
+
+  auto in_flight = std::move(connection.in_flight);
+  auto* pool = connection.pool;
+  std::erase(pool->connections, &connection);
+  _connections.erase(connection.id);
+
+  auto first = true;
+  for (auto& pending : in_flight) {
+    _timers.cancel(pending.timer);
+    fail(pending, first ? error : rest);
+    first = false;
+  }
+
+  if (_running) {
+    dispatch(*pool);
+  }
+}
+
+auto HttpClient::fail(Pending& pending, Error error) -> void {
+  if (pending.body) {
+    // Nothing written to the body would be sent anymore.
+    auto lock = std::lock_guard{pending.body->_mutex};
+    pending.body->_finished = true;
+    pending.body->_queued.clear();
+  }
+  pending.callback(Result{error, {}});
+}
+
+auto HttpClient::failAll(Error error) -> void {
+  while (!_connections.empty()) {
+    close(*_connections.begin()->second, error, error);
+  }
+
+  for (auto& [key, pool] : _pools) {
+    for (auto& pending : pool->waiting) {
+      fail(pending, error);
+    }
+    pool->waiting.clear();
+  }
+
+  auto submissions = std::vector<Submission>{};
+  {
+    auto lock = std::lock_guard{_mutex};
+    submissions.swap(_submissions);
+  }
+  for (auto& submission : submissions) {
+    fail(submission.pending, error);
+  }
+}
+
+}  // namespace fz::http
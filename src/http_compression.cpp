@@ -0,0 +1,375 @@
+#include "http/http_compression.h"
+
+#include <array>
+#include <functional>
+#include <utility>
+
+#include "http/http_chunked_writer.h"
+
+#ifdef FZ_HTTP_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fz::http {
+
+namespace {
+
+/**
+ * @brief Parse a q-value ("1", "0.5", "0.125") into thousandths, -1 if it
+ * isn't one.
+ */
+auto parseQValue(std::string_view value) -> int {
+  if (value.empty() || (value[0] != '0' && value[0] != '1')) {
+    return -1;
+  }
+
+  auto q = (value[0] - '0') * 1000;
+  if (value.size() == 1) {
+    return q;
+  }
+
+  if (value[1] != '.' || 5 < value.size()) {
+    return -1;
+  }
+
+  auto scale = 100;
+  for (auto c : value.substr(2)) {
+    if (c < '0' || '9' < c) {
+      return -1;
+    }
+    q += (c - '0') * scale;
+    scale /= 10;
+  }
+  return q <= 1000 ? q : -1;
+}
+
+auto trim(std::string_view data) -> std::string_view {
+  while (!data.empty() && (data.front() == ' ' || data.front() == '\t')) {
+    data.remove_prefix(1);
+  }
+  while (!data.empty() && (data.back() == ' ' || data.back() == '\t')) {
+    data.remove_suffix(1);
+  }
+  return data;
+}
+
+#ifdef FZ_HTTP_HAS_ZLIB
+
+/**
+ * @brief A deflate stream producing the gzip or zlib format.
+ */
+class Deflater {
+ public:
+  Deflater(HttpCompression::Coding coding, int level) {
+    // 15 is the largest window, +16 asks for a gzip header and trailer.
+    const auto window_bits =
+        coding == HttpCompression::Coding::Gzip ? 15 + 16 : 15;
+    _ok = deflateInit2(&_stream, level, Z_DEFLATED, window_bits, 8,
+                       Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  Deflater(const Deflater&) = delete;
+
+  auto operator=(const Deflater&) -> Deflater& = delete;
+
+  ~Deflater() {
+    if (_ok) {
+      deflateEnd(&_stream);
+    }
+  }
+
+  auto ok() const { return _ok; }
+
+  auto bound(std::size_t size) -> std::size_t {
+    return deflateBound(&_stream, static_cast<uLong>(size));
+  }
+
+  /**
+   * @brief Feed data and append what comes out to out. flush is Z_NO_FLUSH,
+   * Z_SYNC_FLUSH or Z_FINISH.
+   */
+  auto write(std::string_view data, int flush, std::string& out) -> bool {
+    _stream.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    _stream.avail_in = static_cast<uInt>(data.size());
+
+    auto chunk = std::array<char, 16 * 1024>{};
+    do {
+      _stream.next_out = reinterpret_cast<Bytef*>(chunk.data());
+      _stream.avail_out = static_cast<uInt>(chunk.size());
+      const auto result = deflate(&_stream, flush);
+      if (result == Z_STREAM_ERROR) {
+        return false;
+      }
+      out.append(chunk.data(), chunk.size() - _stream.avail_out);
+    } while (_stream.avail_out == 0);
+    return true;
+  }
+
+ private:
+  z_stream _stream{};
+  bool _ok{false};
+};
+
+#endif
+
+}  // namespace
+
+HttpCompression::HttpCompression(Options options)
+    : _options{std::move(options)} {}
+
+HttpCompression::~HttpCompression() = default;
+
+auto HttpCompression::available() -> bool {
+#ifdef FZ_HTTP_HAS_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto HttpCompression::codingToString(Coding coding) -> std::string_view {
+  switch (coding) {
+    case Coding::Deflate:
+      return "deflate";
+    case Coding::Gzip:
+      return "gzip";
+    default:
+      return "identity";
+  }
+}
+
+auto HttpCompression::negotiate(std::string_view accept_encoding) -> Coding {
+  if (!available()) {
+    return Coding::Identity;
+  }
+
+  // Codings not listed take the q-value of "*", or are not acceptable.
+  auto gzip = -1;
+  auto deflate = -1;
+  auto any = -1;
+  while (!accept_encoding.empty()) {
+    const auto comma = accept_encoding.find(',');
+    auto item = accept_encoding.substr(0, comma);
+    accept_encoding = comma == std::string_view::npos
+                          ? std::string_view{}
+                          : accept_encoding.substr(comma + 1);
+
+    const auto semicolon = item.find(';');
+    const auto coding = trim(item.substr(0, semicolon));
+    auto q = 1000;
+    if (semicolon != std::string_view::npos) {
+      const auto param = trim(item.substr(semicolon + 1));
+      if (!param.starts_with("q=") && !param.starts_with("Q=")) {
+        continue;
+      }
+      q = parseQValue(param.substr(2));
+      if (q < 0) {
+        continue;
+      }
+    }
+
+    if (equalsIgnoreCase(coding, "gzip") ||
+        equalsIgnoreCase(coding, "x-gzip")) {
+      gzip = q;
+    } else if (equalsIgnoreCase(coding, "deflate")) {
+      deflate = q;
+    } else if (coding == "*") {
+      any = q;
+    }
+  }
+
+  gzip = gzip < 0 ? any : gzip;
+  deflate = deflate < 0 ? any : deflate;
+  if (0 < gzip && deflate <= gzip) {
+    return Coding::Gzip;
+  }
+  return 0 < deflate ? Coding::Deflate : Coding::Identity;
+}
+
+auto HttpCompression::compressible(std::string_view content_type) -> bool {
+  content_type = trim(content_type.substr(0, content_type.find(';')));
+  if (content_type.empty()) {
+    return true;
+  }
+
+  constexpr auto types = std::array<std::string_view, 6>{
+      "application/json",       "application/javascript",
+      "application/xml",        "application/wasm",
+      "application/x-ndjson",   "image/svg+xml"};
+  for (auto type : types) {
+    if (equalsIgnoreCase(content_type, type)) {
+      return true;
+    }
+  }
+
+  const auto lower = [](std::string_view value) {
+    auto result = std::string{value};
+    for (auto& c : result) {
+      c = toLower(c);
+    }
+    return result;
+  };
+  const auto type = lower(content_type);
+  return type.starts_with("text/") || type.ends_with("+json") ||
+         type.ends_with("+xml");
+}
+
+auto HttpCompression::compress(Coding coding, std::string_view data,
+                               int level) -> std::string {
+#ifdef FZ_HTTP_HAS_ZLIB
+  if (coding != Coding::Identity) {
+    auto deflater = Deflater{coding, level};
+    auto out = std::string{};
+    if (deflater.ok()) {
+      out.reserve(deflater.bound(data.size()));
+      if (deflater.write(data, Z_FINISH, out)) {
+        return out;
+      }
+    }
+  }
+#else
+  (void)coding;
+  (void)level;
+#endif
+  return std::string{data};
+}
+
+auto HttpCompression::apply(Coding coding, HttpResponse& response) -> void {
+  if (coding == Coding::Identity || !response.hasBody() ||
+      response.statusCode() == HttpResponse::PARTIAL_CONTENT ||
+      !response.header("Content-Encoding").empty() ||
+      !compressible(response.header("Content-Type"))) {
+    return;
+  }
+
+  const auto chunked = response.isChunked();
+  if (!chunked && response.body().size() < _options.min_size) {
+    return;
+  }
+
+  // A HEAD response or one with an overridden length has no body to work
+  // on, its Content-Length has to stay the uncompressed one.
+  if (!chunked && response.contentLength() != response.body().size()) {
+    return;
+  }
+
+  if (chunked) {
+#ifdef FZ_HTTP_HAS_ZLIB
+    struct Stream {
+      HttpResponse::BodyProducer producer;
+      Deflater deflater;
+      std::string input;
+      HttpChunkedWriter reader;
+      std::string output;
+
+      Stream(HttpResponse::BodyProducer producer, Coding coding, int level)
+          : producer{std::move(producer)},
+            deflater{coding, level},
+            reader{input, HttpChunkedWriter::Unframed{}} {}
+    };
+
+    auto stream = std::make_shared<Stream>(response.bodyProducer(), coding,
+                                           _options.level);
+    if (!stream->deflater.ok()) {
+      return;
+    }
+
+    response.setChunkedBody([stream](HttpChunkedWriter& writer) {
+      const auto more = stream->producer(stream->reader);
+      stream->deflater.write(stream->input, more ? Z_SYNC_FLUSH : Z_FINISH,
+                             stream->output);
+      stream->input.clear();
+      writer.write(stream->output);
+      stream->output.clear();
+      if (!more) {
+        for (const auto& [key, value] : stream->reader.trailers()) {
+          writer.addTrailer(key, value);
+        }
+      }
+      return more;
+    });
+#else
+    return;
+#endif
+  } else {
+    auto body = compressCached(coding, response.body());
+    if (!body) {
+      return;
+    }
+    response.setBody(*body, body);
+  }
+
+  response.addHeader("Content-Encoding", codingToString(coding));
+  applyHeaders(coding, response);
+}
+
+auto HttpCompression::applyHeaders(Coding coding, HttpResponse& response)
+    -> void {
+  if (coding == Coding::Identity) {
+    return;
+  }
+
+  const auto vary = response.header("Vary");
+  if (vary.empty()) {
+    response.addHeader("Vary", "Accept-Encoding");
+  } else if (vary.find("Accept-Encoding") == std::string_view::npos) {
+    response.addHeader("Vary", std::string{vary} + ", Accept-Encoding");
+  }
+
+  // The compressed body is a different representation, so a strong ETag
+  // can't stay. A weak one still validates it for If-None-Match.
+  const auto etag = response.header("ETag");
+  if (etag.starts_with('"')) {
+    response.addHeader("ETag", "W/" + std::string{etag});
+  }
+}
+
+auto HttpCompression::cachedBytes() const -> std::size_t {
+  auto lock = std::lock_guard{_mutex};
+  return _cached_bytes;
+}
+
+auto HttpCompression::compressCached(Coding coding, std::string_view data)
+    -> std::shared_ptr<const std::string> {
+  const auto key = Key{data, coding};
+  {
+    auto lock = std::lock_guard{_mutex};
+    if (auto it = _entries.find(key); it != _entries.end()) {
+      _lru.splice(_lru.begin(), _lru, it->second);
+      return it->second->body;
+    }
+  }
+
+  // Compress outside the lock, two threads racing on the same body both
+  // compress it once and the second insert is dropped.
+  auto body = std::make_shared<const std::string>(
+      compress(coding, data, _options.level));
+  if (data.size() <= body->size()) {
+    body = nullptr;  // incompressible, remembered so it isn't tried again
+  }
+
+  const auto size = sizeof(Entry) + data.size() + (body ? body->size() : 0);
+  if (_options.max_cached_bytes < size) {
+    return body;
+  }
+
+  auto lock = std::lock_guard{_mutex};
+  if (_entries.contains(key)) {
+    return body;
+  }
+
+  // The key views the entry's copy, which list nodes never move.
+  _lru.push_front(Entry{std::string{data}, coding, body, size});
+  _entries.emplace(Key{_lru.front().data, coding}, _lru.begin());
+  _cached_bytes += size;
+  while (_options.max_cached_bytes < _cached_bytes) {
+    const auto& last = _lru.back();
+    _cached_bytes -= last.size;
+    _entries.erase(Key{last.data, last.coding});
+    _lru.pop_back();
+  }
+  return body;
+}
+
+}  // namespace fz::http
@@ -0,0 +1,426 @@
+#include "http/http_metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace fz::http {
+
+namespace {
+
+/**
+ * @brief A counter written by a single thread and read by any. A relaxed
+ * load and store is enough for that and compiles to a plain add, unlike
+ * fetch_add.
+ */
+class Counter {
+ public:
+  auto add(std::uint64_t n) -> void {
+    _value.store(_value.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+
+  auto value() const { return _value.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<std::uint64_t> _value{0};
+};
+
+struct StringHash {
+  using is_transparent = void;
+
+  auto operator()(std::string_view value) const -> std::size_t {
+    return std::hash<std::string_view>{}(value);
+  }
+};
+
+// Instance ids are never reused, see HttpMetrics::local().
+std::atomic<std::uint64_t> next_id{1};
+
+constexpr auto parseErrorToString(std::size_t error) -> std::string_view {
+  switch (static_cast<HttpRequestParse::Error>(error)) {
+    case HttpRequestParse::Error::BadRequest:
+      return "bad_request";
+    case HttpRequestParse::Error::UriTooLong:
+      return "uri_too_long";
+    case HttpRequestParse::Error::HeadersTooLarge:
+      return "headers_too_large";
+    case HttpRequestParse::Error::BodyTooLarge:
+      return "body_too_large";
+    case HttpRequestParse::Error::NotImplemented:
+      return "not_implemented";
+    default:
+      return "none";
+  }
+}
+
+// The bounds of the exported histogram, Prometheus' defaults extended down
+// to 100 µs.
+struct LatencyBound {
+  std::string_view label;
+  std::chrono::nanoseconds value;
+};
+
+constexpr auto LATENCY_BOUNDS = std::array<LatencyBound, 16>{{
+    {"0.0001", std::chrono::microseconds{100}},
+    {"0.00025", std::chrono::microseconds{250}},
+    {"0.0005", std::chrono::microseconds{500}},
+    {"0.001", std::chrono::milliseconds{1}},
+    {"0.0025", std::chrono::microseconds{2500}},
+    {"0.005", std::chrono::milliseconds{5}},
+    {"0.01", std::chrono::milliseconds{10}},
+    {"0.025", std::chrono::milliseconds{25}},
+    {"0.05", std::chrono::milliseconds{50}},
+    {"0.1", std::chrono::milliseconds{100}},
+    {"0.25", std::chrono::milliseconds{250}},
+    {"0.5", std::chrono::milliseconds{500}},
+    {"1", std::chrono::seconds{1}},
+    {"2.5", std::chrono::milliseconds{2500}},
+    {"5", std::chrono::seconds{5}},
+    {"10", std::chrono::seconds{10}},
+}};
+
+auto appendNumber(std::string& out, std::uint64_t value) -> void {
+  auto buffer = std::array<char, 24>{};
+  const auto [end, _] =
+      std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+  out.append(buffer.data(), end);
+}
+
+auto appendSeconds(std::string& out, std::chrono::nanoseconds value) -> void {
+  auto buffer = std::array<char, 32>{};
+  const auto seconds = std::chrono::duration<double>(value).count();
+  const auto [end, _] =
+      std::to_chars(buffer.data(), buffer.data() + buffer.size(), seconds);
+  out.append(buffer.data(), end);
+}
+
+auto appendLabelValue(std::string& out, std::string_view value) -> void {
+  out.push_back('"');
+  for (auto c : value) {
+    if (c == '\\' || c == '"') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (c == '\n') {
+      out.append("\\n");
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+auto appendHeader(std::string& out, std::string_view name,
+                  std::string_view type, std::string_view help) -> void {
+  out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+}  // namespace
+
+struct HttpMetrics::RouteStats {
+  struct Status {
+    explicit Status(std::uint16_t code) : code{code} {}
+
+    std::uint16_t code;
+    Counter count;
+  };
+
+  // A deque, so adding a status doesn't move the counters of the others.
+  std::deque<Status> statuses;
+  std::array<Counter, LATENCY_BUCKETS> latency;
+  Counter latency_count;
+  Counter latency_sum;
+};
+
+struct HttpMetrics::Shard {
+  // Taken by the owning thread to add a route or status, and by readers.
+  // Counters are updated without it.
+  std::mutex mutex;
+  std::unordered_map<std::string, std::unique_ptr<RouteStats>, StringHash,
+                     std::equal_to<>>
+      routes;
+  Counter bytes_received;
+  Counter bytes_sent;
+  Counter writes;
+  Counter connections_opened;
+  Counter connections_closed;
+  std::array<Counter, PARSE_ERRORS> parse_errors;
+};
+
+auto HttpMetrics::latencyBucket(std::uint64_t value) -> std::size_t {
+  if (value < LATENCY_SUB_BUCKETS) {
+    return static_cast<std::size_t>(value);
+  }
+
+  // The LATENCY_SUB_BITS bits below the leading one pick the bucket within
+  // its power of two.
+  const auto shift = std::bit_width(value) - 1 - LATENCY_SUB_BITS;
+  const auto sub = (value >> shift) - LATENCY_SUB_BUCKETS;
+  const auto bucket = LATENCY_SUB_BUCKETS * (static_cast<std::size_t>(shift) +
+                                             1) +
+                      static_cast<std::size_t>(sub);
+  return std::min(bucket, LATENCY_BUCKETS - 1);
+}
+
+auto HttpMetrics::latencyUpperBound(std::size_t bucket) -> std::uint64_t {
+  if (bucket < LATENCY_SUB_BUCKETS) {
+    return bucket;
+  }
+
+  const auto shift = bucket / LATENCY_SUB_BUCKETS - 1;
+  const auto sub = bucket % LATENCY_SUB_BUCKETS;
+  return ((LATENCY_SUB_BUCKETS + sub) << shift) +
+         ((std::uint64_t{1} << shift) - 1);
+}
+
+auto HttpMetrics::Latency::quantile(double q) const
+    -> std::chrono::nanoseconds {
+  if (count == 0) {
+    return {};
+  }
+
+  const auto rank = static_cast<std::uint64_t>(
+      std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1));
+  auto seen = std::uint64_t{0};
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (rank < seen) {
+      return std::chrono::nanoseconds{
+          static_cast<std::int64_t>(latencyUpperBound(i))};
+    }
+  }
+  return std::chrono::nanoseconds{
+      static_cast<std::int64_t>(latencyUpperBound(buckets.size() - 1))};
+}
+
+auto HttpMetrics::Latency::countAtMost(std::chrono::nanoseconds limit) const
+    -> std::uint64_t {
+  auto total = std::uint64_t{0};
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    if (static_cast<std::int64_t>(latencyUpperBound(i)) > limit.count()) {
+      break;
+    }
+    total += buckets[i];
+  }
+  return total;
+}
+
+HttpMetrics::HttpMetrics() : _id{next_id.fetch_add(1)} {}
+
+HttpMetrics::~HttpMetrics() = default;
+
+auto HttpMetrics::connectionOpened() -> void {
+  local().connections_opened.add(1);
+}
+
+auto HttpMetrics::connectionClosed() -> void {
+  local().connections_closed.add(1);
+}
+
+auto HttpMetrics::bytesReceived(std::size_t bytes) -> void {
+  local().bytes_received.add(bytes);
+}
+
+auto HttpMetrics::bytesSent(std::size_t bytes) -> void {
+  auto& shard = local();
+  shard.bytes_sent.add(bytes);
+  shard.writes.add(1);
+}
+
+auto HttpMetrics::parseError(HttpRequestParse::Error error) -> void {
+  const auto index = static_cast<std::size_t>(error);
+  if (index < PARSE_ERRORS) {
+    local().parse_errors[index].add(1);
+  }
+}
+
+auto HttpMetrics::response(std::string_view route, std::uint16_t status)
+    -> void {
+  auto& shard = local();
+  count(shard, this->route(shard, route), status);
+}
+
+auto HttpMetrics::response(std::string_view route, std::uint16_t status,
+                           Clock::duration latency) -> void {
+  auto& shard = local();
+  auto& stats = this->route(shard, route);
+  count(shard, stats, status);
+
+  const auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(),
+      0));
+  stats.latency[latencyBucket(nanoseconds)].add(1);
+  stats.latency_count.add(1);
+  stats.latency_sum.add(nanoseconds);
+}
+
+auto HttpMetrics::snapshot() const -> Snapshot {
+  auto snapshot = Snapshot{};
+  auto lock = std::lock_guard{_mutex};
+  for (const auto& shard : _shards) {
+    auto shard_lock = std::lock_guard{shard->mutex};
+    snapshot.bytes_received += shard->bytes_received.value();
+    snapshot.bytes_sent += shard->bytes_sent.value();
+    snapshot.writes += shard->writes.value();
+    snapshot.connections_opened += shard->connections_opened.value();
+    snapshot.connections_closed += shard->connections_closed.value();
+    for (std::size_t i = 0; i < PARSE_ERRORS; ++i) {
+      snapshot.parse_errors[i] += shard->parse_errors[i].value();
+    }
+
+    for (const auto& [pattern, stats] : shard->routes) {
+      auto it = snapshot.routes.find(pattern);
+      if (it == snapshot.routes.end()) {
+        it = snapshot.routes.emplace(pattern, Snapshot::Route{}).first;
+      }
+
+      auto& route = it->second;
+      for (const auto& status : stats->statuses) {
+        route.statuses[status.code] += status.count.value();
+      }
+      for (std::size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        route.latency.buckets[i] += stats->latency[i].value();
+      }
+      route.latency.count += stats->latency_count.value();
+      route.latency.sum += std::chrono::nanoseconds{
+          static_cast<std::int64_t>(stats->latency_sum.value())};
+    }
+  }
+
+  // Connections can close on another thread than they opened, and the
+  // shards are read one after the other.
+  snapshot.connections_closed =
+      std::min(snapshot.connections_closed, snapshot.connections_opened);
+  return snapshot;
+}
+
+auto HttpMetrics::render() const -> std::string {
+  const auto snapshot = this->snapshot();
+  auto out = std::string{};
+
+  appendHeader(out, "fz_http_requests_total", "counter",
+               "Responses sent, by route pattern and status.");
+  for (const auto& [pattern, route] : snapshot.routes) {
+    for (const auto& [status, count] : route.statuses) {
+      out.append("fz_http_requests_total{route=");
+      appendLabelValue(out, pattern);
+      out.append(",status=\"");
+      appendNumber(out, status);
+      out.append("\"} ");
+      appendNumber(out, count);
+      out.push_back('\n');
+    }
+  }
+
+  appendHeader(out, "fz_http_request_duration_seconds", "histogram",
+               "Time from the end of the request headers until the response "
+               "was ready, by route pattern.");
+  for (const auto& [pattern, route] : snapshot.routes) {
+    if (route.latency.count == 0) {
+      continue;
+    }
+
+    const auto labels = [&out, &pattern](std::string_view name) {
+      out.append("fz_http_request_duration_seconds").append(name);
+      out.append("{route=");
+      appendLabelValue(out, pattern);
+    };
+    for (const auto& bound : LATENCY_BOUNDS) {
+      labels("_bucket");
+      out.append(",le=\"").append(bound.label).append("\"} ");
+      appendNumber(out, route.latency.countAtMost(bound.value));
+      out.push_back('\n');
+    }
+    labels("_bucket");
+    out.append(",le=\"+Inf\"} ");
+    appendNumber(out, route.latency.count);
+    out.push_back('\n');
+    labels("_sum");
+    out.append("} ");
+    appendSeconds(out, route.latency.sum);
+    out.push_back('\n');
+    labels("_count");
+    out.append("} ");
+    appendNumber(out, route.latency.count);
+    out.push_back('\n');
+  }
+
+  appendHeader(out, "fz_http_parse_errors_total", "counter",
+               "Requests rejected by the parser, by error.");
+  for (std::size_t i = 1; i < PARSE_ERRORS; ++i) {
+    out.append("fz_http_parse_errors_total{error=\"")
+        .append(parseErrorToString(i))
+        .append("\"} ");
+    appendNumber(out, snapshot.parse_errors[i]);
+    out.push_back('\n');
+  }
+
+  const auto single = [&out](std::string_view name, std::string_view type,
+                             std::string_view help, std::uint64_t value) {
+    appendHeader(out, name, type, help);
+    out.append(name).append(" ");
+    appendNumber(out, value);
+    out.push_back('\n');
+  };
+  single("fz_http_received_bytes_total", "counter",
+         "Bytes read from connections.", snapshot.bytes_received);
+  single("fz_http_sent_bytes_total", "counter",
+         "Bytes written to connections.", snapshot.bytes_sent);
+  single("fz_http_writes_total", "counter", "Sends to connections.",
+         snapshot.writes);
+  single("fz_http_connections_total", "counter",
+         "Connections that sent at least one byte.",
+         snapshot.connections_opened);
+  single("fz_http_connections_active", "gauge", "Connections open now.",
+         snapshot.connectionsActive());
+  return out;
+}
+
+auto HttpMetrics::local() -> Shard& {
+  // An entry left behind by a destroyed instance is never matched again,
+  // since ids aren't reused.
+  thread_local auto shards = std::vector<std::pair<std::uint64_t, Shard*>>{};
+  for (const auto& [id, shard] : shards) {
+    if (id == _id) {
+      return *shard;
+    }
+  }
+
+  auto lock = std::lock_guard{_mutex};
+  _shards.push_back(std::make_unique<Shard>());
+  shards.emplace_back(_id, _shards.back().get());
+  return *_shards.back();
+}
+
+auto HttpMetrics::route(Shard& shard, std::string_view pattern)
+    -> RouteStats& {
+  // Only this thread adds to its shard, so the lookup needs no lock.
+  if (auto it = shard.routes.find(pattern); it != shard.routes.end()) {
+    return *it->second;
+  }
+
+  auto lock = std::lock_guard{shard.mutex};
+  return *shard.routes
+              .emplace(std::string{pattern}, std::make_unique<RouteStats>())
+              .first->second;
+}
+
+auto HttpMetrics::count(Shard& shard, RouteStats& stats, std::uint16_t status)
+    -> void {
+  for (auto& entry : stats.statuses) {
+    if (entry.code == status) {
+      entry.count.add(1);
+      return;
+    }
+  }
+
+  auto lock = std::lock_guard{shard.mutex};
+  stats.statuses.emplace_back(status).count.add(1);
+}
+
+}  // namespace fz::http
@@ -0,0 +1,265 @@
+#include "http/http_proxy.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace fz::http {
+
+namespace {
+
+auto trim(std::string_view data) -> std::string_view {
+  const auto first = data.find_first_not_of(" \t");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return data.substr(first, data.find_last_not_of(" \t") - first + 1);
+}
+
+/**
+ * @brief Whether the comma separated list contains token.
+ */
+auto listed(std::string_view list, std::string_view token) -> bool {
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    if (equalsIgnoreCase(trim(list.substr(0, comma)), token)) {
+      return true;
+    }
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+  }
+  return false;
+}
+
+/**
+ * @brief Headers that only apply to one connection. connection is the
+ * value of the message's Connection header, which may name more.
+ */
+auto isHopByHop(std::string_view name, std::string_view connection) -> bool {
+  switch (headerFromString(name)) {
+    case HttpHeader::Connection:
+    case HttpHeader::KeepAlive:
+    case HttpHeader::Upgrade:
+      return true;
+    default:
+      break;
+  }
+
+  return equalsIgnoreCase(name, "TE") || equalsIgnoreCase(name, "Trailer") ||
+         (name.size() > 6 && equalsIgnoreCase(name.substr(0, 6), "Proxy-")) ||
+         listed(connection, name);
+}
+
+/**
+ * @brief The client of proxies that weren't given one. Created with the
+ * first of them and destroyed with the last, so no loop thread is left
+ * running at exit.
+ */
+auto sharedClient() -> std::shared_ptr<HttpClient> {
+  static auto mutex = std::mutex{};
+  static auto shared = std::weak_ptr<HttpClient>{};
+
+  auto lock = std::lock_guard{mutex};
+  auto client = shared.lock();
+  if (!client) {
+    client = std::make_shared<HttpClient>();
+    shared = client;
+  }
+  return client;
+}
+
+}  // namespace
+
+struct HttpProxy::Exchange {
+  Exchange(HttpResponder responder, std::size_t upstream, bool head_only)
+      : responder{std::move(responder)},
+        upstream{upstream},
+        head_only{head_only} {}
+
+  auto resumeBody() const -> void {
+    if (streaming) {
+      stream.resumeBody();
+    } else {
+      responder.resumeBody();
+    }
+  }
+
+  // Only touched by the client's loop once the request is submitted.
+  HttpResponder responder;
+  HttpResponseStream stream;
+  bool streaming{false};
+  std::size_t upstream;
+  bool head_only;
+};
+
+HttpProxy::HttpProxy(std::vector<Upstream> upstreams, const Options& options)
+    : _upstreams{std::move(upstreams)},
+      _options{options},
+      _active{new std::atomic<std::size_t>[_upstreams.size()]{}},
+      _client{options.client ? options.client : sharedClient()} {
+  if (_upstreams.empty()) {
+    throw std::invalid_argument{"HttpProxy: no upstream"};
+  }
+}
+
+auto HttpProxy::forward(const HttpRequest& request, HttpResponder responder)
+    -> HttpHandler::BodyConsumer {
+  const auto index = pick();
+  const auto& upstream = _upstreams[index];
+  _active[index].fetch_add(1, std::memory_order_relaxed);
+  const auto peer = responder.peerAddress();
+
+  auto exchange = std::make_shared<Exchange>(
+      std::move(responder), index, request.method() == HttpRequest::HEAD);
+
+  auto on_head = [exchange](const HttpResponse& head)
+      -> HttpResponseParse::BodyConsumer {
+    if (exchange->head_only) {
+      return {};  // answered from done, with nothing to stream
+    }
+
+    exchange->stream = exchange->responder.stream(downstreamResponse(head));
+    exchange->streaming = true;
+    return [exchange](std::string_view data) {
+      exchange->stream.write(data);
+    };
+  };
+
+  auto done = [active = _active, exchange](HttpClient::Result result) {
+    active[exchange->upstream].fetch_sub(1, std::memory_order_relaxed);
+    // The rest of the request body, if any, is no longer sent and mustn't
+    // stall the client connection.
+    exchange->resumeBody();
+
+    if (exchange->streaming) {
+      if (result.ok()) {
+        exchange->stream.finish();
+      } else {
+        exchange->stream.abort();
+      }
+      return;
+    }
+
+    if (!result.ok()) {
+      exchange->responder.send(result.error == HttpClient::Error::Timeout
+                                   ? HttpResponse::makeGatewayTimeout()
+                                   : HttpResponse::makeBadGateway());
+      return;
+    }
+    exchange->responder.send(downstreamResponse(result.response));
+  };
+
+  auto arena = Arena{};
+  auto upload = _client->stream(upstream.host, upstream.port,
+                               upstreamRequest(request, upstream, arena, peer),
+                               std::move(on_head), std::move(done));
+  upload->setDrainCallback([exchange]() { exchange->resumeBody(); });
+
+  return [upload](std::string_view data) {
+    if (data.empty()) {
+      upload->finish();
+      return true;
+    }
+    return upload->write(data);
+  };
+}
+
+auto HttpProxy::pick() -> std::size_t {
+  const auto size = _upstreams.size();
+  const auto next = _next.fetch_add(1, std::memory_order_relaxed) % size;
+  if (_options.balance == Balance::RoundRobin) {
+    return next;
+  }
+
+  // Start the scan at a rotating index so ties are spread evenly.
+  auto best = next;
+  auto best_active = active(next);
+  for (std::size_t i = 1; i < size && best_active != 0; ++i) {
+    const auto index = (next + i) % size;
+    if (const auto count = active(index); count < best_active) {
+      best = index;
+      best_active = count;
+    }
+  }
+  return best;
+}
+
+auto HttpProxy::upstreamRequest(const HttpRequest& request,
+                                const Upstream& upstream, Arena& arena,
+                                std::string_view peer) const -> HttpRequest {
+  auto result = HttpRequest{};
+  result.setMethod(request.method());
+  // The target goes on byte for byte: querys() skips parameters without '='.
+  result.setPath(request.path());
+  result.setTarget(request.target());
+  result.setVersion(HttpRequest::HTTP_1_1);
+
+  const auto host = request.header(HttpHeader::Host);
+  if (_options.preserve_host && !host.empty()) {
+    result.addHeader("Host", host);
+  } else {
+    auto upstream_host = upstream.host;
+    if (upstream.port != 80) {
+      upstream_host += ':';
+      upstream_host += std::to_string(upstream.port);
+    }
+    result.addHeader("Host", arena.store(upstream_host));
+  }
+
+  const auto connection = request.header(HttpHeader::Connection);
+  auto forwarded_for = std::string{};
+  for (const auto& [key, value] : request.headers()) {
+    const auto id = headerFromString(key);
+    if (equalsIgnoreCase(key, "X-Forwarded-For")) {
+      if (!forwarded_for.empty()) {
+        forwarded_for += ", ";
+      }
+      forwarded_for += value;
+      continue;
+    }
+    // Expect is between the client and this server, the body goes
+    // upstream as it comes in either way.
+    if (id == HttpHeader::Host || id == HttpHeader::Expect ||
+        isHopByHop(key, connection)) {
+      continue;
+    }
+    result.addHeader(key, value);
+  }
+
+  if (!peer.empty()) {
+    if (!forwarded_for.empty()) {
+      forwarded_for += ", ";
+    }
+    forwarded_for += peer;
+    result.addHeader("X-Forwarded-For", arena.store(forwarded_for));
+  }
+
+  if (!host.empty() && request.header("X-Forwarded-Host").empty()) {
+    result.addHeader("X-Forwarded-Host", host);
+  }
+  if (request.header("X-Forwarded-Proto").empty()) {
+    result.addHeader("X-Forwarded-Proto", "http");
+  }
+  return result;
+}
+
+auto HttpProxy::downstreamResponse(const HttpResponse& head) -> HttpResponse {
+  auto response = HttpResponse{};
+  response.setVersion(HttpResponse::HTTP_1_1);
+  response.setStatusCode(head.statusCode());
+  response.setReason(head.reason());
+
+  const auto connection = head.header("Connection");
+  for (const auto& [key, value] : head.headers()) {
+    if (!isHopByHop(key, connection)) {
+      response.appendHeader(key, value);
+    }
+  }
+
+  if (head.hasContentLength()) {
+    response.setContentLength(head.contentLength());
+  }
+  return response;
+}
+
+}  // namespace fz::http
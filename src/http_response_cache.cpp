@@ -0,0 +1,152 @@
+#include "http/http_response_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "http/http_header.h"
+
+namespace fz::http {
+
+struct HttpResponseCache::Shard {
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const std::string> bytes;
+    Clock::time_point expires;
+  };
+
+  auto charge(const Entry& entry) const -> std::size_t {
+    return entry.key.size() + entry.bytes->size() + sizeof(Entry);
+  }
+
+  auto erase(std::list<Entry>::iterator it) -> void {
+    used -= charge(*it);
+    entries.erase(it->key);
+    lru.erase(it);
+  }
+
+  mutable std::mutex mutex;
+  std::list<Entry> lru;  // most recently used first
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> entries;
+  std::size_t used{0};
+  std::size_t capacity{0};
+};
+
+HttpResponseCache::HttpResponseCache(Options options)
+    : _options{std::move(options)},
+      _thread_index{[next = std::size_t{0}]() mutable { return next++; }} {
+  const auto shards = std::max<std::size_t>(_options.shards, 1);
+  _shards.reserve(shards);
+  for (std::size_t i = 0; i < shards; ++i) {
+    _shards.push_back(std::make_unique<Shard>());
+    _shards.back()->capacity = _options.max_bytes / shards;
+  }
+}
+
+HttpResponseCache::~HttpResponseCache() = default;
+
+auto HttpResponseCache::makeKey(const HttpRequest& request,
+                                const Policy& policy, std::string_view extra)
+    -> std::string {
+  // Fields are separated by NUL, which can't appear in any of them.
+  auto key = std::string{HttpRequest::methodToString(request.method())};
+  key.push_back('\0');
+  key += request.path();
+  for (const auto& name : policy.query) {
+    key.push_back('\0');
+    if (auto it = request.querys().find(name); it != request.querys().end()) {
+      key.push_back('=');
+      key += it->second;
+    }
+  }
+  for (const auto& name : policy.headers) {
+    key.push_back('\0');
+    key += request.header(name);
+  }
+  key.push_back('\0');
+  key += extra;
+  return key;
+}
+
+auto HttpResponseCache::cacheable(const HttpResponse& response) -> bool {
+  if (response.statusCode() != HttpResponse::OK || response.isChunked() ||
+      response.closesConnection() ||
+      !response.header("Set-Cookie").empty()) {
+    return false;
+  }
+
+  const auto cache_control = response.header("Cache-Control");
+  return cache_control.find("no-store") == std::string_view::npos &&
+         cache_control.find("private") == std::string_view::npos;
+}
+
+auto HttpResponseCache::find(std::string_view key)
+    -> std::shared_ptr<const std::string> {
+  auto& shard = *_shards[shardOf(key)];
+  const auto now = Clock::now();
+
+  auto lock = std::lock_guard{shard.mutex};
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    return nullptr;
+  }
+
+  if (it->second->expires <= now) {
+    shard.erase(it->second);
+    return nullptr;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->bytes;
+}
+
+auto HttpResponseCache::insert(std::size_t shard_index, std::string key,
+                               std::shared_ptr<const std::string> bytes,
+                               Clock::duration ttl) -> void {
+  auto& shard = *_shards[shard_index % _shards.size()];
+  auto entry = Shard::Entry{std::move(key), std::move(bytes),
+                            Clock::now() + ttl};
+  const auto charge = shard.charge(entry);
+  if (shard.capacity < charge) {
+    return;
+  }
+
+  auto lock = std::lock_guard{shard.mutex};
+  if (auto it = shard.entries.find(entry.key); it != shard.entries.end()) {
+    shard.erase(it->second);
+  }
+
+  shard.lru.push_front(std::move(entry));
+  shard.entries.emplace(shard.lru.front().key, shard.lru.begin());
+  shard.used += charge;
+  while (shard.capacity < shard.used) {
+    shard.erase(std::prev(shard.lru.end()));
+  }
+}
+
+auto HttpResponseCache::size() const -> std::size_t {
+  auto size = std::size_t{0};
+  for (const auto& shard : _shards) {
+    auto lock = std::lock_guard{shard->mutex};
+    size += shard->lru.size();
+  }
+  return size;
+}
+
+auto HttpResponseCache::bytes() const -> std::size_t {
+  auto bytes = std::size_t{0};
+  for (const auto& shard : _shards) {
+    auto lock = std::lock_guard{shard->mutex};
+    bytes += shard->used;
+  }
+  return bytes;
+}
+
+auto HttpResponseCache::shardOf(std::string_view key) const -> std::size_t {
+  if (_options.per_thread) {
+    return _thread_index.local() % _shards.size();
+  }
+  return std::hash<std::string_view>{}(key) % _shards.size();
+}
+
+}  // namespace fz::http
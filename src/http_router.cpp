@@ -0,0 +1,216 @@
+#include "http/http_router.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace fz::http {
+
+namespace {
+
+constexpr auto METHODS =
+    std::array{HttpRequest::GET, HttpRequest::POST, HttpRequest::PUT,
+               HttpRequest::DELETE, HttpRequest::HEAD};
+
+constexpr auto methodBit(HttpRequest::Method method) -> std::uint32_t {
+  return std::uint32_t{1} << method;
+}
+
+auto commonPrefix(std::string_view lhs, std::string_view rhs) -> std::size_t {
+  const auto size = std::min(lhs.size(), rhs.size());
+  std::size_t i = 0;
+  while (i < size && lhs[i] == rhs[i]) {
+    ++i;
+  }
+  return i;
+}
+
+}  // namespace
+
+struct HttpRouter::Node {
+  std::string prefix;
+  // First character of every static child, in the same order as children.
+  std::string indices;
+  std::vector<std::unique_ptr<Node>> children;
+  std::unique_ptr<Node> param;
+  std::string param_name;
+  std::unique_ptr<Node> wildcard;
+  std::string wildcard_name;
+  std::array<Handler, HttpRequest::HEAD + 1> handlers;
+  std::uint32_t allowed{0};
+  // The pattern the handlers were registered with, for metrics.
+  std::string pattern;
+
+  auto hasHandler() const { return allowed != 0; }
+
+  auto insertStatic(std::string_view path) -> Node* {
+    auto* node = this;
+    while (!path.empty()) {
+      const auto index = node->indices.find(path.front());
+      if (index == std::string::npos) {
+        auto child = std::make_unique<Node>();
+        child->prefix = path;
+        node->indices.push_back(path.front());
+        node->children.push_back(std::move(child));
+        return node->children.back().get();
+      }
+
+      auto& child = node->children[index];
+      const auto common = commonPrefix(child->prefix, path);
+      if (common < child->prefix.size()) {
+        // Split the child so the shared part becomes its own node.
+        auto split = std::make_unique<Node>();
+        split->prefix = child->prefix.substr(0, common);
+        child->prefix.erase(0, common);
+        split->indices.push_back(child->prefix.front());
+        split->children.push_back(std::move(child));
+        child = std::move(split);
+      }
+
+      node = child.get();
+      path.remove_prefix(common);
+    }
+    return node;
+  }
+
+  auto find(std::string_view path, HttpFields& params) const -> const Node* {
+    if (path.empty()) {
+      if (hasHandler()) {
+        return this;
+      }
+    } else {
+      const auto index = indices.find(path.front());
+      if (index != std::string::npos) {
+        const auto& child = children[index];
+        if (path.starts_with(child->prefix)) {
+          if (const auto* found =
+                  child->find(path.substr(child->prefix.size()), params)) {
+            return found;
+          }
+        }
+      }
+
+      if (param) {
+        const auto segment = path.substr(0, path.find('/'));
+        if (!segment.empty()) {
+          const auto size = params.size();
+          params.add(param_name, segment);
+          if (const auto* found =
+                  param->find(path.substr(segment.size()), params)) {
+            return found;
+          }
+          params.truncate(size);
+        }
+      }
+    }
+
+    if (wildcard && wildcard->hasHandler()) {
+      params.add(wildcard_name, path);
+      return wildcard.get();
+    }
+
+    return nullptr;
+  }
+};
+
+HttpRouter::HttpRouter() : _root{std::make_unique<Node>()} {}
+
+HttpRouter::HttpRouter(HttpRouter&&) noexcept = default;
+
+auto HttpRouter::operator=(HttpRouter&&) noexcept -> HttpRouter& = default;
+
+HttpRouter::~HttpRouter() = default;
+
+auto HttpRouter::add(HttpRequest::Method method, std::string_view pattern,
+                     Handler handler) -> void {
+  if (pattern.empty() || pattern.front() != '/') {
+    throw std::invalid_argument("route pattern must start with '/'");
+  }
+
+  const auto full_pattern = pattern;
+  auto* node = _root.get();
+  while (true) {
+    const auto special = pattern.find_first_of(":*");
+    node = node->insertStatic(pattern.substr(0, special));
+    if (special == std::string_view::npos) {
+      break;
+    }
+
+    if (pattern[special - 1] != '/') {
+      throw std::invalid_argument("route parameter must start a segment");
+    }
+
+    pattern.remove_prefix(special);
+    const auto name_end = pattern.find('/');
+    const auto name = pattern.substr(1, name_end - 1);
+    if (name.empty()) {
+      throw std::invalid_argument("route parameter must have a name");
+    }
+
+    auto& child = pattern.front() == ':' ? node->param : node->wildcard;
+    auto& child_name =
+        pattern.front() == ':' ? node->param_name : node->wildcard_name;
+    if (pattern.front() == '*' && name_end != std::string_view::npos) {
+      throw std::invalid_argument("route wildcard must be the last segment");
+    }
+    if (!child) {
+      child = std::make_unique<Node>();
+      child_name = name;
+    } else if (child_name != name) {
+      throw std::invalid_argument("conflicting route parameter names");
+    }
+
+    node = child.get();
+    if (name_end == std::string_view::npos) {
+      break;
+    }
+    pattern.remove_prefix(name_end);
+  }
+
+  node->handlers[method] = std::move(handler);
+  node->allowed |= methodBit(method);
+  if (method == HttpRequest::GET) {
+    node->allowed |= methodBit(HttpRequest::HEAD);
+  }
+  if (node->pattern.empty()) {
+    node->pattern = full_pattern;
+  }
+}
+
+auto HttpRouter::match(HttpRequest::Method method, std::string_view path,
+                       HttpFields& params) const -> Match {
+  const auto* node = _root->find(path, params);
+  if (node == nullptr) {
+    return {};
+  }
+
+  if (method != HttpRequest::INVALID && node->handlers[method]) {
+    return {&node->handlers[method], node->allowed, node->pattern};
+  }
+
+  if (method == HttpRequest::HEAD && node->handlers[HttpRequest::GET]) {
+    return {&node->handlers[HttpRequest::GET], node->allowed, node->pattern};
+  }
+
+  if (node->handlers[HttpRequest::INVALID]) {
+    return {&node->handlers[HttpRequest::INVALID], node->allowed,
+            node->pattern};
+  }
+
+  return {nullptr, node->allowed, node->pattern};
+}
+
+auto HttpRouter::allowToString(std::uint32_t allowed) -> std::string {
+  auto allow = std::string{};
+  for (auto method : METHODS) {
+    if ((allowed & methodBit(method)) != 0) {
+      if (!allow.empty()) {
+        allow += ", ";
+      }
+      allow += HttpRequest::methodToString(method);
+    }
+  }
+  return allow;
+}
+
+}  // namespace fz::http
@@ -0,0 +1,189 @@
+#include "http/http_scan.h"
+
+#include <bit>
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FZ_HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace fz::http {
+
+namespace {
+
+enum CharClass : std::uint8_t { NORMAL, STRUCTURAL, CONTROL };
+
+constexpr auto CHAR_CLASSES = [] {
+  auto table = std::array<CharClass, 256>{};
+  for (std::size_t c = 0; c < 0x20; ++c) {
+    table[c] = CONTROL;
+  }
+  table[0x7f] = CONTROL;
+  table['\t'] = NORMAL;
+  for (auto c : std::string_view{"\r\n :?=&"}) {
+    table[static_cast<unsigned char>(c)] = STRUCTURAL;
+  }
+  return table;
+}();
+
+auto scanScalar(const char* data, std::size_t offset, std::size_t size,
+                HttpScanner::Positions& positions) -> bool {
+  auto valid = true;
+  for (auto i = offset; i < size; ++i) {
+    const auto c = CHAR_CLASSES[static_cast<unsigned char>(data[i])];
+    if (c == STRUCTURAL) {
+      positions.push_back(static_cast<std::uint32_t>(i));
+    } else if (c == CONTROL) {
+      valid = false;
+    }
+  }
+  return valid;
+}
+
+auto appendMask(std::uint32_t mask, std::size_t base,
+                HttpScanner::Positions& positions) -> void {
+  while (mask != 0) {
+    positions.push_back(
+        static_cast<std::uint32_t>(base + std::countr_zero(mask)));
+    mask &= mask - 1;
+  }
+}
+
+#ifdef FZ_HTTP_SCAN_X86
+
+__attribute__((target("sse4.2"))) auto scanSse42(
+    std::string_view data, HttpScanner::Positions& positions) -> bool {
+  constexpr auto MODE = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+  // PCMPESTRM with "equal any" matches a chunk against the whole set at once.
+  const auto set = _mm_setr_epi8('\r', '\n', ' ', ':', '?', '=', '&', 0, 0, 0,
+                                 0, 0, 0, 0, 0, 0);
+  const auto max_control = _mm_set1_epi8(0x1f);
+  const auto tab = _mm_set1_epi8('\t');
+  const auto cr = _mm_set1_epi8('\r');
+  const auto lf = _mm_set1_epi8('\n');
+  const auto del = _mm_set1_epi8(0x7f);
+
+  auto invalid = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 16 <= data.size(); i += 16) {
+    const auto chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.data() + i));
+    const auto structural = _mm_cmpestrm(set, 7, chunk, 16, MODE);
+    appendMask(static_cast<std::uint32_t>(_mm_cvtsi128_si32(structural)), i,
+               positions);
+
+    // c <= 0x1f, except HTAB, CR and LF, or c == DEL
+    auto control =
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_control), chunk);
+    control = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, tab), control);
+    control = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, cr), control);
+    control = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, lf), control);
+    control = _mm_or_si128(control, _mm_cmpeq_epi8(chunk, del));
+    invalid = _mm_or_si128(invalid, control);
+  }
+
+  const auto valid = _mm_movemask_epi8(invalid) == 0;
+  return scanScalar(data.data(), i, data.size(), positions) && valid;
+}
+
+__attribute__((target("avx2"))) auto scanAvx2(
+    std::string_view data, HttpScanner::Positions& positions) -> bool {
+  const auto cr = _mm256_set1_epi8('\r');
+  const auto lf = _mm256_set1_epi8('\n');
+  const auto space = _mm256_set1_epi8(' ');
+  const auto colon = _mm256_set1_epi8(':');
+  const auto question = _mm256_set1_epi8('?');
+  const auto equal = _mm256_set1_epi8('=');
+  const auto ampersand = _mm256_set1_epi8('&');
+  const auto max_control = _mm256_set1_epi8(0x1f);
+  const auto tab = _mm256_set1_epi8('\t');
+  const auto del = _mm256_set1_epi8(0x7f);
+
+  auto invalid = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 32 <= data.size(); i += 32) {
+    const auto chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.data() + i));
+    const auto is_cr = _mm256_cmpeq_epi8(chunk, cr);
+    const auto is_lf = _mm256_cmpeq_epi8(chunk, lf);
+
+    auto structural = _mm256_or_si256(is_cr, is_lf);
+    structural =
+        _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, space));
+    structural =
+        _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, colon));
+    structural =
+        _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, question));
+    structural =
+        _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, equal));
+    structural =
+        _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, ampersand));
+    appendMask(static_cast<std::uint32_t>(_mm256_movemask_epi8(structural)),
+               i, positions);
+
+    auto control =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, max_control), chunk);
+    control = _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, tab), control);
+    control = _mm256_andnot_si256(_mm256_or_si256(is_cr, is_lf), control);
+    control = _mm256_or_si256(control, _mm256_cmpeq_epi8(chunk, del));
+    invalid = _mm256_or_si256(invalid, control);
+  }
+
+  const auto valid = _mm256_movemask_epi8(invalid) == 0;
+  return scanScalar(data.data(), i, data.size(), positions) && valid;
+}
+
+#endif  // FZ_HTTP_SCAN_X86
+
+auto detectKernel() -> HttpScanner::Kernel {
+  if (HttpScanner::supported(HttpScanner::Kernel::AVX2)) {
+    return HttpScanner::Kernel::AVX2;
+  }
+  if (HttpScanner::supported(HttpScanner::Kernel::SSE42)) {
+    return HttpScanner::Kernel::SSE42;
+  }
+  return HttpScanner::Kernel::Scalar;
+}
+
+}  // namespace
+
+auto HttpScanner::supported(Kernel kernel) -> bool {
+  switch (kernel) {
+#ifdef FZ_HTTP_SCAN_X86
+    case Kernel::SSE42:
+      return __builtin_cpu_supports("sse4.2");
+    case Kernel::AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    case Kernel::Scalar:
+      return true;
+    default:
+      return false;
+  }
+}
+
+auto HttpScanner::kernel() -> Kernel {
+  static const auto kernel = detectKernel();
+  return kernel;
+}
+
+auto HttpScanner::scan(std::string_view data, Positions& positions) -> bool {
+  return scan(kernel(), data, positions);
+}
+
+auto HttpScanner::scan(Kernel kernel, std::string_view data,
+                       Positions& positions) -> bool {
+  switch (kernel) {
+#ifdef FZ_HTTP_SCAN_X86
+    case Kernel::SSE42:
+      return scanSse42(data, positions);
+    case Kernel::AVX2:
+      return scanAvx2(data, positions);
+#endif
+    default:
+      return scanScalar(data.data(), 0, data.size(), positions);
+  }
+}
+
+}  // namespace fz::http
@@ -1,20 +1,197 @@
 #include "http/http_server.h"
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+
 #include "net/common/log.h"
 
 namespace fz::http {
 
-auto HttpServer::registerHandler(
-    std::string_view path,
-    std::function<HttpResponse(const HttpRequest& request)> handler) -> void {
-  _handlers.emplace(path, handler);
+namespace {
+
+auto errorResponse(HttpRequestParse::Error error) -> HttpResponse {
+  switch (error) {
+    case HttpRequestParse::Error::UriTooLong:
+      return HttpResponse::makeUriTooLong();
+    case HttpRequestParse::Error::HeadersTooLarge:
+      return HttpResponse::makeRequestHeaderFieldsTooLarge();
+    case HttpRequestParse::Error::BodyTooLarge:
+      return HttpResponse::makePayloadTooLarge();
+    case HttpRequestParse::Error::NotImplemented:
+      return HttpResponse::makeNotImplemented();
+    default:
+      return HttpResponse::makeBadRequest();
+  }
+}
+
+/**
+ * @brief The CPUs the process may run on, which respects taskset and
+ * cgroup limits unlike the CPU count.
+ */
+auto allowedCpus() -> std::vector<int> {
+  auto cpus = std::vector<int>{};
+#ifdef __linux__
+  auto set = cpu_set_t{};
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+auto pinCurrentThread([[maybe_unused]] int cpu) -> void {
+#ifdef __linux__
+  auto set = cpu_set_t{};
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    LOG_ERROR("pthread_setaffinity_np failed", "");
+  }
+#endif
+}
+
+}  // namespace
+
+auto HttpServer::start() -> void {
+  // A listener per loop, each with a single loop of its own, or one
+  // listener for all of them.
+  const auto reuse_port = _accept_mode == AcceptMode::ReusePort;
+  const auto listeners = reuse_port ? std::max<std::size_t>(_thread_num, 1)
+                                    : std::size_t{1};
+  _acceptors.clear();
+  for (std::size_t i = 0; i < listeners; ++i) {
+    auto acceptor = std::make_unique<net::TcpServer>(
+        reuse_port ? std::size_t{1} : _thread_num, _ip, _port);
+    acceptor->setReadCallback([this, i](const auto& session, auto& buffer) {
+      pinLoop(i);
+      this->readCallback(session, buffer);
+    });
+    acceptor->setNewSessionCallback<HttpSession>();
+    acceptor->start();
+    _acceptors.push_back(std::move(acceptor));
+  }
+}
+
+auto HttpServer::stop() -> void {
+  for (auto& acceptor : _acceptors) {
+    acceptor->stop();
+  }
+}
+
+auto HttpServer::pinThreads(std::vector<int> cpus) -> void {
+  _cpus = cpus.empty() ? allowedCpus() : std::move(cpus);
+}
+
+auto HttpServer::pinLoop(std::size_t index) -> void {
+  // A loop thread serves one server, so a flag per thread is enough.
+  thread_local auto pinned = false;
+  if (_cpus.empty() || pinned) {
+    return;
+  }
+
+  pinned = true;
+  if (_accept_mode == AcceptMode::Shared) {
+    index = _next_cpu.fetch_add(1, std::memory_order_relaxed);
+  }
+  pinCurrentThread(_cpus[index % _cpus.size()]);
+}
+
+auto HttpServer::registerHandler(std::string_view path, HttpHandler handler)
+    -> void {
+  registerHandler(HttpRequest::INVALID, path, std::move(handler));
+}
+
+auto HttpServer::registerHandler(HttpRequest::Method method,
+                                 std::string_view path, HttpHandler handler)
+    -> void {
+  if (handler.cachePolicy() != nullptr && !_response_cache) {
+    _response_cache = std::make_unique<HttpResponseCache>();
+  }
+  _router.add(method, path, std::move(handler));
+}
+
+auto HttpServer::enableMetrics(std::string_view path) -> void {
+  _metrics = std::make_shared<HttpMetrics>();
+  if (path.empty()) {
+    return;
+  }
+
+  registerHandler(HttpRequest::GET, path,
+                  [metrics = _metrics.get()](const HttpRequest&) {
+                    auto response = HttpResponse::makeOk();
+                    response.addHeader("Content-Type",
+                                       "text/plain; version=0.0.4");
+                    response.addHeader("Cache-Control", "no-store");
+                    response.setBody(metrics->render());
+                    return response;
+                  });
+}
+
+auto HttpServer::serveStatic(std::string_view prefix,
+                             std::filesystem::path root,
+                             HttpStaticFiles::Options options) -> void {
+  auto files =
+      std::make_shared<HttpStaticFiles>(std::move(root), std::move(options));
+  auto pattern = std::string{prefix};
+  if (pattern.empty() || pattern.back() != '/') {
+    pattern.push_back('/');
+  }
+
+  // The server strips a trailing slash, so the bare prefix serves the index.
+  if (pattern.size() != 1) {
+    registerHandler(HttpRequest::GET, std::string_view{pattern}.substr(
+                                          0, pattern.size() - 1),
+                    [files](const HttpRequest& request) {
+                      return files->serve(request, "");
+                    });
+  }
+
+  pattern.append("*file");
+  registerHandler(HttpRequest::GET, pattern,
+                  [files](const HttpRequest& request) {
+                    return files->serve(request, request.param("file"));
+                  });
+}
+
+auto HttpServer::proxy(std::string_view prefix,
+                       std::vector<HttpProxy::Upstream> upstreams,
+                       const HttpProxy::Options& options) -> void {
+  auto proxy = std::make_shared<HttpProxy>(std::move(upstreams), options);
+  auto handler = HttpHandler::stream(
+      [proxy](const HttpRequest& request, HttpResponder responder) {
+        return proxy->forward(request, std::move(responder));
+      });
+
+  auto pattern = std::string{prefix};
+  if (pattern.empty() || pattern.back() != '/') {
+    pattern.push_back('/');
+  }
+  if (pattern.size() != 1) {
+    registerHandler(std::string_view{pattern}.substr(0, pattern.size() - 1),
+                    handler);
+  }
+  pattern.append("*path");
+  registerHandler(pattern, std::move(handler));
+}
+
+auto HttpServer::webSocket(std::string_view path, WebSocketHandler handler)
+    -> void {
+  registerHandler(HttpRequest::GET, path,
+                  HttpHandler::webSocket(std::move(handler)));
 }
 
 auto HttpServer::response(const std::shared_ptr<HttpSession>& http_session,
                           const HttpResponse& response) -> void {
-  auto buffer = net::Buffer();
-  buffer.append(response.toString());
-  http_session->send(buffer);
+  http_session->queueResponse(response, _server_name);
+  http_session->flushResponses();
 }
 
 auto HttpServer::readCallback(const std::shared_ptr<net::Session>& session,
@@ -22,43 +199,399 @@ auto HttpServer::readCallback(const std::shared_ptr<net::Session>& session,
   auto http_session = std::dynamic_pointer_cast<HttpSession>(session);
   if (!http_session) {
     LOG_ERROR("dynamic_pointer_cast failed", "");
+    return;
   }
 
-  http_session->parseRequest(buffer);
-  if (http_session->httpRequestParse().status() !=
-      HttpRequestParse::Status::OK) {
+  http_session->setMetrics(_metrics);
+  http_session->countReceived(buffer);
+
+  if (http_session->upgraded()) {
+    processWebSocket(http_session, buffer);
+    http_session->setUnparsed(buffer);
     return;
   }
 
-  if (http_session->httpRequestParse().status() ==
-      HttpRequestParse::Status::INVALID) {
-    this->response(http_session, HttpResponse::makeBadRequest());
-    http_session->httpRequestParse().reset();
+  // Bytes held back while reading was paused come first.
+  auto& backlog = http_session->backlog();
+  if (!backlog.empty()) {
+    backlog.append(buffer.peek(), buffer.readableBytes());
+    buffer.retrieve(buffer.readableBytes());
+    processInput(http_session, backlog);
+  } else {
+    processInput(http_session, buffer);
+  }
+  http_session->setUnparsed(buffer);
+}
+
+auto HttpServer::processInput(const std::shared_ptr<HttpSession>& http_session,
+                              net::Buffer& buffer) -> void {
+  // Sessions are created by TcpServer, so the settings are handed over here.
+  auto& parse = http_session->httpRequestParse();
+  parse.setLimits(_limits);
+  http_session->setTimeouts(_timeouts);
+
+  // Nothing after a request that closes the connection is read.
+  if (http_session->closing()) {
+    buffer.retrieve(buffer.readableBytes());
     return;
   }
 
-  auto& request = http_session->httpRequestParse().request();
+  const auto on_headers = [this, &http_session](HttpRequest& request) {
+    routeRequest(http_session, request);
+  };
+
+  // Pipelined requests may arrive in the same segment, so keep parsing until
+  // the buffer holds no more complete requests. Whatever is left stays in the
+  // buffer for the next read.
+  while (true) {
+    parse.run(buffer, on_headers);
+
+    if (parse.status() == HttpRequestParse::Status::INVALID) {
+      // The rest of the stream can't be framed any more, so answer and close
+      // once the answer is out, behind those of the requests before it.
+      auto response = errorResponse(parse.error());
+      if (_metrics) {
+        _metrics->parseError(parse.error());
+        _metrics->response({}, response.statusCode());
+      }
+      const auto slot = http_session->reserveResponse();
+      http_session->closeAfter(slot);
+      http_session->completeResponse(slot, std::move(response), _server_name);
+      http_session->flushResponses();
+      buffer.retrieve(buffer.readableBytes());
+      parse.reset();
+      return;
+    }
+
+    if (parse.paused()) {
+      // The body consumer is behind, stop reading until it catches up.
+      http_session->pauseReading(
+          buffer, [this, weak = std::weak_ptr<HttpSession>{http_session}]() {
+            if (auto http_session = weak.lock()) {
+              processInput(http_session, http_session->backlog());
+            }
+          });
+      break;
+    }
+
+    if (parse.status() != HttpRequestParse::Status::OK) {
+      break;
+    }
+
+    if (!parse.streaming()) {
+      handleRequest(http_session, parse.request());
+    }
+    parse.reset();
+
+    if (http_session->upgraded()) {
+      // What follows the upgrade request is already WebSocket frames.
+      http_session->flushResponses();
+      processWebSocket(http_session, buffer);
+      return;
+    }
+
+    if (http_session->closing()) {
+      buffer.retrieve(buffer.readableBytes());
+      break;
+    }
+  }
+
+  http_session->flushResponses();
+  http_session->updateTimer(!buffer.empty());
+}
+
+auto HttpServer::routeRequest(const std::shared_ptr<HttpSession>& http_session,
+                              HttpRequest& request) -> void {
   auto path = request.path();
-  if (path.empty()) {
-    this->response(http_session, HttpResponse::makeNotFound());
-    http_session->httpRequestParse().reset();
+  if (path.size() > 1 && path.back() == '/') {
+    path.remove_suffix(1);
+  }
+
+  auto route = HttpRoute{};
+  if (!path.empty()) {
+    const auto match = _router.match(request.method(), path, request.params());
+    route = HttpRoute{match.handler, match.allowed, match.pattern, {}};
+  }
+  if (_metrics) {
+    route.routed_at = HttpMetrics::Clock::now();
+  }
+  http_session->setRoute(route);
+
+  if (route.handler == nullptr ||
+      route.handler->mode() != HttpHandler::Mode::Stream) {
+    return;
+  }
+
+  auto consumer = route.handler->openBody(
+      request, makeResponder(http_session, request,
+                             reserveResponse(http_session, request)));
+  if (!consumer) {
+    consumer = [](std::string_view) { return true; };
+  }
+  http_session->httpRequestParse().streamBody(std::move(consumer));
+}
+
+auto HttpServer::handleRequest(
+    const std::shared_ptr<HttpSession>& http_session,
+    const HttpRequest& request) -> void {
+  const auto slot = reserveResponse(http_session, request);
+
+  const auto route = http_session->route();
+  if (route.handler == nullptr) {
+    auto response = HttpResponse::makeNotFound();
+    if (route.allowed != 0) {
+      response = HttpResponse::makeMethodNotAllowed();
+      response.addHeader("Allow", HttpRouter::allowToString(route.allowed));
+    }
+    recordResponse(route, response.statusCode());
+    http_session->completeResponse(slot, std::move(response), _server_name);
+    return;
+  }
+
+  const auto& handler = *route.handler;
+  if (handler.mode() == HttpHandler::Mode::WebSocket) {
+    upgradeWebSocket(http_session, request, slot);
+    return;
+  }
+
+  const auto coding =
+      _compression ? HttpCompression::negotiate(
+                         request.header(HttpHeader::AcceptEncoding))
+                   : HttpCompression::Coding::Identity;
+
+  // A client whose copy is still current gets a 304 without the handler
+  // running or a body being built. It carries the Vary and ETag of the 200
+  // it stands for, compressed whenever a coding other than identity was
+  // negotiated: the route's Content-Type isn't known here.
+  const auto head = request.method() == HttpRequest::HEAD;
+  auto validators = HttpValidators{};
+  if (const auto* precondition = handler.precondition();
+      precondition != nullptr &&
+      (request.method() == HttpRequest::GET || head)) {
+    validators = (*precondition)(request);
+    if (validators.notModified(request)) {
+      auto response = HttpResponse::makeNotModified();
+      validators.addTo(response);
+      HttpCompression::applyHeaders(coding, response);
+      recordResponse(route, response.statusCode());
+      http_session->completeResponse(slot, std::move(response),
+                                     _server_name);
+      return;
+    }
+  }
+
+  // A fresh cached response is written without running the handler. The
+  // key includes the coding, since the cached bytes are already encoded.
+  const auto* policy = handler.cachePolicy();
+  auto cache_key = std::string{};
+  if (policy != nullptr && request.method() == HttpRequest::GET) {
+    cache_key = HttpResponseCache::makeKey(
+        request, *policy, HttpCompression::codingToString(coding));
+    if (auto bytes = _response_cache->find(cache_key)) {
+      recordResponse(route, HttpResponse::OK);
+      http_session->completeSerialized(slot, std::move(bytes));
+      return;
+    }
+  }
+
+  auto make_responder = [&]() {
+    auto responder = makeResponder(http_session, request, slot);
+    responder.validateWith(std::move(validators));
+    if (!cache_key.empty()) {
+      responder.cacheAs(_response_cache.get(), std::move(cache_key),
+                        policy->ttl);
+    }
+    return responder;
+  };
+
+  switch (handler.mode()) {
+    case HttpHandler::Mode::Async:
+      handler(request, make_responder());
+      return;
+    case HttpHandler::Mode::Offload:
+      if (_offload_pool) {
+        // The parser's arena is reused for the next request, so the pool
+        // gets its own copy.
+        struct OwnedRequest {
+          Arena arena;
+          HttpRequest request;
+        };
+        auto owned = std::make_shared<OwnedRequest>();
+        owned->request = request.copyTo(owned->arena);
+        _offload_pool->submit(
+            [handler = &handler, owned,
+             responder = std::make_shared<HttpResponder>(make_responder())]() {
+              responder->send((*handler)(owned->request));
+            });
+        return;
+      }
+      break;
+    default:
+      break;
+  }
+
+  auto response = handler(request);
+  if (response.statusCode() == HttpResponse::OK) {
+    validators.addTo(response);
+  }
+  if (_compression) {
+    _compression->apply(coding, response);
+  }
+  if (head) {
+    response.omitBody();
+  }
+
+  recordResponse(route, response.statusCode());
+  if (!cache_key.empty() && HttpResponseCache::cacheable(response)) {
+    auto bytes = std::make_shared<std::string>();
+    response.serialize(*bytes, _server_name);
+    _response_cache->insert(std::move(cache_key), bytes, policy->ttl);
+    http_session->completeSerialized(slot, std::move(bytes));
     return;
   }
+  http_session->completeResponse(slot, std::move(response), _server_name);
+}
+
+auto HttpServer::upgradeWebSocket(
+    const std::shared_ptr<HttpSession>& http_session,
+    const HttpRequest& request, std::uint64_t slot) -> void {
+  const auto& route = http_session->route();
+  const auto key = request.header(HttpHeader::SecWebSocketKey);
+  const auto version = request.header(HttpHeader::SecWebSocketVersion);
+
+  // Frames sent after the handshake would overtake responses still pending
+  // before it, so the upgrade must not be pipelined.
+  if (request.version() != HttpRequest::HTTP_1_1 ||
+      !request.hasConnectionOption("upgrade") ||
+      !equalsIgnoreCase(request.header(HttpHeader::Upgrade), "websocket") ||
+      key.empty() || version != "13" ||
+      http_session->pendingResponses() != 1 || http_session->closing()) {
+    auto response = HttpResponse::makeBadRequest();
+    if (version != "13") {
+      response.addHeader("Sec-WebSocket-Version", "13");
+    }
+    recordResponse(route, response.statusCode());
+    http_session->completeResponse(slot, std::move(response), _server_name);
+    return;
+  }
+
+  auto response = HttpResponse{};
+  response.setVersion(HttpResponse::HTTP_1_1);
+  response.setStatusCode(HttpResponse::SWITCHING_PROTOCOLS);
+  response.addHeader("Upgrade", "websocket");
+  response.addHeader("Connection", "Upgrade");
+  response.addHeader("Sec-WebSocket-Accept",
+                     WebSocketHandler::acceptKey(key));
+  recordResponse(route, response.statusCode());
+  http_session->completeResponse(slot, std::move(response), _server_name);
+
+  const auto& handler = route.handler->webSocketHandler();
+  http_session->upgrade(handler);
+  if (handler->on_open) {
+    handler->on_open(http_session->webSocket(), request);
+  }
+}
 
-  if (path.size() != 1 && path.back() == '/') {
-    path.pop_back();
+auto HttpServer::processWebSocket(
+    const std::shared_ptr<HttpSession>& http_session, net::Buffer& buffer)
+    -> void {
+  auto& parse = http_session->webSocketParse();
+  if (parse.status() != WebSocketParse::Status::Frame) {
+    buffer.retrieve(buffer.readableBytes());
+    return;
+  }
+  if (buffer.empty()) {
+    return;
   }
 
-  auto handler_it = _handlers.find(path);
-  if (handler_it == _handlers.end()) {
-    this->response(http_session, HttpResponse::makeNotFound());
-    http_session->httpRequestParse().reset();
+  http_session->webSocketActivity();
+  const auto& handler = http_session->webSocketHandler();
+  const auto socket = http_session->webSocket();
+  parse.run(buffer, [&](WebSocketFrame::Opcode opcode,
+                        std::string_view payload) {
+    switch (opcode) {
+      case WebSocketFrame::Opcode::Ping:
+        http_session->sendFrame(WebSocketFrame::Opcode::Pong, payload);
+        break;
+      case WebSocketFrame::Opcode::Pong:
+        break;
+      case WebSocketFrame::Opcode::Close: {
+        auto code = std::uint16_t{WebSocketFrame::NO_STATUS};
+        if (payload.size() >= 2) {
+          code = static_cast<std::uint16_t>(
+              (static_cast<std::uint8_t>(payload[0]) << 8) |
+              static_cast<std::uint8_t>(payload[1]));
+        }
+        // Answer with the same code, unless this answers our close frame.
+        http_session->closeWebSocket(code != WebSocketFrame::NO_STATUS
+                                         ? code
+                                         : std::uint16_t{
+                                               WebSocketFrame::NORMAL});
+        http_session->webSocketClosed(code);
+        http_session->close();
+        break;
+      }
+      default:
+        if (handler.on_message) {
+          handler.on_message(socket, payload,
+                             opcode == WebSocketFrame::Opcode::Binary);
+        }
+        break;
+    }
+  });
+
+  if (parse.status() == WebSocketParse::Status::INVALID) {
+    http_session->closeWebSocket(parse.closeCode());
+    http_session->webSocketClosed(parse.closeCode());
+    http_session->close();
+  }
+  if (parse.status() != WebSocketParse::Status::Frame) {
+    buffer.retrieve(buffer.readableBytes());
     return;
   }
+  // Pongs and the frames the handler sent while reading go out together.
+  http_session->flushResponses();
+}
 
-  auto response = handler_it->second(request);
-  this->response(http_session, response);
-  http_session->httpRequestParse().reset();
+auto HttpServer::reserveResponse(
+    const std::shared_ptr<HttpSession>& http_session,
+    const HttpRequest& request) -> std::uint64_t {
+  const auto slot = http_session->reserveResponse();
+  if (!request.keepAlive() ||
+      (_max_requests != 0 && _max_requests <= http_session->requestCount())) {
+    http_session->closeAfter(slot);
+  } else if (request.version() == HttpRequest::HTTP_1_0) {
+    http_session->setKeepAliveHeader(true);
+  }
+  return slot;
+}
+
+auto HttpServer::makeResponder(
+    const std::shared_ptr<HttpSession>& http_session,
+    const HttpRequest& request, std::uint64_t slot) -> HttpResponder {
+  auto responder =
+      _compression
+          ? HttpResponder{http_session, slot, _server_name,
+                          _compression.get(),
+                          HttpCompression::negotiate(
+                              request.header(HttpHeader::AcceptEncoding))}
+          : HttpResponder{http_session, slot, _server_name};
+  if (request.method() == HttpRequest::HEAD) {
+    responder.omitBody();
+  }
+  if (_metrics) {
+    const auto& route = http_session->route();
+    responder.recordIn(_metrics.get(), route.pattern, route.routed_at);
+  }
+  return responder;
+}
+
+auto HttpServer::recordResponse(const HttpRoute& route, std::uint16_t status)
+    -> void {
+  if (_metrics) {
+    _metrics->response(route.pattern, status,
+                       HttpMetrics::Clock::now() - route.routed_at);
+  }
 }
 
 }  // namespace fz::http
@@ -0,0 +1,349 @@
+#include "http/http_static_files.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "http/http_date.h"
+#include "http/http_header.h"
+#include "http/http_validators.h"
+
+namespace fz::http {
+
+struct HttpStaticFiles::File {
+  std::string path;
+  int fd{-1};
+  void* data{nullptr};
+  std::size_t size{0};
+  ino_t inode{0};
+  timespec mtime{};
+  std::string etag;
+  std::string last_modified;
+
+  File() = default;
+
+  File(const File&) = delete;
+
+  auto operator=(const File&) -> File& = delete;
+
+  ~File() {
+    if (data != nullptr) {
+      munmap(data, size);
+    }
+    if (fd != -1) {
+      ::close(fd);
+    }
+  }
+
+  auto content() const -> std::string_view {
+    return {static_cast<const char*>(data), size};
+  }
+
+  auto matches(const struct stat& st) const -> bool {
+    return inode == st.st_ino && size == static_cast<std::size_t>(st.st_size) &&
+           mtime.tv_sec == st.st_mtim.tv_sec &&
+           mtime.tv_nsec == st.st_mtim.tv_nsec;
+  }
+};
+
+namespace {
+
+struct ByteRange {
+  std::size_t begin;
+  std::size_t end;  // exclusive
+};
+
+auto parseNumber(std::string_view data) -> std::optional<std::size_t> {
+  auto value = std::size_t{0};
+  const auto* end = data.data() + data.size();
+  auto [ptr, ec] = std::from_chars(data.data(), end, value);
+  if (data.empty() || ec != std::errc{} || ptr != end) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+/**
+ * @brief Parse a single "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+ * range. Returns nullopt for anything else, including multiple ranges, in
+ * which case the range is ignored and the whole file is sent.
+ */
+auto parseRange(std::string_view range, std::size_t size, bool& satisfiable)
+    -> std::optional<ByteRange> {
+  satisfiable = true;
+  constexpr auto unit = std::string_view{"bytes="};
+  if (!range.starts_with(unit) || range.find(',') != std::string_view::npos) {
+    return std::nullopt;
+  }
+  range.remove_prefix(unit.size());
+
+  const auto dash = range.find('-');
+  if (dash == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  const auto first = range.substr(0, dash);
+  const auto last = range.substr(dash + 1);
+  if (first.empty()) {
+    const auto suffix = parseNumber(last);
+    if (!suffix) {
+      return std::nullopt;
+    }
+    if (*suffix == 0 || size == 0) {
+      satisfiable = false;
+      return std::nullopt;
+    }
+    return ByteRange{size - std::min(*suffix, size), size};
+  }
+
+  const auto begin = parseNumber(first);
+  if (!begin) {
+    return std::nullopt;
+  }
+  auto end = size;
+  if (!last.empty()) {
+    const auto last_pos = parseNumber(last);
+    if (!last_pos || *last_pos < *begin) {
+      return std::nullopt;
+    }
+    end = std::min(*last_pos + 1, size);
+  }
+
+  if (size <= *begin) {
+    satisfiable = false;
+    return std::nullopt;
+  }
+  return ByteRange{*begin, end};
+}
+
+/**
+ * @brief Decode %XX escapes. Returns nullopt for a malformed escape, and for
+ * an escaped '/' or NUL: the first would split a segment the router saw as
+ * one, the second would cut the path short at the system call.
+ */
+auto percentDecode(std::string_view path) -> std::optional<std::string> {
+  auto decoded = std::string{};
+  decoded.reserve(path.size());
+  for (std::size_t i = 0; i < path.size(); ++i) {
+    if (path[i] != '%') {
+      decoded += path[i];
+      continue;
+    }
+    auto value = std::uint8_t{0};
+    const auto* begin = path.data() + i + 1;
+    const auto* end = path.data() + std::min(i + 3, path.size());
+    auto [ptr, ec] = std::from_chars(begin, end, value, 16);
+    if (end - begin != 2 || ec != std::errc{} || ptr != end || value == '/' ||
+        value == '\0') {
+      return std::nullopt;
+    }
+    decoded += static_cast<char>(value);
+    i += 2;
+  }
+  return decoded;
+}
+
+template <typename T>
+auto appendHex(std::string& out, T value) -> void {
+  auto digits = std::array<char, sizeof(T) * 2>{};
+  auto [ptr, ec] =
+      std::to_chars(digits.data(), digits.data() + digits.size(), value, 16);
+  out.append(digits.data(), ptr);
+}
+
+}  // namespace
+
+HttpStaticFiles::HttpStaticFiles(std::filesystem::path root, Options options)
+    : _root{std::filesystem::absolute(std::move(root)).lexically_normal()},
+      _options{std::move(options)} {}
+
+HttpStaticFiles::~HttpStaticFiles() = default;
+
+auto HttpStaticFiles::contentType(std::string_view path) -> std::string_view {
+  constexpr auto types =
+      std::array<std::pair<std::string_view, std::string_view>, 14>{{
+      {".html", "text/html; charset=utf-8"},
+      {".htm", "text/html; charset=utf-8"},
+      {".css", "text/css; charset=utf-8"},
+      {".js", "text/javascript; charset=utf-8"},
+      {".json", "application/json"},
+      {".txt", "text/plain; charset=utf-8"},
+      {".svg", "image/svg+xml"},
+      {".png", "image/png"},
+      {".jpg", "image/jpeg"},
+      {".jpeg", "image/jpeg"},
+      {".gif", "image/gif"},
+      {".ico", "image/x-icon"},
+      {".wasm", "application/wasm"},
+      {".pdf", "application/pdf"},
+  }};
+
+  const auto dot = path.rfind('.');
+  if (dot != std::string_view::npos) {
+    const auto extension = path.substr(dot);
+    for (const auto& [known, type] : types) {
+      if (equalsIgnoreCase(extension, known)) {
+        return type;
+      }
+    }
+  }
+  return "application/octet-stream";
+}
+
+auto HttpStaticFiles::serve(const HttpRequest& request, std::string_view path)
+    -> HttpResponse {
+  const auto decoded = percentDecode(path);
+  if (!decoded || decoded->find('\0') != std::string::npos) {
+    return HttpResponse::makeBadRequest();
+  }
+  path = *decoded;
+  while (path.starts_with('/')) {
+    path.remove_prefix(1);
+  }
+
+  // Resolve lexically first, after decoding, so ".." can't walk out of the
+  // root, however it is spelled.
+  auto full_path = (_root / std::filesystem::path{path}).lexically_normal();
+  const auto relative = full_path.lexically_relative(_root);
+  if (relative.empty() || *relative.begin() == "..") {
+    auto response = HttpResponse{};
+    response.setVersion(HttpResponse::HTTP_1_1);
+    response.setStatusCode(HttpResponse::FORBIDDEN);
+    return response;
+  }
+
+  if (path.empty() || path.ends_with('/')) {
+    full_path /= _options.index;
+  }
+
+  auto file = open(full_path);
+  if (!file) {
+    return HttpResponse::makeNotFound();
+  }
+
+  const auto validators = HttpValidators{file->etag, file->last_modified};
+  if (validators.notModified(request)) {
+    auto response = HttpResponse::makeNotModified();
+    validators.addTo(response);
+    return response;
+  }
+
+  auto response = HttpResponse::makeOk();
+  response.addHeader("Content-Type", contentType(full_path.native()));
+  response.addHeader("Accept-Ranges", "bytes");
+  validators.addTo(response);
+
+  auto content = file->content();
+  if (request.hasHeader(HttpHeader::Range)) {
+    auto satisfiable = true;
+    const auto range =
+        parseRange(request.header(HttpHeader::Range), file->size, satisfiable);
+    if (!satisfiable) {
+      auto unsatisfiable = HttpResponse{};
+      unsatisfiable.setVersion(HttpResponse::HTTP_1_1);
+      unsatisfiable.setStatusCode(HttpResponse::RANGE_NOT_SATISFIABLE);
+      unsatisfiable.addHeader("Content-Range",
+                              "bytes */" + std::to_string(file->size));
+      return unsatisfiable;
+    }
+
+    if (range) {
+      response.setStatusCode(HttpResponse::PARTIAL_CONTENT);
+      response.addHeader("Content-Range",
+                         "bytes " + std::to_string(range->begin) + "-" +
+                             std::to_string(range->end - 1) + "/" +
+                             std::to_string(file->size));
+      content = content.substr(range->begin, range->end - range->begin);
+    }
+  }
+
+  response.setBody(content, file);
+  return response;
+}
+
+auto HttpStaticFiles::open(const std::filesystem::path& path)
+    -> std::shared_ptr<const File> {
+  struct stat st {};
+  if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+
+  const auto& key = path.native();
+  {
+    auto lock = std::lock_guard{_mutex};
+    auto it = _files.find(key);
+    if (it != _files.end()) {
+      if ((*it->second)->matches(st)) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return *it->second;
+      }
+
+      // Stale, the file changed on disk.
+      _cached_bytes -= (*it->second)->size;
+      _lru.erase(it->second);
+      _files.erase(it);
+    }
+  }
+
+  auto file = std::make_shared<File>();
+  file->path = key;
+  file->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file->fd == -1 || ::fstat(file->fd, &st) != 0) {
+    return nullptr;
+  }
+
+  file->size = static_cast<std::size_t>(st.st_size);
+  file->inode = st.st_ino;
+  file->mtime = st.st_mtim;
+  if (file->size != 0) {
+    file->data =
+        mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (file->data == MAP_FAILED) {
+      file->data = nullptr;
+      return nullptr;
+    }
+  }
+
+  file->etag.push_back('"');
+  appendHex(file->etag, static_cast<std::uint64_t>(file->size));
+  file->etag.push_back('-');
+  appendHex(file->etag, static_cast<std::uint64_t>(st.st_mtim.tv_sec) *
+                            1000000000 +
+                        static_cast<std::uint64_t>(st.st_mtim.tv_nsec));
+  file->etag.push_back('"');
+  auto date = HttpDate::Buffer{};
+  file->last_modified = HttpDate::format(st.st_mtim.tv_sec, date);
+
+  auto lock = std::lock_guard{_mutex};
+  if (_files.contains(key)) {
+    // Another loop thread opened it meanwhile, serve ours uncached.
+    return file;
+  }
+  _lru.push_front(file);
+  _files.emplace(key, _lru.begin());
+  _cached_bytes += file->size;
+  evict();
+  return file;
+}
+
+auto HttpStaticFiles::evict() -> void {
+  // In-flight responses hold their own reference, evicting only drops the
+  // cache's.
+  while (1 < _lru.size() && (_options.max_cached_files < _lru.size() ||
+                             _options.max_cached_bytes < _cached_bytes)) {
+    const auto& file = _lru.back();
+    _cached_bytes -= file->size;
+    _files.erase(file->path);
+    _lru.pop_back();
+  }
+}
+
+}  // namespace fz::http
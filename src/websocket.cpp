@@ -0,0 +1,229 @@
+#include "http/websocket.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <utility>
+
+#include "http/http_session.h"
+
+namespace fz::http {
+
+namespace {
+
+using Sha1Digest = std::array<std::uint8_t, 20>;
+
+/**
+ * @brief SHA-1 (RFC 3174). Only used for the handshake, which the protocol
+ * defines with it; nothing here relies on it being collision resistant.
+ */
+auto sha1(std::string_view data) -> Sha1Digest {
+  auto h = std::array<std::uint32_t, 5>{0x67452301, 0xefcdab89, 0x98badcfe,
+                                        0x10325476, 0xc3d2e1f0};
+
+  // The message, a 1 bit, zeros up to 56 mod 64 bytes and the bit length.
+  auto message = std::string{data};
+  message.push_back(static_cast<char>(0x80));
+  while (message.size() % 64 != 56) {
+    message.push_back('\0');
+  }
+  const auto bits = static_cast<std::uint64_t>(data.size()) * 8;
+  for (auto shift = 56; shift >= 0; shift -= 8) {
+    message.push_back(static_cast<char>((bits >> shift) & 0xff));
+  }
+
+  for (std::size_t block = 0; block < message.size(); block += 64) {
+    auto w = std::array<std::uint32_t, 80>{};
+    for (std::size_t i = 0; i < 16; ++i) {
+      for (std::size_t j = 0; j < 4; ++j) {
+        w[i] = (w[i] << 8) |
+               static_cast<std::uint8_t>(message[block + i * 4 + j]);
+      }
+    }
+    for (std::size_t i = 16; i < w.size(); ++i) {
+      w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    auto [a, b, c, d, e] = h;
+    for (std::size_t i = 0; i < w.size(); ++i) {
+      auto f = std::uint32_t{0};
+      auto k = std::uint32_t{0};
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5a827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ed9eba1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8f1bbcdc;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xca62c1d6;
+      }
+      const auto temp = std::rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = std::rotl(b, 30);
+      b = a;
+      a = temp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  auto digest = Sha1Digest{};
+  for (std::size_t i = 0; i < digest.size(); ++i) {
+    digest[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+  }
+  return digest;
+}
+
+auto base64(const Sha1Digest& data) -> std::string {
+  constexpr auto ALPHABET = std::string_view{
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"};
+
+  auto out = std::string{};
+  for (std::size_t i = 0; i < data.size(); i += 3) {
+    const auto left = data.size() - i;
+    auto group = static_cast<std::uint32_t>(data[i]) << 16;
+    if (left > 1) {
+      group |= static_cast<std::uint32_t>(data[i + 1]) << 8;
+    }
+    if (left > 2) {
+      group |= data[i + 2];
+    }
+    out += ALPHABET[(group >> 18) & 0x3f];
+    out += ALPHABET[(group >> 12) & 0x3f];
+    out += left > 1 ? ALPHABET[(group >> 6) & 0x3f] : '=';
+    out += left > 2 ? ALPHABET[group & 0x3f] : '=';
+  }
+  return out;
+}
+
+auto lockSession(const std::weak_ptr<net::Session>& weak)
+    -> std::shared_ptr<HttpSession> {
+  return std::static_pointer_cast<HttpSession>(weak.lock());
+}
+
+}  // namespace
+
+auto WebSocket::sendFrame(WebSocketFrame::Opcode opcode,
+                          std::string_view payload) const -> void {
+  if (auto session = lockSession(_session)) {
+    session->post([session, opcode, payload = std::string{payload}]() {
+      session->sendFrame(opcode, payload);
+    });
+  }
+}
+
+auto WebSocket::sendSerialized(std::shared_ptr<const std::string> frame) const
+    -> void {
+  if (auto session = lockSession(_session)) {
+    session->post([session, frame = std::move(frame)]() {
+      session->sendSerialized(*frame);
+    });
+  }
+}
+
+auto WebSocket::close(std::uint16_t code, std::string_view reason) const
+    -> void {
+  if (auto session = lockSession(_session)) {
+    session->post([session, code, reason = std::string{reason}]() {
+      session->closeWebSocket(code, reason);
+    });
+  }
+}
+
+auto WebSocketHandler::acceptKey(std::string_view key) -> std::string {
+  constexpr auto GUID =
+      std::string_view{"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"};
+  auto input = std::string{key};
+  input += GUID;
+  return base64(sha1(input));
+}
+
+auto WebSocketBroadcast::subscribe(const WebSocket& socket) -> void {
+  auto session = lockSession(socket._session);
+  if (!session) {
+    return;
+  }
+
+  auto lock = std::lock_guard{_mutex};
+  auto group = std::find_if(_groups.begin(), _groups.end(),
+                            [&session](const Group& group) {
+                              return group.loop == session->loop();
+                            });
+  if (group == _groups.end()) {
+    _groups.push_back({session->loop(), std::make_shared<Members>()});
+    group = std::prev(_groups.end());
+  }
+
+  auto& members = writable(*group);
+  if (std::find_if(members.begin(), members.end(), [&socket](const auto& m) {
+        return WebSocket{m} == socket;
+      }) == members.end()) {
+    members.push_back(socket._session);
+  }
+}
+
+auto WebSocketBroadcast::unsubscribe(const WebSocket& socket) -> void {
+  const auto same = [&socket](const auto& m) { return WebSocket{m} == socket; };
+
+  auto lock = std::lock_guard{_mutex};
+  for (auto& group : _groups) {
+    if (std::any_of(group.members->begin(), group.members->end(), same)) {
+      std::erase_if(writable(group), same);
+      break;
+    }
+  }
+  std::erase_if(_groups,
+                [](const Group& group) { return group.members->empty(); });
+}
+
+auto WebSocketBroadcast::size() const -> std::size_t {
+  auto lock = std::lock_guard{_mutex};
+  auto size = std::size_t{0};
+  for (const auto& group : _groups) {
+    size += group.members->size();
+  }
+  return size;
+}
+
+auto WebSocketBroadcast::publishSerialized(
+    std::shared_ptr<const std::string> frame) const -> void {
+  auto groups = std::vector<std::pair<std::shared_ptr<net::Loop>,
+                                      std::shared_ptr<const Members>>>{};
+  {
+    auto lock = std::lock_guard{_mutex};
+    groups.reserve(_groups.size());
+    for (const auto& group : _groups) {
+      groups.emplace_back(group.loop, group.members);
+    }
+  }
+
+  for (auto& [loop, members] : groups) {
+    loop->post([frame, members = std::move(members)]() {
+      for (const auto& member : *members) {
+        if (auto session = lockSession(member)) {
+          session->sendSerialized(*frame);
+        }
+      }
+    });
+  }
+}
+
+auto WebSocketBroadcast::writable(Group& group) -> Members& {
+  // A publish in flight holds the other reference, copy before writing.
+  if (group.members.use_count() > 1) {
+    group.members = std::make_shared<Members>(*group.members);
+  }
+  std::erase_if(*group.members,
+                [](const auto& member) { return member.expired(); });
+  return *group.members;
+}
+
+}  // namespace fz::http
@@ -0,0 +1,203 @@
+#include "http/websocket_frame.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FZ_HTTP_MASK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace fz::http {
+
+namespace {
+
+/**
+ * @brief key rotated so that its first byte applies to data[0].
+ */
+auto rotate(WebSocketFrame::MaskingKey key, std::size_t offset)
+    -> WebSocketFrame::MaskingKey {
+  auto rotated = WebSocketFrame::MaskingKey{};
+  for (std::size_t i = 0; i < rotated.size(); ++i) {
+    rotated[i] = key[(offset + i) % key.size()];
+  }
+  return rotated;
+}
+
+auto maskScalar(char* data, std::size_t size, WebSocketFrame::MaskingKey key)
+    -> void {
+  // Eight bytes at a time through memcpy, which keeps the byte order of
+  // the pattern whatever the endianness.
+  auto pattern = std::array<std::uint8_t, 8>{};
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    pattern[i] = key[i % key.size()];
+  }
+  auto word_mask = std::uint64_t{0};
+  std::memcpy(&word_mask, pattern.data(), sizeof(word_mask));
+
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    auto word = std::uint64_t{0};
+    std::memcpy(&word, data + i, sizeof(word));
+    word ^= word_mask;
+    std::memcpy(data + i, &word, sizeof(word));
+  }
+  for (; i < size; ++i) {
+    data[i] = static_cast<char>(data[i] ^ key[i % key.size()]);
+  }
+}
+
+#ifdef FZ_HTTP_MASK_X86
+
+__attribute__((target("sse2"))) auto maskSse2(char* data, std::size_t size,
+                                              WebSocketFrame::MaskingKey key)
+    -> void {
+  auto key_word = std::int32_t{0};
+  std::memcpy(&key_word, key.data(), sizeof(key_word));
+  const auto pattern = _mm_set1_epi32(key_word);
+
+  // Every block is a multiple of the key size, so the tail starts at
+  // offset zero of the key again.
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto* block = reinterpret_cast<__m128i*>(data + i);
+    _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), pattern));
+  }
+  maskScalar(data + i, size - i, key);
+}
+
+__attribute__((target("avx2"))) auto maskAvx2(char* data, std::size_t size,
+                                              WebSocketFrame::MaskingKey key)
+    -> void {
+  auto key_word = std::int32_t{0};
+  std::memcpy(&key_word, key.data(), sizeof(key_word));
+  const auto pattern = _mm256_set1_epi32(key_word);
+
+  std::size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto* block = reinterpret_cast<__m256i*>(data + i);
+    _mm256_storeu_si256(block,
+                        _mm256_xor_si256(_mm256_loadu_si256(block), pattern));
+  }
+  maskScalar(data + i, size - i, key);
+}
+
+#endif  // FZ_HTTP_MASK_X86
+
+auto detectKernel() -> WebSocketFrame::Kernel {
+  if (WebSocketFrame::supported(WebSocketFrame::Kernel::AVX2)) {
+    return WebSocketFrame::Kernel::AVX2;
+  }
+  if (WebSocketFrame::supported(WebSocketFrame::Kernel::SSE2)) {
+    return WebSocketFrame::Kernel::SSE2;
+  }
+  return WebSocketFrame::Kernel::Scalar;
+}
+
+}  // namespace
+
+auto WebSocketFrame::closePayload(std::uint16_t code, std::string_view reason)
+    -> std::string {
+  auto payload = std::string{};
+  payload.push_back(static_cast<char>(code >> 8));
+  payload.push_back(static_cast<char>(code & 0xff));
+  payload.append(reason.substr(0, MAX_CONTROL_PAYLOAD - payload.size()));
+  return payload;
+}
+
+auto WebSocketFrame::supported(Kernel kernel) -> bool {
+  switch (kernel) {
+#ifdef FZ_HTTP_MASK_X86
+    case Kernel::SSE2:
+      return __builtin_cpu_supports("sse2");
+    case Kernel::AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    case Kernel::Scalar:
+      return true;
+    default:
+      return false;
+  }
+}
+
+auto WebSocketFrame::kernel() -> Kernel {
+  static const auto kernel = detectKernel();
+  return kernel;
+}
+
+auto WebSocketFrame::mask(char* data, std::size_t size, MaskingKey key,
+                          std::size_t offset) -> void {
+  mask(kernel(), data, size, key, offset);
+}
+
+auto WebSocketFrame::mask(Kernel kernel, char* data, std::size_t size,
+                          MaskingKey key, std::size_t offset) -> void {
+  key = rotate(key, offset);
+  switch (kernel) {
+#ifdef FZ_HTTP_MASK_X86
+    case Kernel::SSE2:
+      maskSse2(data, size, key);
+      return;
+    case Kernel::AVX2:
+      maskAvx2(data, size, key);
+      return;
+#endif
+    default:
+      maskScalar(data, size, key);
+      return;
+  }
+}
+
+auto WebSocketFrame::validUtf8(std::string_view data) -> bool {
+  const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+  const auto size = data.size();
+  std::size_t i = 0;
+  while (i < size) {
+    // Skip ASCII eight bytes at a time, the common case for text.
+    if (i + 8 <= size) {
+      auto word = std::uint64_t{0};
+      std::memcpy(&word, bytes + i, sizeof(word));
+      if ((word & 0x8080808080808080ULL) == 0) {
+        i += 8;
+        continue;
+      }
+    }
+
+    const auto lead = bytes[i];
+    if (lead < 0x80) {
+      ++i;
+      continue;
+    }
+
+    // The valid range of the second byte depends on the lead byte, which
+    // rules out overlong forms, surrogates and code points past U+10FFFF.
+    auto length = std::size_t{0};
+    auto low = std::uint8_t{0x80};
+    auto high = std::uint8_t{0xbf};
+    if (lead >= 0xc2 && lead <= 0xdf) {
+      length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+      length = 3;
+      low = lead == 0xe0 ? 0xa0 : 0x80;
+      high = lead == 0xed ? 0x9f : 0xbf;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+      length = 4;
+      low = lead == 0xf0 ? 0x90 : 0x80;
+      high = lead == 0xf4 ? 0x8f : 0xbf;
+    } else {
+      return false;
+    }
+
+    if (size - i < length || bytes[i + 1] < low || bytes[i + 1] > high) {
+      return false;
+    }
+    for (std::size_t j = 2; j < length; ++j) {
+      if ((bytes[i + j] & 0xc0) != 0x80) {
+        return false;
+      }
+    }
+    i += length;
+  }
+  return true;
+}
+
+}  // namespace fz::http
@@ -1,5 +1,7 @@
 #include <asio.hpp>
-#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string_view>
 
 #include "asio/io_context.hpp"
@@ -9,63 +11,120 @@ int main() {
   asio::io_context io_context;
 
   fz::http::HttpServer server{2, "0.0.0.0", 80};
-  server.registerHandler("/hello", [](const auto& request) {
-    if (request.method() != fz::http::HttpRequest::Method::GET) {
-      auto res = fz::http::HttpResponse::makeMethodNotAllowed();
-      return res;
-    }
-
+  server.registerHandler(fz::http::HttpRequest::GET, "/hello", [](const auto&) {
     auto response = fz::http::HttpResponse::makeOk();
-    response.addHeader("Server", "fz");
-    response.addHeader("Content-Length", "11");
     response.addHeader("Content-Type", "text/plain");
     response.setBody("hello world");
 
     return response;
   });
 
-  server.registerHandler("/post", [](const auto& request) {
-    if (request.method() != fz::http::HttpRequest::Method::POST) {
-      auto res = fz::http::HttpResponse::makeMethodNotAllowed();
-      return res;
-    }
-
+  server.registerHandler(fz::http::HttpRequest::POST, "/post", [](const auto&) {
     auto response = fz::http::HttpResponse::makeOk();
     std::string_view body = "<html><body><h1>POST</h1></body></html>";
-    response.addHeader("Server", "fz");
-    response.addHeader("Content-Length", std::to_string(body.size()));
     response.addHeader("Content-Type", "text/html");
     response.setBody(body);
 
     return response;
   });
 
-  server.registerHandler("/", [](const auto& request) {
-    constexpr auto index_file = "./tmp/index.html";
-    auto response = fz::http::HttpResponse::makeOk();
-    response.addHeader("Server", "fz");
-    response.addHeader("Content-Type", "text/html; charset=utf-8");
-    response.addHeader("Connection", "keep-alive");
-
-    auto ifs = std::ifstream(index_file, std::ios::in | std::ios::binary);
-    if (!ifs) {
-      auto body = "<html><body><h1>Web Server Home</h1></body></html>";
-      response.addHeader("Content-Length", std::to_string(strlen(body)));
-      response.setBody(body);
-      return response;
+  server.registerHandler(
+      fz::http::HttpRequest::GET, "/users/:id", [](const auto& request) {
+        auto response = fz::http::HttpResponse::makeOk();
+        response.addHeader("Content-Type", "text/plain");
+        response.setBody(std::string{"user "}.append(request.param("id")));
+        return response;
+      });
+
+  auto files = std::make_shared<fz::http::HttpStaticFiles>("./tmp");
+  server.registerHandler("/", [files](const auto& request) {
+    auto response = files->serve(request, "index.html");
+    if (response.statusCode() == fz::http::HttpResponse::NOT_FOUND) {
+      response = fz::http::HttpResponse::makeOk();
+      response.addHeader("Content-Type", "text/html; charset=utf-8");
+      response.setBody("<html><body><h1>Web Server Home</h1></body></html>");
     }
-
-    ifs.seekg(0, std::ios::end);
-    auto length = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
-    response.addHeader("Content-Length", std::to_string(length));
-    auto body = std::string(length, '\0');
-    ifs.read(body.data(), length);
-    response.setBody(body);
-
     return response;
   });
 
+  server.serveStatic("/static/", "./tmp");
+  server.enableCompression();
+  server.enableMetrics();
+
+  // CPU heavy work runs on the offload pool instead of the event loop, and
+  // its result is cached for a minute.
+  server.setOffloadThreads(2);
+  server.registerHandler(
+      fz::http::HttpRequest::GET, "/sum",
+      fz::http::HttpHandler::cached(
+          fz::http::HttpHandler::offload([](const auto&) {
+            auto sum = std::uint64_t{0};
+            for (auto i = std::uint64_t{0}; i < 100'000'000; ++i) {
+              sum += i;
+            }
+            auto response = fz::http::HttpResponse::makeOk();
+            response.setBody(std::to_string(sum));
+            return response;
+          }),
+          {.ttl = std::chrono::minutes{1}}));
+
+  server.registerHandler(
+      fz::http::HttpRequest::GET, "/report", [](const auto&) {
+        auto response = fz::http::HttpResponse::makeOk();
+        response.addHeader("Content-Type", "text/csv");
+        response.setChunkedBody([row = 0](auto& writer) mutable {
+          writer.write("row," + std::to_string(row) + "\n");
+          return ++row < 1000;
+        });
+        return response;
+      });
+
+  // Uploads are counted as they arrive instead of being buffered.
+  server.registerHandler(
+      fz::http::HttpRequest::POST, "/upload",
+      fz::http::HttpHandler::stream([](const auto&, auto responder) {
+        auto shared = std::make_shared<decltype(responder)>(
+            std::move(responder));
+        return [shared, size = std::size_t{0}](auto data) mutable {
+          size += data.size();
+          if (data.empty()) {
+            auto response = fz::http::HttpResponse::makeOk();
+            response.setBody(std::to_string(size));
+            shared->send(std::move(response));
+          }
+          return true;
+        };
+      }));
+
+  // Pollers that already have the current version get a 304.
+  auto version = std::make_shared<std::atomic<int>>(1);
+  server.registerHandler(
+      fz::http::HttpRequest::GET, "/feed",
+      fz::http::HttpHandler::conditional(
+          [version](const auto&) {
+            auto response = fz::http::HttpResponse::makeOk();
+            response.setBody("version " + std::to_string(version->load()));
+            return response;
+          },
+          [version](const auto&) {
+            return fz::http::HttpValidators{
+                "\"" + std::to_string(version->load()) + "\"", {}};
+          }));
+
+  // Every message is relayed to everyone in the room.
+  auto room = std::make_shared<fz::http::WebSocketBroadcast>();
+  auto chat = fz::http::WebSocketHandler{};
+  chat.on_open = [room](const auto& socket, const auto&) {
+    room->subscribe(socket);
+  };
+  chat.on_message = [room](const auto&, auto message, bool) {
+    room->publish(message);
+  };
+  chat.on_close = [room](const auto& socket, auto) {
+    room->unsubscribe(socket);
+  };
+  server.webSocket("/chat", std::move(chat));
+
   server.start();
 
   asio::signal_set signals(io_context, SIGINT, SIGTERM);
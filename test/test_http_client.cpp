@@ -0,0 +1,405 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <coroutine>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "http/http_client.h"
+
+using namespace std::chrono_literals;
+using fz::http::HttpClient;
+using fz::http::HttpRequest;
+
+namespace {
+
+/**
+ * @brief Blocking stand-in server, one thread per connection, answering by
+ * path:
+ *
+ *   /hello    "hello"
+ *   /echo     the request body, with the Host it got in X-Host
+ *   /chunked  "hello world" in two chunks
+ *   /close    "bye" with Connection: close
+ *   /slow     nothing
+ */
+class TestServer {
+ public:
+  TestServer() {
+    _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    const auto on = 1;
+    ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    auto address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto size = socklen_t{sizeof(address)};
+    [[maybe_unused]] auto r =
+        ::bind(_fd, reinterpret_cast<sockaddr*>(&address), size);
+    assert(r == 0);
+    r = ::listen(_fd, 64);
+    assert(r == 0);
+    ::getsockname(_fd, reinterpret_cast<sockaddr*>(&address), &size);
+    _port = ntohs(address.sin_port);
+    _thread = std::thread{[this] { accept(); }};
+  }
+
+  ~TestServer() {
+    ::shutdown(_fd, SHUT_RDWR);
+    ::close(_fd);
+    _thread.join();
+    for (auto& connection : _connections) {
+      connection.join();
+    }
+  }
+
+  auto port() const { return _port; }
+
+  auto accepted() const { return _accepted.load(); }
+
+ private:
+  auto accept() -> void {
+    while (true) {
+      const auto fd = ::accept(_fd, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      ++_accepted;
+      _connections.emplace_back([fd] { serve(fd); });
+    }
+  }
+
+  static auto serve(int fd) -> void {
+    auto input = std::string{};
+    auto data = std::array<char, 4096>{};
+    while (true) {
+      const auto end = input.find("\r\n\r\n");
+      if (end == std::string::npos) {
+        const auto n = ::read(fd, data.data(), data.size());
+        if (n <= 0) {
+          break;
+        }
+        input.append(data.data(), static_cast<std::size_t>(n));
+        continue;
+      }
+
+      const auto head = std::string_view{input}.substr(0, end + 4);
+      auto length = std::size_t{0};
+      if (const auto pos = head.find("Content-Length: ");
+          pos != std::string_view::npos) {
+        const auto* first = head.data() + pos + 16;
+        std::from_chars(first, head.data() + head.size(), length);
+      }
+      if (input.size() < head.size() + length) {
+        const auto n = ::read(fd, data.data(), data.size());
+        if (n <= 0) {
+          break;
+        }
+        input.append(data.data(), static_cast<std::size_t>(n));
+        continue;
+      }
+
+      const auto target = head.find(' ') + 1;
+      const auto path = std::string{
+          head.substr(target, head.find(' ', target) - target)};
+      const auto body = std::string{input.substr(head.size(), length)};
+      const auto host_pos = head.find("Host: ") + 6;
+      const auto host =
+          std::string{head.substr(host_pos, head.find("\r\n", host_pos) -
+                                                host_pos)};
+      const auto is_head = head.starts_with("HEAD ");
+      input.erase(0, head.size() + length);
+
+      auto response = std::string{};
+      auto close = false;
+      if (path == "/hello") {
+        response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+      } else if (path == "/echo") {
+        response = "HTTP/1.1 200 OK\r\nX-Host: " + host +
+                   "\r\nContent-Length: " + std::to_string(body.size()) +
+                   "\r\n\r\n" + body;
+      } else if (path == "/chunked") {
+        response =
+            "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+      } else if (path == "/close") {
+        response =
+            "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 3\r\n"
+            "\r\nbye";
+        close = true;
+      } else if (path == "/slow") {
+        continue;
+      } else {
+        response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+      }
+
+      if (is_head) {
+        response.resize(response.find("\r\n\r\n") + 4);
+      }
+      ::send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+      if (close) {
+        break;
+      }
+    }
+    ::close(fd);
+  }
+
+  int _fd{-1};
+  std::uint16_t _port{0};
+  std::atomic<std::size_t> _accepted{0};
+  std::thread _thread;
+  std::vector<std::thread> _connections;
+};
+
+auto makeRequest(HttpRequest::Method method, std::string_view path,
+                 std::string_view body = {}) -> HttpRequest {
+  auto request = HttpRequest{};
+  request.setMethod(method);
+  request.setPath(path);
+  request.setBody(body);
+  return request;
+}
+
+/**
+ * @brief Just enough of a coroutine type to co_await a fetch.
+ */
+struct Task {
+  struct promise_type {
+    auto get_return_object() { return Task{}; }
+
+    auto initial_suspend() noexcept { return std::suspend_never{}; }
+
+    auto final_suspend() noexcept { return std::suspend_never{}; }
+
+    auto return_void() -> void {}
+
+    auto unhandled_exception() -> void { std::terminate(); }
+  };
+};
+
+auto fetchTwice(HttpClient& client, std::uint16_t port,
+                std::promise<std::string>& done) -> Task {
+  auto first =
+      co_await client.fetch("127.0.0.1", port, makeRequest(HttpRequest::GET,
+                                                           "/hello"));
+  auto second = co_await client.fetch(
+      "127.0.0.1", port, makeRequest(HttpRequest::GET, "/chunked"));
+  done.set_value(std::string{first.response.body()} + "|" +
+                 std::string{second.response.body()});
+}
+
+}  // namespace
+
+int main() {
+  {
+    // Codings the caller applied to the body are kept, only chunked is the
+    // client's to frame.
+    auto request = makeRequest(HttpRequest::POST, "/upload", "gz");
+    request.addHeader("Transfer-Encoding", "gzip, chunked");
+    assert(HttpClient::serialize(request, "localhost", 80) ==
+           "POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+           "Transfer-Encoding: gzip, chunked\r\n\r\n"
+           "2\r\ngz\r\n0\r\n\r\n");
+    std::cout << "Test passed\n";
+  }
+
+  auto server = TestServer{};
+  const auto port = server.port();
+
+  {
+    // Sequential requests reuse one keep-alive connection.
+    auto client = HttpClient{};
+    for (auto i = 0; i < 5; ++i) {
+      auto result =
+          client.request("127.0.0.1", port,
+                         makeRequest(HttpRequest::GET, "/hello"))
+              .get();
+      assert(result.ok());
+      assert(result.response.statusCode() == fz::http::HttpResponse::OK);
+      assert(result.response.body() == "hello");
+    }
+    assert(server.accepted() == 1);
+
+    auto echo = client.request("127.0.0.1", port,
+                               makeRequest(HttpRequest::POST, "/echo", "ping"))
+                    .get();
+    assert(echo.ok());
+    assert(echo.response.body() == "ping");
+    assert(echo.response.header("X-Host") ==
+           "127.0.0.1:" + std::to_string(port));
+
+    auto chunked =
+        client.request("127.0.0.1", port,
+                       makeRequest(HttpRequest::GET, "/chunked"))
+            .get();
+    assert(chunked.ok());
+    assert(chunked.response.body() == "hello world");
+
+    auto head = client.request("127.0.0.1", port,
+                               makeRequest(HttpRequest::HEAD, "/hello"))
+                    .get();
+    assert(head.ok());
+    assert(head.response.body().empty());
+    assert(head.response.contentLength() == 5);
+
+    // The server closes after this one, the next request reconnects.
+    auto bye = client.request("127.0.0.1", port,
+                              makeRequest(HttpRequest::GET, "/close"))
+                   .get();
+    assert(bye.ok());
+    assert(bye.response.body() == "bye");
+    assert(client.request("127.0.0.1", port,
+                          makeRequest(HttpRequest::GET, "/hello"))
+               .get()
+               .ok());
+    assert(server.accepted() == 2);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Concurrent requests pipelined on a single connection.
+    const auto accepted = server.accepted();
+    auto options = HttpClient::Options{};
+    options.max_connections_per_host = 1;
+    options.pipeline_depth = 4;
+    auto client = HttpClient{options};
+    auto futures = std::vector<std::future<HttpClient::Result>>{};
+    for (auto i = 0; i < 16; ++i) {
+      futures.push_back(client.request(
+          "127.0.0.1", port,
+          makeRequest(HttpRequest::POST, "/echo", std::to_string(i))));
+    }
+    for (auto i = 0; i < 16; ++i) {
+      auto result = futures[i].get();
+      assert(result.ok());
+      assert(result.response.body() == std::to_string(i));
+    }
+    assert(server.accepted() == accepted + 1);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Callbacks and coroutines.
+    auto client = HttpClient{};
+    auto promise = std::promise<std::string>{};
+    client.request("127.0.0.1", port, makeRequest(HttpRequest::GET, "/hello"),
+                   [&promise](HttpClient::Result result) {
+                     promise.set_value(std::string{result.response.body()});
+                   });
+    assert(promise.get_future().get() == "hello");
+
+    auto done = std::promise<std::string>{};
+    fetchTwice(client, port, done);
+    assert(done.get_future().get() == "hello|hello world");
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Streamed request and response bodies.
+    auto client = HttpClient{};
+    auto request = makeRequest(HttpRequest::POST, "/echo");
+    request.addHeader("Content-Length", "10");
+    auto pieces = std::make_shared<std::vector<std::string>>();
+    auto done = std::promise<HttpClient::Result>{};
+    auto body = client.stream(
+        "127.0.0.1", port, request,
+        [pieces](const fz::http::HttpResponse& head) {
+          assert(head.contentLength() == 10);
+          return [pieces](std::string_view data) {
+            pieces->emplace_back(data);
+          };
+        },
+        [&done](HttpClient::Result result) {
+          done.set_value(std::move(result));
+        });
+    assert(body->write("hello"));
+    assert(body->write("world"));
+    body->finish();
+    auto result = done.get_future().get();
+    assert(result.ok());
+    assert(result.response.body().empty());
+    auto echoed = std::string{};
+    for (const auto& piece : *pieces) {
+      echoed += piece;
+    }
+    assert(echoed == "helloworld");
+    assert(pieces->back().empty());
+
+    // Without a consumer the body is discarded, and the connection is
+    // reused afterwards.
+    const auto accepted = server.accepted();
+    auto discarded = std::promise<HttpClient::Result>{};
+    client
+        .stream("127.0.0.1", port, makeRequest(HttpRequest::GET, "/chunked"),
+                nullptr,
+                [&discarded](HttpClient::Result result) {
+                  discarded.set_value(std::move(result));
+                })
+        ->finish();
+    assert(discarded.get_future().get().ok());
+    assert(client.request("127.0.0.1", port,
+                          makeRequest(HttpRequest::GET, "/hello"))
+               .get()
+               .ok());
+    assert(server.accepted() == accepted);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Timeouts, refused connections and shutdown.
+    auto options = HttpClient::Options{};
+    options.request_timeout = 200ms;
+    auto client = HttpClient{options};
+    const auto start = std::chrono::steady_clock::now();
+    auto slow = client.request("127.0.0.1", port,
+                               makeRequest(HttpRequest::GET, "/slow"))
+                    .get();
+    assert(slow.error == HttpClient::Error::Timeout);
+    assert(std::chrono::steady_clock::now() - start < 2s);
+
+    const auto unused = [] {
+      const auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      auto address = sockaddr_in{};
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      auto size = socklen_t{sizeof(address)};
+      ::bind(fd, reinterpret_cast<sockaddr*>(&address), size);
+      ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+      ::close(fd);
+      return ntohs(address.sin_port);
+    }();
+    auto refused = client.request("127.0.0.1", unused,
+                                  makeRequest(HttpRequest::GET, "/hello"))
+                       .get();
+    assert(refused.error == HttpClient::Error::Connect);
+
+    auto unresolved =
+        client.request("invalid.invalid", port,
+                       makeRequest(HttpRequest::GET, "/hello"))
+            .get();
+    assert(unresolved.error == HttpClient::Error::Connect);
+  }
+
+  {
+    auto pending = std::future<HttpClient::Result>{};
+    {
+      auto client = HttpClient{};
+      pending = client.request("127.0.0.1", port,
+                               makeRequest(HttpRequest::GET, "/slow"));
+    }
+    assert(pending.get().error == HttpClient::Error::Shutdown);
+  }
+  std::cout << "Test passed\n";
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "http/http_compression.h"
+
+int main() {
+  using Coding = fz::http::HttpCompression::Coding;
+  using fz::http::HttpCompression;
+  using fz::http::HttpResponse;
+
+  // Negotiation follows q-values, prefers gzip on a tie and honors q=0.
+  if (HttpCompression::available()) {
+    assert(HttpCompression::negotiate("gzip, deflate, sdch") == Coding::Gzip);
+    assert(HttpCompression::negotiate("deflate") == Coding::Deflate);
+    assert(HttpCompression::negotiate("gzip;q=0.5, deflate") ==
+           Coding::Deflate);
+    assert(HttpCompression::negotiate("gzip;q=0, *") == Coding::Deflate);
+    assert(HttpCompression::negotiate("*;q=0.1") == Coding::Gzip);
+    assert(HttpCompression::negotiate("br") == Coding::Identity);
+  }
+  assert(HttpCompression::negotiate("") == Coding::Identity);
+  assert(HttpCompression::negotiate("identity") == Coding::Identity);
+  assert(HttpCompression::compressible("application/json; charset=utf-8"));
+  assert(HttpCompression::compressible("Text/HTML"));
+  assert(!HttpCompression::compressible("image/png"));
+  std::cout << "Test passed\n";
+
+  if (!HttpCompression::available()) {
+    return 0;
+  }
+
+  auto json = std::string{"["};
+  for (auto i = 0; i < 200; ++i) {
+    json += R"({"id":)" + std::to_string(i) + R"(,"name":"user"},)";
+  }
+  json.back() = ']';
+
+  // Bodies over the threshold are compressed once and then served from the
+  // cache, small ones and already encoded ones are left alone.
+  auto compression = HttpCompression{{.min_size = 256}};
+  auto first = HttpResponse::makeOk();
+  first.addHeader("Content-Type", "application/json");
+  first.addHeader("ETag", "\"abc\"");
+  first.setBody(json);
+  compression.apply(Coding::Gzip, first);
+  assert(first.header("Content-Encoding") == "gzip");
+  assert(first.header("Vary") == "Accept-Encoding");
+  assert(first.header("ETag") == "W/\"abc\"");
+  assert(first.body().size() * 5 < json.size());
+  assert(first.body().substr(0, 2) == "\x1f\x8b");
+  assert(first.contentLength() == first.body().size());
+  assert(0 < compression.cachedBytes());
+
+  // A 304 standing in for it gets the same Vary and ETag.
+  auto not_modified = HttpResponse::makeNotModified();
+  not_modified.addHeader("ETag", "\"abc\"");
+  HttpCompression::applyHeaders(Coding::Identity, not_modified);
+  assert(not_modified.header("ETag") == "\"abc\"");
+  assert(not_modified.header("Vary").empty());
+  HttpCompression::applyHeaders(Coding::Gzip, not_modified);
+  assert(not_modified.header("ETag") == first.header("ETag"));
+  assert(not_modified.header("Vary") == first.header("Vary"));
+  assert(not_modified.header("Content-Encoding").empty());
+
+  auto second = HttpResponse::makeOk();
+  second.setBody(json);
+  compression.apply(Coding::Gzip, second);
+  assert(second.body().data() == first.body().data());
+
+  // A hit compares the content, not just a hash of it.
+  auto other_json = json;
+  other_json[1] = '[';
+  auto other = HttpResponse::makeOk();
+  other.setBody(other_json);
+  compression.apply(Coding::Gzip, other);
+  assert(other.body().data() != first.body().data());
+  assert(HttpCompression::compress(Coding::Gzip, other_json) == other.body());
+
+  auto deflate = HttpResponse::makeOk();
+  deflate.setBody(json);
+  compression.apply(Coding::Deflate, deflate);
+  assert(deflate.header("Content-Encoding") == "deflate");
+  assert(deflate.body() != first.body());
+
+  for (auto [type, body] : {std::pair{"application/json", "[]"},
+                            std::pair{"image/png", json.c_str()}}) {
+    auto response = HttpResponse::makeOk();
+    response.addHeader("Content-Type", type);
+    response.setBody(body);
+    compression.apply(Coding::Gzip, response);
+    assert(response.header("Content-Encoding").empty());
+    assert(response.body() == body);
+  }
+  std::cout << "Test passed\n";
+
+  // A chunked body is compressed chunk by chunk, every chunk flushed.
+  auto chunked = HttpResponse::makeOk();
+  chunked.setChunkedBody([row = 0](auto& writer) mutable {
+    writer.write("row," + std::to_string(row) + "\n");
+    if (++row < 3) {
+      return true;
+    }
+    writer.addTrailer("Rows", "3");
+    return false;
+  });
+  compression.apply(Coding::Gzip, chunked);
+  assert(chunked.header("Content-Encoding") == "gzip");
+
+  auto out = std::string{};
+  auto writer = fz::http::HttpChunkedWriter{out};
+  while (chunked.produceBody(writer)) {
+  }
+  writer.finish();
+  assert(out.find("\r\n\x1f\x8b") != std::string::npos);
+  assert(out.ends_with("0\r\nRows: 3\r\n\r\n"));
+  std::cout << "Test passed\n";
+}
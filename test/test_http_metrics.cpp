@@ -0,0 +1,89 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http/http_metrics.h"
+
+int main() {
+  using namespace std::chrono_literals;
+  using fz::http::HttpMetrics;
+
+  // Every latency lands in a bucket whose bound is within 1/8 above it.
+  for (auto value : {std::uint64_t{0}, std::uint64_t{7}, std::uint64_t{8},
+                     std::uint64_t{1000}, std::uint64_t{123'456'789}}) {
+    const auto bound =
+        HttpMetrics::latencyUpperBound(HttpMetrics::latencyBucket(value));
+    assert(value <= bound && bound <= value + value / 8);
+  }
+  for (std::size_t i = 1; i < HttpMetrics::LATENCY_BUCKETS; ++i) {
+    assert(HttpMetrics::latencyBucket(HttpMetrics::latencyUpperBound(i)) == i);
+    assert(HttpMetrics::latencyBucket(HttpMetrics::latencyUpperBound(i - 1) +
+                                      1) == i);
+  }
+  std::cout << "Test passed\n";
+
+  // Updates from several threads are summed when read.
+  auto metrics = HttpMetrics{};
+  auto threads = std::vector<std::thread>{};
+  for (auto t = 0; t < 4; ++t) {
+    threads.emplace_back([&metrics] {
+      metrics.connectionOpened();
+      for (auto i = 1; i <= 1000; ++i) {
+        metrics.bytesReceived(10);
+        metrics.bytesSent(20);
+        metrics.response("/users/:id", 200, std::chrono::microseconds{i});
+      }
+      metrics.response("/users/:id", 404, 1ms);
+      metrics.response({}, 404);
+      metrics.connectionClosed();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  metrics.connectionOpened();
+  metrics.parseError(fz::http::HttpRequestParse::Error::HeadersTooLarge);
+
+  const auto snapshot = metrics.snapshot();
+  assert(snapshot.connections_opened == 5);
+  assert(snapshot.connectionsActive() == 1);
+  assert(snapshot.bytes_received == 40'000);
+  assert(snapshot.bytes_sent == 80'000);
+  assert(snapshot.writes == 4000);
+  assert(snapshot.parse_errors[static_cast<std::size_t>(
+             fz::http::HttpRequestParse::Error::HeadersTooLarge)] == 1);
+
+  const auto& route = snapshot.routes.at("/users/:id");
+  assert(route.statuses.at(200) == 4000);
+  assert(route.statuses.at(404) == 4);
+  assert(route.latency.count == 4004);
+  assert(snapshot.routes.at("").statuses.at(404) == 4);
+  assert(snapshot.routes.at("").latency.count == 0);
+
+  const auto p50 = route.latency.quantile(0.5);
+  assert(500us <= p50 && p50 <= 500us + 500us / 8);
+  assert(route.latency.quantile(1) >= 1ms);
+  assert(route.latency.countAtMost(100ms) == 4004);
+
+  const auto text = metrics.render();
+  assert(text.find("# TYPE fz_http_requests_total counter\n") !=
+         std::string::npos);
+  assert(text.find("fz_http_requests_total{route=\"/users/:id\","
+                   "status=\"200\"} 4000\n") != std::string::npos);
+  assert(text.find("fz_http_requests_total{route=\"\",status=\"404\"} 4\n") !=
+         std::string::npos);
+  assert(text.find("fz_http_request_duration_seconds_bucket{route=\"/users/"
+                   ":id\",le=\"+Inf\"} 4004\n") != std::string::npos);
+  assert(text.find("fz_http_request_duration_seconds_count{route=\"/users/"
+                   ":id\"} 4004\n") != std::string::npos);
+  assert(text.find("fz_http_parse_errors_total{error=\"headers_too_large\"} "
+                   "1\n") != std::string::npos);
+  assert(text.find("fz_http_connections_active 1\n") != std::string::npos);
+  std::cout << "Test passed\n";
+
+  return 0;
+}
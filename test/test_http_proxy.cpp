@@ -0,0 +1,159 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/http_proxy.h"
+
+using fz::http::Arena;
+using fz::http::HttpProxy;
+using fz::http::HttpRequest;
+using fz::http::HttpResponse;
+
+int main() {
+  const auto upstreams = std::vector<HttpProxy::Upstream>{
+      {"10.0.0.1", 8080}, {"10.0.0.2", 80}, {"10.0.0.3", 8080}};
+
+  {
+    // Hop-by-hop headers stay behind, Host is rewritten and the original
+    // one forwarded.
+    auto raw = std::string{
+        "POST /api/items?id=7 HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Connection: keep-alive, X-Secret\r\n"
+        "Keep-Alive: timeout=5\r\n"
+        "X-Secret: 1\r\n"
+        "Proxy-Authorization: Basic abc\r\n"
+        "TE: trailers\r\n"
+        "Expect: 100-continue\r\n"
+        "Content-Length: 3\r\n"
+        "X-Forwarded-For: 192.0.2.1\r\n"
+        "Accept: */*\r\n"
+        "\r\n"
+        "abc"};
+    auto request = HttpRequest{};
+    assert(request.parse(raw));
+
+    auto proxy = HttpProxy{upstreams};
+    auto arena = Arena{};
+    const auto upstream = proxy.upstreamRequest(request, upstreams[0], arena);
+    assert(upstream.method() == HttpRequest::POST);
+    assert(upstream.path() == "/api/items");
+    assert(upstream.target() == "/api/items?id=7");
+    assert(upstream.header("Host") == "10.0.0.1:8080");
+    assert(upstream.header("X-Forwarded-Host") == "example.com");
+    assert(upstream.header("X-Forwarded-Proto") == "http");
+    // Without the client's address its X-Forwarded-For can't be vouched
+    // for, with it the address is appended.
+    assert(upstream.header("X-Forwarded-For").empty());
+    assert(proxy.upstreamRequest(request, upstreams[0], arena, "198.51.100.7")
+               .header("X-Forwarded-For") == "192.0.2.1, 198.51.100.7");
+    assert(upstream.header("Accept") == "*/*");
+    assert(upstream.header("Content-Length") == "3");
+    for (auto name : {"Connection", "Keep-Alive", "X-Secret",
+                      "Proxy-Authorization", "TE", "Expect"}) {
+      assert(upstream.header(name).empty());
+    }
+
+    // Query parameters without '=' aren't in querys(), the target is sent
+    // as received.
+    auto flagged = HttpRequest{};
+    assert(flagged.parse("GET /a?flag&x=1&flag HTTP/1.1\r\n\r\n"));
+    assert(fz::http::HttpClient::serialize(
+               proxy.upstreamRequest(flagged, upstreams[0], arena),
+               "10.0.0.1", 8080)
+               .starts_with("GET /a?flag&x=1&flag HTTP/1.1\r\n"));
+
+    const auto on_port_80 =
+        proxy.upstreamRequest(request, upstreams[1], arena);
+    assert(on_port_80.header("Host") == "10.0.0.2");
+
+    auto options = HttpProxy::Options{};
+    options.preserve_host = true;
+    auto preserving = HttpProxy{upstreams, options};
+    assert(preserving.upstreamRequest(request, upstreams[0], arena)
+               .header("Host") == "example.com");
+  }
+  std::cout << "Test passed\n";
+
+  {
+    auto head = HttpResponse{};
+    head.setVersion(HttpResponse::HTTP_1_0);
+    head.setStatusCode(static_cast<HttpResponse::StatusCode>(299));
+    head.setReason("Upstream Specific");
+    head.addHeader("Connection", "X-Upstream-Only");
+    head.addHeader("X-Upstream-Only", "1");
+    head.addHeader("Keep-Alive", "timeout=5");
+    head.addHeader("Content-Type", "text/plain");
+    head.setContentLength(42);
+
+    const auto response = HttpProxy::downstreamResponse(head);
+    assert(response.version() == HttpResponse::HTTP_1_1);
+    assert(static_cast<int>(response.statusCode()) == 299);
+    assert(response.toString().starts_with(
+        "HTTP/1.1 299 Upstream Specific\r\n"));
+    assert(response.header("Content-Type") == "text/plain");
+    assert(response.hasContentLength());
+    assert(response.contentLength() == 42);
+    for (auto name : {"Connection", "X-Upstream-Only", "Keep-Alive"}) {
+      assert(response.header(name).empty());
+    }
+    assert(!response.closesConnection());
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Every cookie goes downstream on a line of its own.
+    auto parse = fz::http::HttpResponseParse{};
+    auto buffer = fz::net::Buffer{};
+    buffer.append(std::string_view{
+        "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n"
+        "Set-Cookie: a=1; Expires=Wed, 21 Oct 2026 07:28:00 GMT\r\n"
+        "Set-Cookie: b=2\r\n\r\n"});
+    parse.run(buffer);
+    assert(parse.status() == fz::http::HttpResponseParse::Status::OK);
+
+    const auto text =
+        HttpProxy::downstreamResponse(parse.response()).toString();
+    assert(text.find("\r\nSet-Cookie: a=1; Expires=Wed, 21 Oct 2026 "
+                     "07:28:00 GMT\r\nSet-Cookie: b=2\r\n") !=
+           std::string::npos);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Both policies spread idle upstreams evenly.
+    for (auto balance : {HttpProxy::Balance::RoundRobin,
+                         HttpProxy::Balance::LeastConnections}) {
+      auto options = HttpProxy::Options{};
+      options.balance = balance;
+      auto proxy = HttpProxy{upstreams, options};
+      auto counts = std::vector<int>(upstreams.size());
+      for (auto i = 0; i < 30; ++i) {
+        ++counts[proxy.pick()];
+      }
+      for (auto count : counts) {
+        assert(count == 10);
+      }
+    }
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Proxies share one client unless given their own.
+    auto first = HttpProxy{upstreams};
+    auto second = HttpProxy{upstreams};
+    assert(&first.client() == &second.client());
+
+    auto options = HttpProxy::Options{};
+    options.client = std::make_shared<fz::http::HttpClient>();
+    auto own = HttpProxy{upstreams, options};
+    assert(&own.client() == options.client.get());
+    assert(&own.client() != &first.client());
+  }
+  std::cout << "Test passed\n";
+
+  return 0;
+}
@@ -1,10 +1,13 @@
 #include <cassert>
 #include <iostream>
+#include <string>
+#include <utility>
 #include <string_view>
 
 #include "http/http_request_parse.h"
 
 int main() {
+  using namespace std::string_literals;
   using namespace std::string_view_literals;
 
   auto http_request_str =
@@ -48,6 +51,10 @@ int main() {
     assert(http_request.headers().at("Upgrade-Insecure-Requests") == "1");
     assert(http_request.headers().at("Cache-Control") == "max-age=0");
     assert(http_request.body() == "abcdefghigklmnopqrstuvwxyz");
+    assert(http_request.header(fz::http::HttpHeader::Host) == "www.baidu.com");
+    assert(http_request.header("accept-language") == "zh-CN,zh;q=0.8");
+    assert(http_request.header("upgrade-insecure-requests") == "1");
+    assert(http_request.keepAlive());
   };
 
   auto http_request = fz::http::HttpRequest();
@@ -70,4 +77,302 @@ int main() {
   std::cout << http_request_parse.request().toString() << '\n';
   assert_func(http_request_parse.request());
   std::cout << "Test passed\n";
+
+  // Feed the request one byte at a time, followed by the start of another
+  // request which must be left in the buffer.
+  http_request_parse.reset();
+  assert(buffer.empty());
+  auto next_request_str = "GET /next HTTP/1.1\r\n"sv;
+  for (auto c : http_request_str) {
+    buffer.append(&c, 1);
+    http_request_parse.run(buffer);
+  }
+  buffer.append(next_request_str.data(), next_request_str.size());
+  http_request_parse.run(buffer);
+  assert(http_request_parse.status() == fz::http::HttpRequestParse::Status::OK);
+  assert_func(http_request_parse.request());
+  assert(buffer.readableBytes() == next_request_str.size());
+  std::cout << "Test passed\n";
+
+  // Two pipelined requests in a single segment are parsed one after another.
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  buffer.append(http_request_str.data(), http_request_str.size());
+  buffer.append(http_request_str.data(), http_request_str.size());
+  for (auto i = 0; i < 2; ++i) {
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::OK);
+    assert_func(http_request_parse.request());
+    http_request_parse.reset();
+  }
+  assert(buffer.empty());
+  std::cout << "Test passed\n";
+
+  // The parsed request lives in the parser's arena, so it stays valid after
+  // the receive buffer has been reused.
+  http_request_parse.reset();
+  buffer.append(http_request_str.data(), http_request_str.size());
+  http_request_parse.run(buffer);
+  assert(http_request_parse.status() == fz::http::HttpRequestParse::Status::OK);
+  for (auto i = 0; i < 64; ++i) {
+    buffer.append(std::string(http_request_str.size(), 'x'));
+  }
+  assert_func(http_request_parse.request());
+  std::cout << "Test passed\n";
+
+  // Header names are case-insensitive, including Content-Length.
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  buffer.append(
+      "POST /post HTTP/1.1\r\n"
+      "content-length: 5\r\n"
+      "CONNECTION: Keep-Alive\r\n"
+      "\r\n"
+      "hello"sv);
+  http_request_parse.run(buffer);
+  assert(http_request_parse.status() == fz::http::HttpRequestParse::Status::OK);
+  assert(http_request_parse.request().body() == "hello");
+  assert(http_request_parse.request().keepAlive());
+  assert(http_request_parse.request().header("Content-Length") == "5");
+  std::cout << "Test passed\n";
+
+  // Content-Length fields a proxy in front may have read differently are
+  // rejected, the same length repeated is one length.
+  for (auto bad : {"POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                   "Content-Length: 4\r\n\r\nabcd"sv,
+                   "POST / HTTP/1.1\r\nContent-Length: 3, 4\r\n\r\nabcd"sv}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append(bad);
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::INVALID);
+  }
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  buffer.append(
+      "POST / HTTP/1.1\r\nContent-Length: 3\r\ncontent-length: 3, 3\r\n"
+      "\r\nabc"sv);
+  http_request_parse.run(buffer);
+  assert(http_request_parse.status() == fz::http::HttpRequestParse::Status::OK);
+  assert(http_request_parse.request().body() == "abc");
+  std::cout << "Test passed\n";
+
+  // Malformed heads are rejected instead of being half parsed.
+  for (auto bad : {"GET /index HTTP/1.1\r\nBad Name: x\r\n\r\n"sv,
+                   "GET /index HTTP/1.1\r\nNoColon\r\n\r\n"sv,
+                   "GET /in\x01" "dex HTTP/1.1\r\n\r\n"sv,
+                   "GET /index HTTP/2.0\r\n\r\n"sv}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append(bad);
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::INVALID);
+  }
+
+  http_request.clear();
+  assert(http_request.parse("GET /?a=1&flag&b=2 HTTP/1.0\r\nHost:x \r\n\r\n"));
+  assert(http_request.querys().size() == 2);
+  assert(http_request.querys().at("b") == "2");
+  assert(http_request.target() == "/?a=1&flag&b=2");
+  assert(http_request.header(fz::http::HttpHeader::Host) == "x");
+
+  // A single header line may leave out the space after the colon, or the
+  // value altogether.
+  for (auto [line, value] : {std::pair{"Host:x\r\n"sv, "x"sv},
+                             std::pair{"Host: \t x \r\n"sv, "x"sv},
+                             std::pair{"Host:\r\n"sv, ""sv}}) {
+    http_request.clear();
+    assert(http_request.parseOneHeader(line) == line.size());
+    assert(http_request.header(fz::http::HttpHeader::Host) == value);
+  }
+  assert(http_request.parseOneHeader("Bad Name: x\r\n") == std::string::npos);
+  std::cout << "Test passed\n";
+
+  // Chunked bodies are decoded, with extensions and trailers, even when the
+  // request trickles in one byte at a time.
+  constexpr auto chunked_request_str =
+      "POST /upload HTTP/1.1\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "a;name=value\r\n"
+      "abcdefghij\r\n"
+      "10\r\n"
+      "klmnopqrstuvwxyz\r\n"
+      "0\r\n"
+      "Checksum: 42\r\n"
+      "\r\n"sv;
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  for (auto c : chunked_request_str) {
+    buffer.append(&c, 1);
+    http_request_parse.run(buffer);
+  }
+  assert(http_request_parse.status() == fz::http::HttpRequestParse::Status::OK);
+  assert(http_request_parse.request().body() == "abcdefghijklmnopqrstuvwxyz");
+  assert(http_request_parse.request().trailers().at("Checksum") == "42");
+  assert(buffer.empty());
+
+  for (auto bad : {"POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"sv,
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                   "Content-Length: 3\r\n\r\n"sv,
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                   "zz\r\n"sv,
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                   "3\r\nabcX\r\n"sv,
+                   // Framing a proxy may have read differently, and codings
+                   // other than chunked, which aren't ignored.
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                   "Transfer-Encoding: identity\r\n\r\n"sv,
+                   "POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                   "transfer-encoding: chunked\r\n\r\n"sv,
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n"
+                   "\r\n"sv,
+                   "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                   "Transfer-Encoding: chunked\r\n\r\n"sv}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append(bad);
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::INVALID);
+  }
+  std::cout << "Test passed\n";
+
+  // A copy made with copyTo() owns its bytes and outlives the parser.
+  auto arena = fz::http::Arena{};
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  buffer.append(http_request_str.data(), http_request_str.size());
+  http_request_parse.run(buffer);
+  auto copy = http_request_parse.request().copyTo(arena);
+  http_request_parse.reset();
+  assert_func(copy);
+  std::cout << "Test passed\n";
+
+  // Oversized requests are rejected as soon as the size is known, before
+  // the body arrives.
+  using Error = fz::http::HttpRequestParse::Error;
+  http_request_parse.setLimits({.max_headers_size = 64, .max_body_size = 8});
+  for (auto [bad, error] :
+       {std::pair{"GET /" + std::string(5000, 'a'), Error::UriTooLong},
+        std::pair{"GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a'),
+                  Error::HeadersTooLarge},
+        std::pair{"POST / HTTP/1.1\r\nContent-Length: 9\r\n\r\n"s,
+                  Error::BodyTooLarge},
+        std::pair{"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                  "5\r\nabcde\r\n4\r\n"s,
+                  Error::BodyTooLarge},
+        // Only chunked is implemented, other codings aren't ignored.
+        std::pair{"POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n"
+                  "\r\n"s,
+                  Error::NotImplemented},
+        std::pair{"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                  "Transfer-Encoding: chunked\r\n\r\n"s,
+                  Error::BadRequest}}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append(bad);
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::INVALID);
+    assert(http_request_parse.error() == error);
+  }
+
+  // A head right at the limits is accepted whether it arrives at once or
+  // byte by byte, the limits don't depend on how the input is split.
+  const auto at_limits = "GET /" + std::string(4096 - 14, 'a') +
+                         " HTTP/1.1\r\nX-Long: " + std::string(54, 'a') +
+                         "\r\n\r\n";
+  for (auto step : {at_limits.size(), std::size_t{1}}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    for (std::size_t i = 0; i < at_limits.size(); i += step) {
+      buffer.append(std::string_view{at_limits}.substr(i, step));
+      http_request_parse.run(buffer);
+    }
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::OK);
+  }
+  http_request_parse.reset();
+  buffer.retrieve(buffer.readableBytes());
+  buffer.append("GET /" + std::string(4096, 'a') + " HTTP/1.1\r\n\r\n");
+  http_request_parse.run(buffer);
+  assert(http_request_parse.error() == Error::UriTooLong);
+  std::cout << "Test passed\n";
+
+  // A streamed body bypasses the limit and is handed over as it arrives,
+  // and a consumer returning false pauses the parser until resume().
+  for (auto request_str :
+       {"POST /upload HTTP/1.1\r\nContent-Length: 26\r\n\r\n"
+        "abcdefghijklmnopqrstuvwxyz"sv,
+        "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "10\r\nabcdefghijklmnop\r\na\r\nqrstuvwxyz\r\n0\r\n\r\n"sv}) {
+    auto body = std::string{};
+    auto ends = 0;
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    for (auto c : request_str) {
+      buffer.append(&c, 1);
+      http_request_parse.run(buffer, [&](const fz::http::HttpRequest& request) {
+        assert(request.path() == "/upload");
+        http_request_parse.streamBody([&](std::string_view data) {
+          ends += data.empty() ? 1 : 0;
+          body.append(data);
+          return body.size() != 20;
+        });
+      });
+
+      if (http_request_parse.paused()) {
+        assert(body.size() == 20);
+        http_request_parse.resume();
+        http_request_parse.run(buffer);
+      }
+    }
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::OK);
+    assert(body == "abcdefghijklmnopqrstuvwxyz");
+    assert(ends == 1);
+    assert(http_request_parse.request().body().empty());
+    assert(buffer.empty());
+  }
+
+  // Without a body the consumer only sees its end.
+  {
+    auto ends = 0;
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append("GET /download HTTP/1.1\r\n\r\n"sv);
+    http_request_parse.run(buffer, [&](const fz::http::HttpRequest&) {
+      http_request_parse.streamBody([&](std::string_view data) {
+        assert(data.empty());
+        ++ends;
+        return true;
+      });
+    });
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::OK);
+    assert(ends == 1);
+  }
+  std::cout << "Test passed\n";
+
+  // Persistence defaults differ between HTTP/1.0 and HTTP/1.1.
+  for (auto [request_str, keep_alive] :
+       {std::pair{"GET / HTTP/1.1\r\n\r\n"sv, true},
+        std::pair{"GET / HTTP/1.1\r\nConnection: Upgrade, close\r\n\r\n"sv,
+                  false},
+        std::pair{"GET / HTTP/1.0\r\n\r\n"sv, false},
+        std::pair{"GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n"sv,
+                  true}}) {
+    http_request_parse.reset();
+    buffer.retrieve(buffer.readableBytes());
+    buffer.append(request_str);
+    http_request_parse.run(buffer);
+    assert(http_request_parse.status() ==
+           fz::http::HttpRequestParse::Status::OK);
+    assert(http_request_parse.request().keepAlive() == keep_alive);
+  }
+  std::cout << "Test passed\n";
 }
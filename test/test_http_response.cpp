@@ -0,0 +1,119 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "http/http_response.h"
+#include "net/common/buffer.h"
+
+int main() {
+  using namespace std::string_view_literals;
+  using fz::http::HttpResponse;
+
+  auto response = HttpResponse::makeOk();
+  response.addHeader("Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+  response.addHeader("Content-Type", "text/plain");
+  response.addHeader("content-type", "text/html");
+  response.addHeader("Content-Length", "3");  // derived from the body instead
+  response.setBody("hello world");
+
+  constexpr auto expected =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 11\r\n"
+      "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+      "Content-Type: text/html\r\n"
+      "\r\n"
+      "hello world"sv;
+
+  std::cout << response.toString() << "\n";
+  assert(response.toString() == expected);
+
+  auto buffer = fz::net::Buffer{};
+  response.serialize(buffer);
+  assert(std::string_view(buffer.peek(), buffer.readableBytes()) == expected);
+
+  assert(HttpResponse::statusLine(HttpResponse::HTTP_1_0,
+                                  HttpResponse::NOT_FOUND) ==
+         "HTTP/1.0 404 Not Found\r\n");
+
+  // Status codes without a cached line are formatted on the fly.
+  auto teapot = HttpResponse{};
+  teapot.setVersion(HttpResponse::HTTP_1_1);
+  teapot.setStatusCode(static_cast<HttpResponse::StatusCode>(418));
+  teapot.addHeader("Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+  assert(teapot.toString() ==
+         "HTTP/1.1 418 Unknow\r\n"
+         "Content-Length: 0\r\n"
+         "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+         "\r\n");
+
+  // A reason set on the response replaces the standard phrase.
+  teapot.setReason("I'm a teapot");
+  assert(teapot.toString().starts_with("HTTP/1.1 418 I'm a teapot\r\n"));
+  teapot.setStatusCode(HttpResponse::OK);
+  assert(teapot.toString().starts_with("HTTP/1.1 200 I'm a teapot\r\n"));
+  teapot.setReason({});
+  assert(teapot.toString().starts_with("HTTP/1.1 200 OK\r\n"));
+
+  // Date and Server are filled in when the response doesn't set them.
+  auto hello = HttpResponse::makeOk();
+  hello.setBody("hi");
+  auto hello_str = hello.toString();
+  assert(hello_str.find("Content-Length: 2\r\n") != std::string::npos);
+  assert(hello_str.find("Date: " + std::string{fz::http::HttpDate::now()}) !=
+         std::string::npos);
+  hello_str.clear();
+  hello.serialize(hello_str, "fz");
+  assert(hello_str.find("Server: fz\r\n") != std::string::npos);
+
+  auto date = fz::http::HttpDate::Buffer{};
+  assert(fz::http::HttpDate::format(784111777, date) ==
+         "Sun, 06 Nov 1994 08:49:37 GMT");
+
+  std::cout << "Test passed\n";
+
+  // A chunked response writes its head, then the body chunk by chunk.
+  auto report = HttpResponse::makeOk();
+  report.addHeader("Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+  report.setChunkedBody(
+      [rows = 0](fz::http::HttpChunkedWriter& writer) mutable {
+        writer.write("row " + std::to_string(rows) + "\n");
+        if (++rows < 2) {
+          return true;
+        }
+        writer.addTrailer("Rows", "2");
+        return false;
+      });
+  auto report_str = std::string{};
+  report.serialize(report_str);
+  auto writer = fz::http::HttpChunkedWriter{report_str};
+  while (report.produceBody(writer)) {
+  }
+  writer.finish();
+  assert(report_str ==
+         "HTTP/1.1 200 OK\r\n"
+         "Transfer-Encoding: chunked\r\n"
+         "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+         "\r\n"
+         "6\r\nrow 0\n\r\n"
+         "6\r\nrow 1\n\r\n"
+         "0\r\nRows: 2\r\n\r\n");
+
+  // The answer to HEAD keeps the framing headers and drops the body.
+  auto head = HttpResponse::makeOk();
+  head.addHeader("Date", "Sun, 06 Nov 1994 08:49:37 GMT");
+  head.setBody("hello");
+  head.omitBody();
+  assert(head.bodyOmitted());
+  assert(head.toString() ==
+         "HTTP/1.1 200 OK\r\n"
+         "Content-Length: 5\r\n"
+         "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+         "\r\n");
+  report.omitBody();
+  assert(report.toString().find("Transfer-Encoding: chunked\r\n") !=
+         std::string::npos);
+  assert(report.toString().ends_with("\r\n\r\n"));
+
+  std::cout << "Test passed\n";
+}
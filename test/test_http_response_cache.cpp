@@ -0,0 +1,136 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "http/http_request_parse.h"
+#include "http/http_response.h"
+#include "http/http_response_cache.h"
+
+int main() {
+  using namespace std::chrono_literals;
+  using fz::http::HttpResponse;
+  using fz::http::HttpResponseCache;
+
+  auto key_of = [](std::string_view raw,
+                   const HttpResponseCache::Policy& policy,
+                   std::string_view extra = {}) {
+    auto parse = fz::http::HttpRequestParse{};
+    auto buffer = fz::net::Buffer();
+    buffer.append(raw.data(), raw.size());
+    parse.run(buffer);
+    assert(parse.status() == fz::http::HttpRequestParse::Status::OK);
+    return HttpResponseCache::makeKey(parse.request(), policy, extra);
+  };
+
+  // Only the listed query parameters and headers tell requests apart.
+  auto policy = HttpResponseCache::Policy{};
+  policy.query = {"page"};
+  policy.headers = {"Accept-Language"};
+
+  const auto base = key_of(
+      "GET /list?page=2&utm=a HTTP/1.1\r\nAccept-Language: en\r\n\r\n", policy);
+  assert(base == key_of("GET /list?utm=b&page=2 HTTP/1.1\r\n"
+                        "Accept-Language: en\r\nUser-Agent: x\r\n\r\n",
+                        policy));
+  assert(base != key_of("GET /list?page=3 HTTP/1.1\r\n"
+                        "Accept-Language: en\r\n\r\n",
+                        policy));
+  assert(base != key_of("GET /list?page=2 HTTP/1.1\r\n"
+                        "Accept-Language: de\r\n\r\n",
+                        policy));
+  assert(base != key_of("GET /list?page=2 HTTP/1.1\r\n"
+                        "Accept-Language: en\r\n\r\n",
+                        policy, "gzip"));
+  assert(key_of("GET /list HTTP/1.1\r\n\r\n", policy) !=
+         key_of("GET /list?page= HTTP/1.1\r\n\r\n", policy));
+  std::cout << "Test passed\n";
+
+  // Only complete, shareable 200s are stored.
+  auto response = HttpResponse::makeOk();
+  response.setBody("hello");
+  assert(HttpResponseCache::cacheable(response));
+
+  auto not_found = HttpResponse::makeNotFound();
+  assert(!HttpResponseCache::cacheable(not_found));
+
+  auto cookie = HttpResponse::makeOk();
+  cookie.addHeader("Set-Cookie", "id=1");
+  assert(!HttpResponseCache::cacheable(cookie));
+
+  auto no_store = HttpResponse::makeOk();
+  no_store.addHeader("Cache-Control", "no-store");
+  assert(!HttpResponseCache::cacheable(no_store));
+
+  auto closing = HttpResponse::makeOk();
+  closing.addHeader("Connection", "close");
+  assert(!HttpResponseCache::cacheable(closing));
+
+  auto chunked = HttpResponse::makeOk();
+  chunked.setChunkedBody([](auto&) { return false; });
+  assert(!HttpResponseCache::cacheable(chunked));
+  std::cout << "Test passed\n";
+
+  // Entries expire after their TTL.
+  auto cache = HttpResponseCache{};
+  auto bytes = std::make_shared<const std::string>("HTTP/1.1 200 OK\r\n\r\n");
+  cache.insert("a", bytes, 1h);
+  cache.insert("b", bytes, 0ms);
+  assert(cache.find("a") == bytes);
+  assert(cache.find("b") == nullptr);
+  assert(cache.find("c") == nullptr);
+  assert(cache.size() == 1);
+
+  // Inserting a key again replaces its entry.
+  auto other = std::make_shared<const std::string>("HTTP/1.1 200 OK\r\n\r\n!");
+  cache.insert("a", other, 1h);
+  assert(cache.find("a") == other);
+  assert(cache.size() == 1);
+  std::cout << "Test passed\n";
+
+  // Over the memory cap, the least recently used entries go first.
+  auto small = HttpResponseCache{{.max_bytes = 4096, .shards = 1}};
+  auto body = std::make_shared<const std::string>(1000, 'x');
+  small.insert("1", body, 1h);
+  small.insert("2", body, 1h);
+  small.insert("3", body, 1h);
+  assert(small.find("1") != nullptr);
+  small.insert("4", body, 1h);
+  assert(small.find("1") != nullptr);
+  assert(small.find("2") == nullptr);
+  assert(small.find("4") != nullptr);
+  assert(small.bytes() <= 4096);
+
+  // Entries larger than a shard are never stored.
+  small.insert("big", std::make_shared<const std::string>(5000, 'x'), 1h);
+  assert(small.find("big") == nullptr);
+  std::cout << "Test passed\n";
+
+  // Per-thread shards: every thread only sees what it inserted itself.
+  auto per_thread = HttpResponseCache{
+      {.max_bytes = 1 << 20, .shards = 2, .per_thread = true}};
+  per_thread.insert("a", body, 1h);
+  assert(per_thread.find("a") == body);
+  std::thread{[&per_thread, &body] {
+    assert(per_thread.find("a") == nullptr);
+    per_thread.insert("a", body, 1h);
+    per_thread.insert("b", body, 1h);
+    assert(per_thread.find("b") == body);
+  }}.join();
+  assert(per_thread.find("b") == nullptr);
+  assert(per_thread.size() == 3);
+
+  // An offloaded response is sent from a pool thread, into the shard the
+  // loop took when it handed the request over.
+  const auto loop_shard = per_thread.shardOf("offloaded");
+  std::thread{[&per_thread, &body, loop_shard] {
+    per_thread.insert(loop_shard, "offloaded", body, 1h);
+  }}.join();
+  assert(per_thread.find("offloaded") == body);
+  std::cout << "Test passed\n";
+
+  return 0;
+}
@@ -0,0 +1,239 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "http/http_response_parse.h"
+
+using fz::http::HttpResponse;
+using fz::http::HttpResponseParse;
+
+namespace {
+
+auto parseAll(HttpResponseParse& parse, std::string_view raw)
+    -> HttpResponseParse::Status {
+  auto buffer = fz::net::Buffer();
+  buffer.append(raw.data(), raw.size());
+  parse.run(buffer);
+  return parse.status();
+}
+
+/**
+ * @brief Feed raw one byte at a time, as a slow server would send it.
+ */
+auto parseBytewise(HttpResponseParse& parse, std::string_view raw)
+    -> HttpResponseParse::Status {
+  auto buffer = fz::net::Buffer();
+  for (auto c : raw) {
+    buffer.append(&c, 1);
+    parse.run(buffer);
+  }
+  return parse.status();
+}
+
+}  // namespace
+
+int main() {
+  {
+    // Content-Length framed, repeated headers joined.
+    const auto raw = std::string_view{
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nVary: Accept\r\n"
+        "Vary: Accept-Encoding\r\n\r\nhello"};
+    for (auto bytewise : {false, true}) {
+      auto parse = HttpResponseParse{};
+      const auto status =
+          bytewise ? parseBytewise(parse, raw) : parseAll(parse, raw);
+      assert(status == HttpResponseParse::Status::OK);
+      assert(parse.response().statusCode() == HttpResponse::OK);
+      assert(parse.response().version() == HttpResponse::HTTP_1_1);
+      assert(parse.response().body() == "hello");
+      assert(parse.response().header("Vary") == "Accept, Accept-Encoding");
+    }
+  }
+
+  {
+    // Set-Cookie can't be joined, a cookie's Expires has a comma.
+    auto parse = HttpResponseParse{};
+    assert(parseAll(parse, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n"
+                           "Set-Cookie: a=1; Expires=Wed, 21 Oct 2026 "
+                           "07:28:00 GMT\r\nset-cookie: b=2\r\n\r\n") ==
+           HttpResponseParse::Status::OK);
+    const auto& headers = parse.response().headers();
+    assert(headers.size() == 2);
+    assert(headers[0].second == "a=1; Expires=Wed, 21 Oct 2026 07:28:00 GMT");
+    assert(headers[1].second == "b=2");
+  }
+
+  {
+    // Chunked with extensions and trailers, then the next pipelined
+    // response is left in the buffer.
+    const auto raw = std::string_view{
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nX-Checksum: 1\r\n\r\n"
+        "HTTP/1.1 204 No Content\r\n\r\n"};
+    auto parse = HttpResponseParse{};
+    auto buffer = fz::net::Buffer();
+    buffer.append(raw.data(), raw.size());
+    parse.run(buffer);
+    assert(parse.status() == HttpResponseParse::Status::OK);
+    assert(parse.response().body() == "hello world");
+    assert(parse.response().header("X-Checksum") == "1");
+
+    parse.reset();
+    parse.run(buffer);
+    assert(parse.status() == HttpResponseParse::Status::OK);
+    assert(parse.response().statusCode() ==
+           static_cast<HttpResponse::StatusCode>(204));
+    assert(buffer.readableBytes() == 0);
+
+    auto bytewise = HttpResponseParse{};
+    assert(parseBytewise(bytewise, raw.substr(0, raw.find("HTTP/1.1 204"))) ==
+           HttpResponseParse::Status::OK);
+    assert(bytewise.response().body() == "hello world");
+  }
+
+  {
+    // No framing, the body runs until the connection closes.
+    auto parse = HttpResponseParse{};
+    assert(parseAll(parse, "HTTP/1.0 200 OK\r\n\r\nuntil close") ==
+           HttpResponseParse::Status::BodyUntilClose);
+    parse.finish();
+    assert(parse.status() == HttpResponseParse::Status::OK);
+    assert(parse.response().version() == HttpResponse::HTTP_1_0);
+    assert(parse.response().body() == "until close");
+
+    auto cut = HttpResponseParse{};
+    assert(parseAll(cut, "HTTP/1.1 200 OK\r\nContent-Length: 9\r\n\r\nhi") ==
+           HttpResponseParse::Status::Body);
+    cut.finish();
+    assert(cut.status() == HttpResponseParse::Status::INVALID);
+  }
+
+  {
+    // HEAD and 304 responses have no body whatever their headers say.
+    auto head = HttpResponseParse{};
+    head.expectNoBody();
+    assert(parseAll(head, "HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n") ==
+           HttpResponseParse::Status::OK);
+    assert(head.response().body().empty());
+    assert(head.response().contentLength() == 100);
+
+    auto not_modified = HttpResponseParse{};
+    assert(parseAll(not_modified, "HTTP/1.1 304 Not Modified\r\n"
+                                  "Content-Length: 100\r\n\r\n") ==
+           HttpResponseParse::Status::OK);
+  }
+
+  {
+    // Interim responses are skipped.
+    auto parse = HttpResponseParse{};
+    assert(parseAll(parse, "HTTP/1.1 100 Continue\r\n\r\n"
+                           "HTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\n"
+                           "ok") == HttpResponseParse::Status::OK);
+    assert(parse.response().statusCode() == HttpResponse::CREATED);
+    assert(parse.response().reason().empty());
+    assert(parse.response().body() == "ok");
+  }
+
+  {
+    // A reason other than the standard one is kept.
+    auto parse = HttpResponseParse{};
+    assert(parseAll(parse, "HTTP/1.1 299 Custom Thing\r\n"
+                           "Content-Length: 0\r\n\r\n") ==
+           HttpResponseParse::Status::OK);
+    assert(parse.response().reason() == "Custom Thing");
+  }
+
+  {
+    // A streamed body is handed over piece by piece, then ended with an
+    // empty view, whatever its framing and however it arrives.
+    for (auto raw : {
+             std::string_view{"HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\n"
+                              "hello world"},
+             std::string_view{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked"
+                              "\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n"},
+             std::string_view{"HTTP/1.0 200 OK\r\n\r\nhello world"},
+         }) {
+      for (auto bytewise : {false, true}) {
+        auto parse = HttpResponseParse{};
+        parse.setLimits({.max_headers_size = 1024, .max_body_size = 4});
+        auto body = std::string{};
+        auto ends = 0;
+        auto buffer = fz::net::Buffer();
+        const auto run = [&] {
+          parse.run(buffer, [&](const HttpResponse& head) {
+            assert(head.statusCode() == HttpResponse::OK);
+            parse.streamBody([&](std::string_view data) {
+              ends += data.empty() ? 1 : 0;
+              body.append(data);
+            });
+          });
+        };
+        if (bytewise) {
+          for (auto c : raw) {
+            buffer.append(&c, 1);
+            run();
+          }
+        } else {
+          buffer.append(raw.data(), raw.size());
+          run();
+        }
+        if (parse.status() == HttpResponseParse::Status::BodyUntilClose) {
+          parse.finish();
+        }
+        assert(parse.status() == HttpResponseParse::Status::OK);
+        assert(body == "hello world");
+        assert(ends == 1);
+        assert(parse.response().body().empty());
+      }
+    }
+
+    // The declared length is kept on the head.
+    auto parse = HttpResponseParse{};
+    auto buffer = fz::net::Buffer();
+    const auto raw = std::string_view{
+        "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\nhello"};
+    buffer.append(raw.data(), raw.size());
+    parse.run(buffer, [&](const HttpResponse& head) {
+      assert(head.hasContentLength());
+      assert(head.contentLength() == 11);
+      parse.streamBody([](std::string_view) {});
+    });
+    assert(parse.status() == HttpResponseParse::Status::Body);
+  }
+
+  for (auto raw : {
+           "HTTP/2 200 OK\r\n\r\n",
+           "HTTP/1.1 20 OK\r\n\r\n",
+           "HTTP/1.1 2000 OK\r\n\r\n",
+           "HTTP/1.1 600 Nope\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nNo colon\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nBad Name: x\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nContent-Length: 99999999999999999999\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n"
+           "Content-Length: 1\r\n\r\n",
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+           "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab",
+       }) {
+    auto parse = HttpResponseParse{};
+    assert(parseAll(parse, raw) == HttpResponseParse::Status::INVALID);
+  }
+
+  {
+    // Limits.
+    auto parse = HttpResponseParse{};
+    parse.setLimits({.max_headers_size = 1024, .max_body_size = 4});
+    assert(parseAll(parse, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n") ==
+           HttpResponseParse::Status::INVALID);
+
+    parse.reset();
+    assert(parseAll(parse, "HTTP/1.1 200 OK\r\nX: " + std::string(2048, 'x') +
+                               "\r\n\r\n") ==
+           HttpResponseParse::Status::INVALID);
+  }
+
+  std::cout << "Test passed\n";
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "http/http_router.h"
+
+int main() {
+  using fz::http::HttpRequest;
+  using fz::http::HttpResponse;
+  using fz::http::HttpRouter;
+
+  auto make_handler = [](std::string_view body) {
+    return [body = std::string{body}](const HttpRequest&) {
+      auto response = HttpResponse::makeOk();
+      response.setBody(body);
+      return response;
+    };
+  };
+
+  auto router = HttpRouter{};
+  router.add(HttpRequest::GET, "/", make_handler("root"));
+  router.add(HttpRequest::GET, "/users", make_handler("users"));
+  router.add(HttpRequest::POST, "/users", make_handler("create user"));
+  router.add(HttpRequest::GET, "/users/me", make_handler("me"));
+  router.add(HttpRequest::GET, "/users/:id", make_handler("user"));
+  router.add(HttpRequest::DELETE, "/users/:id", make_handler("delete user"));
+  router.add(HttpRequest::GET, "/users/:id/posts/:post", make_handler("post"));
+  router.add(HttpRequest::GET, "/uploads", make_handler("uploads"));
+  router.add(HttpRequest::GET, "/static/*file", make_handler("static"));
+  router.add(HttpRequest::INVALID, "/any", make_handler("any"));
+
+  auto call = [&](HttpRequest::Method method, std::string_view path,
+                  fz::http::HttpFields& params) -> std::string {
+    auto match = router.match(method, path, params);
+    if (match.handler == nullptr) {
+      return match.allowed == 0 ? "404"
+                                : "405 " + HttpRouter::allowToString(
+                                               match.allowed);
+    }
+    auto request = HttpRequest{};
+    return std::string{(*match.handler)(request).body()};
+  };
+
+  auto params = fz::http::HttpFields{};
+  assert(call(HttpRequest::GET, "/", params) == "root");
+  assert(call(HttpRequest::GET, "/users", params) == "users");
+  assert(call(HttpRequest::POST, "/users", params) == "create user");
+  assert(call(HttpRequest::GET, "/uploads", params) == "uploads");
+  assert(call(HttpRequest::GET, "/users/me", params) == "me");
+  assert(params.empty());
+
+  assert(call(HttpRequest::GET, "/users/42", params) == "user");
+  assert(params.size() == 1 && params.at("id") == "42");
+
+  params.clear();
+  assert(call(HttpRequest::GET, "/users/42/posts/7", params) == "post");
+  assert(params.size() == 2 && params.at("id") == "42" &&
+         params.at("post") == "7");
+
+  params.clear();
+  assert(call(HttpRequest::GET, "/static/css/site.css", params) == "static");
+  assert(params.at("file") == "css/site.css");
+
+  params.clear();
+  assert(call(HttpRequest::PUT, "/users/42", params) ==
+         "405 GET, DELETE, HEAD");
+  assert(call(HttpRequest::HEAD, "/users/42", params) == "user");
+  assert(call(HttpRequest::GET, "/user", params) == "404");
+  assert(call(HttpRequest::GET, "/users/42/posts", params) == "404");
+  assert(call(HttpRequest::PUT, "/any", params) == "any");
+
+  // The pattern of the matched route labels metrics.
+  params.clear();
+  assert(router.match(HttpRequest::GET, "/users/42/posts/7", params).pattern ==
+         "/users/:id/posts/:post");
+  assert(router.match(HttpRequest::PUT, "/users/42", params).pattern ==
+         "/users/:id");
+  assert(router.match(HttpRequest::GET, "/user", params).pattern.empty());
+
+  auto throws = [&](std::string_view pattern) {
+    try {
+      router.add(HttpRequest::GET, pattern, make_handler(""));
+    } catch (const std::invalid_argument&) {
+      return true;
+    }
+    return false;
+  };
+  assert(throws("users"));
+  assert(throws("/users/:name"));
+  assert(throws("/files/*path/more"));
+  assert(throws("/users/x:id"));
+
+  std::cout << "Test passed\n";
+}
@@ -0,0 +1,72 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "http/http_scan.h"
+
+int main() {
+  using fz::http::HttpScanner;
+
+  auto check_kernels = [](std::string_view data) {
+    auto expected = HttpScanner::Positions{};
+    const auto expected_valid =
+        HttpScanner::scan(HttpScanner::Kernel::Scalar, data, expected);
+
+    for (auto kernel :
+         {HttpScanner::Kernel::SSE42, HttpScanner::Kernel::AVX2}) {
+      if (!HttpScanner::supported(kernel)) {
+        continue;
+      }
+
+      auto positions = HttpScanner::Positions{};
+      const auto valid = HttpScanner::scan(kernel, data, positions);
+      assert(valid == expected_valid);
+      assert(positions == expected);
+    }
+
+    return expected_valid;
+  };
+
+  std::cout << "Selected kernel: "
+            << HttpScanner::kernelToString(HttpScanner::kernel()) << "\n";
+
+  auto header_block = std::string{
+      "GET /index?name=hello&password=123456 HTTP/1.1\r\n"
+      "Host: www.baidu.com\r\n"
+      "Accept-Encoding: gzip, deflate, sdch\r\n"
+      "Connection: keep-alive\r\n"};
+  assert(check_kernels(header_block));
+
+  auto positions = HttpScanner::Positions{};
+  HttpScanner::scan("GET /a?b=c&d HTTP/1.1\r\n", positions);
+  assert((positions == HttpScanner::Positions{3, 6, 8, 10, 12, 21, 22}));
+
+  assert(!check_kernels(std::string(40, 'a') + '\0' + "b"));
+  assert(!check_kernels(std::string(70, 'a') + '\x7f'));
+  assert(check_kernels(std::string(70, 'a') + "\t\x80\xff"));
+
+  // Random input over an alphabet biased towards structural and control
+  // characters, at every length around the vector widths.
+  auto engine = std::mt19937{42};
+  constexpr auto alphabet =
+      std::string_view{"ab\r\n :?=&\t\x01\x7f\x80\xff", 15};
+  auto pick =
+      std::uniform_int_distribution<std::size_t>{0, alphabet.size() - 1};
+  for (std::size_t size = 0; size < 200; ++size) {
+    for (auto round = 0; round < 20; ++round) {
+      auto data = std::string(size, '\0');
+      for (auto& c : data) {
+        c = alphabet[pick(engine)];
+      }
+      check_kernels(data);
+    }
+  }
+
+  assert(fz::http::isToken("Content-Length"));
+  assert(!fz::http::isToken("Content Length"));
+  assert(!fz::http::isToken(""));
+
+  std::cout << "Test passed\n";
+}
@@ -0,0 +1,222 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "http/http_server.h"
+
+using namespace std::chrono_literals;
+using fz::http::HttpHandler;
+using fz::http::HttpRequest;
+using fz::http::HttpResponder;
+using fz::http::HttpResponse;
+using fz::http::HttpServer;
+
+namespace {
+
+auto unusedPort() -> std::uint16_t {
+  const auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  auto address = sockaddr_in{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  auto size = socklen_t{sizeof(address)};
+  ::bind(fd, reinterpret_cast<sockaddr*>(&address), size);
+  ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &size);
+  ::close(fd);
+  return ntohs(address.sin_port);
+}
+
+/**
+ * @brief Blocking connection to the server under test, retried while the
+ * listener comes up.
+ */
+class Connection {
+ public:
+  explicit Connection(std::uint16_t port) {
+    auto address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    for (auto attempt = 0; attempt < 100; ++attempt) {
+      _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      if (::connect(_fd, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address)) == 0) {
+        break;
+      }
+      ::close(_fd);
+      _fd = -1;
+      std::this_thread::sleep_for(10ms);
+    }
+    assert(_fd != -1);
+    const auto timeout = timeval{5, 0};
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  }
+
+  ~Connection() { ::close(_fd); }
+
+  Connection(const Connection&) = delete;
+
+  auto operator=(const Connection&) -> Connection& = delete;
+
+  auto send(std::string_view data) -> void {
+    [[maybe_unused]] const auto n =
+        ::send(_fd, data.data(), data.size(), MSG_NOSIGNAL);
+    assert(n == static_cast<ssize_t>(data.size()));
+  }
+
+  /**
+   * @brief Everything the server sends until it closes the connection.
+   */
+  auto readAll() -> std::string {
+    auto result = std::string{};
+    auto data = std::array<char, 4096>{};
+    while (true) {
+      const auto n = ::read(_fd, data.data(), data.size());
+      if (n <= 0) {
+        return result;
+      }
+      result.append(data.data(), static_cast<std::size_t>(n));
+    }
+  }
+
+ private:
+  int _fd{-1};
+};
+
+}  // namespace
+
+int main() {
+  {
+    // An error behind a request answered later goes out after its answer,
+    // and the connection closes once both are written.
+    const auto port = unusedPort();
+    auto server = HttpServer{1, "127.0.0.1", port};
+    auto answered = std::thread{};
+    server.registerHandler(
+        HttpRequest::GET, "/later",
+        [&answered](const HttpRequest&, HttpResponder responder) {
+          answered = std::thread{[responder = std::move(responder)]() mutable {
+            std::this_thread::sleep_for(50ms);
+            auto response = HttpResponse::makeOk();
+            response.setBody("later");
+            responder.send(std::move(response));
+          }};
+        });
+    server.start();
+
+    auto connection = Connection{port};
+    connection.send(
+        "GET /later HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET / HTTP/1.1\r\nContent-Length: x\r\n\r\n");
+    const auto output = connection.readAll();
+    answered.join();
+    server.stop();
+
+    const auto ok = output.find("HTTP/1.1 200 OK\r\n");
+    const auto bad = output.find("HTTP/1.1 400 Bad Request\r\n");
+    assert(ok == 0);
+    assert(output.find("later", ok) < bad);
+    assert(bad != std::string::npos);
+    assert(output.find("Connection: close\r\n", bad) != std::string::npos);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // Offloaded requests still queued when the server goes are answered
+    // while the compression and the cache their responders use are there.
+    const auto port = unusedPort();
+    auto server = std::make_unique<HttpServer>(1, "127.0.0.1", port);
+    server->setOffloadThreads(1);
+    server->enableCompression();
+    auto started = std::atomic<int>{0};
+    server->registerHandler(
+        HttpRequest::GET, "/slow",
+        HttpHandler::cached(
+            HttpHandler::offload([&started](const HttpRequest&) {
+              ++started;
+              std::this_thread::sleep_for(50ms);
+              auto response = HttpResponse::makeOk();
+              response.addHeader("Content-Type", "text/plain");
+              response.setBody(std::string(4096, 'x'));
+              return response;
+            }),
+            {}));
+    server->start();
+
+    auto connections = std::vector<std::unique_ptr<Connection>>{};
+    for (auto i = 0; i < 3; ++i) {
+      connections.push_back(std::make_unique<Connection>(port));
+      connections.back()->send(
+          "GET /slow HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip\r\n\r\n");
+    }
+    // The first one runs, the others wait in the pool's queue.
+    while (started == 0) {
+      std::this_thread::sleep_for(1ms);
+    }
+    std::this_thread::sleep_for(20ms);
+    server.reset();
+    assert(started == 3);
+  }
+  std::cout << "Test passed\n";
+
+  {
+    // An early 304 carries the Vary and ETag the compressed 200 had.
+    if (!fz::http::HttpCompression::available()) {
+      return 0;
+    }
+    const auto port = unusedPort();
+    auto server = HttpServer{1, "127.0.0.1", port};
+    server.enableCompression();
+    server.registerHandler(
+        HttpRequest::GET, "/doc",
+        HttpHandler::conditional(
+            [](const HttpRequest&) {
+              auto response = HttpResponse::makeOk();
+              response.addHeader("Content-Type", "text/plain");
+              response.setBody(std::string(1024, 'x'));
+              return response;
+            },
+            [](const HttpRequest&) {
+              return fz::http::HttpValidators{"\"v1\"", {}};
+            }));
+    server.start();
+
+    auto get = [port](std::string_view headers) {
+      auto connection = Connection{port};
+      auto raw = std::string{"GET /doc HTTP/1.1\r\nHost: x\r\n"
+                             "Accept-Encoding: gzip\r\n"
+                             "Connection: close\r\n"};
+      raw += headers;
+      raw += "\r\n";
+      connection.send(raw);
+      auto output = connection.readAll();
+      return output.substr(0, output.find("\r\n\r\n") + 2);
+    };
+    const auto ok = get({});
+    const auto not_modified = get("If-None-Match: W/\"v1\"\r\n");
+    server.stop();
+
+    assert(ok.starts_with("HTTP/1.1 200 OK\r\n"));
+    assert(not_modified.starts_with("HTTP/1.1 304 Not Modified\r\n"));
+    for (auto header : {"\r\nETag: W/\"v1\"\r\n",
+                        "\r\nVary: Accept-Encoding\r\n"}) {
+      assert(ok.find(header) != std::string::npos);
+      assert(not_modified.find(header) != std::string::npos);
+    }
+  }
+  std::cout << "Test passed\n";
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "http/http_static_files.h"
+
+int main() {
+  using fz::http::HttpRequest;
+  using fz::http::HttpResponse;
+
+  const auto root =
+      std::filesystem::temp_directory_path() / "fz_http_test_static_files";
+  std::filesystem::remove_all(root);
+  std::filesystem::create_directories(root / "css");
+  auto write_file = [](const std::filesystem::path& path,
+                       std::string_view content) {
+    auto ofs = std::ofstream(path, std::ios::out | std::ios::binary);
+    ofs << content;
+  };
+  write_file(root / "index.html", "<html>home</html>");
+  write_file(root / "css" / "site.css", "0123456789");
+
+  auto files = fz::http::HttpStaticFiles{root};
+
+  auto serve = [&](std::string_view path, std::string_view head = {}) {
+    auto raw = std::string{"GET /x HTTP/1.1\r\n"};
+    raw += head;
+    raw += "\r\n";
+    auto request = HttpRequest{};
+    assert(request.parse(raw));
+    return files.serve(request, path);
+  };
+
+  auto index = serve("");
+  assert(index.statusCode() == HttpResponse::OK);
+  assert(index.body() == "<html>home</html>");
+
+  auto css = serve("css/site.css");
+  assert(css.statusCode() == HttpResponse::OK);
+  assert(css.body() == "0123456789");
+  auto css_str = css.toString();
+  assert(css_str.find("Content-Type: text/css") != std::string::npos);
+  const auto etag_pos = css_str.find("ETag: ") + 6;
+  const auto etag =
+      css_str.substr(etag_pos, css_str.find("\r\n", etag_pos) - etag_pos);
+
+  auto not_modified = serve("css/site.css", "If-None-Match: " + etag + "\r\n");
+  assert(not_modified.statusCode() == HttpResponse::NOT_MODIFIED);
+  assert(not_modified.toString().find("Content-Length") == std::string::npos);
+
+  auto range = serve("css/site.css", "Range: bytes=2-4\r\n");
+  assert(range.statusCode() == HttpResponse::PARTIAL_CONTENT);
+  assert(range.body() == "234");
+  assert(range.toString().find("Content-Range: bytes 2-4/10") !=
+         std::string::npos);
+
+  assert(serve("css/site.css", "Range: bytes=-3\r\n").body() == "789");
+  assert(serve("css/site.css", "Range: bytes=8-\r\n").body() == "89");
+  assert(serve("css/site.css", "Range: bytes=10-\r\n").statusCode() ==
+         HttpResponse::RANGE_NOT_SATISFIABLE);
+  assert(serve("css/site.css", "Range: bytes=0-1,4-5\r\n").body() ==
+         "0123456789");
+
+  assert(serve("../etc/passwd").statusCode() == HttpResponse::FORBIDDEN);
+  assert(serve("css/../../x").statusCode() == HttpResponse::FORBIDDEN);
+  assert(serve("missing.txt").statusCode() == HttpResponse::NOT_FOUND);
+
+  // Paths are percent-decoded before the root is checked.
+  write_file(root / "css" / "my file.css", "spaced");
+  assert(serve("css/my%20file.css").body() == "spaced");
+  assert(serve("%63ss/site.css").body() == "0123456789");
+  assert(serve("%2e%2e/etc/passwd").statusCode() == HttpResponse::FORBIDDEN);
+  assert(serve("css/%2E%2E/%2e%2e/x").statusCode() ==
+         HttpResponse::FORBIDDEN);
+  for (auto bad : {"css%2Fsite.css", "css%2fsite.css", "site.css%00.txt",
+                   "css/%zz", "css/%2", "css/%"}) {
+    assert(serve(bad).statusCode() == HttpResponse::BAD_REQUEST);
+  }
+  assert(serve("css").statusCode() == HttpResponse::NOT_FOUND);
+
+  // A response keeps its mapping alive, and a replaced file is picked up.
+  auto old_css = serve("css/site.css");
+  write_file(root / "site.css.tmp", "changed content");
+  std::filesystem::rename(root / "site.css.tmp", root / "css" / "site.css");
+  assert(serve("css/site.css").body() == "changed content");
+  assert(old_css.body() == "0123456789");
+
+  std::filesystem::remove_all(root);
+  std::cout << "Test passed\n";
+}
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "http/http_request.h"
+#include "http/http_response.h"
+#include "http/http_validators.h"
+
+int main() {
+  using fz::http::HttpResponse;
+  using fz::http::HttpValidators;
+
+  const auto not_modified = [](const HttpValidators& validators,
+                               std::string_view headers) {
+    auto raw = std::string{"GET /feed HTTP/1.1\r\n"};
+    raw += headers;
+    raw += "\r\n";
+    auto request = fz::http::HttpRequest{};
+    assert(request.parse(raw));
+    return validators.notModified(request);
+  };
+
+  const auto validators =
+      HttpValidators{"\"v42\"", "Sun, 06 Nov 1994 08:49:37 GMT"};
+  assert(not_modified(validators, "If-None-Match: \"v42\"\r\n"));
+  assert(not_modified(validators, "If-None-Match: \"v1\", W/\"v42\"\r\n"));
+  assert(not_modified(validators, "If-None-Match: *\r\n"));
+  assert(!not_modified(validators, "If-None-Match: \"v41\"\r\n"));
+  assert(not_modified(validators,
+                      "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n"));
+  assert(!not_modified(validators,
+                       "If-Modified-Since: Sat, 05 Nov 1994 08:49:37 GMT\r\n"));
+  // If-None-Match takes precedence over If-Modified-Since.
+  assert(!not_modified(validators,
+                       "If-None-Match: \"v41\"\r\n"
+                       "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n"));
+  assert(!not_modified(validators, ""));
+
+  // Weak validators compare equal to their strong form.
+  assert(not_modified(HttpValidators{"W/\"v42\"", {}},
+                      "If-None-Match: \"v42\"\r\n"));
+  assert(!not_modified(HttpValidators{}, "If-None-Match: *\r\n"));
+  assert(!not_modified(HttpValidators{},
+                       "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n"));
+  std::cout << "Test passed\n";
+
+  // Headers the response sets itself are kept.
+  auto response = HttpResponse::makeOk();
+  response.addHeader("ETag", "\"own\"");
+  validators.addTo(response);
+  assert(response.header("ETag") == "\"own\"");
+  assert(response.header("Last-Modified") == validators.last_modified);
+  std::cout << "Test passed\n";
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "http/loop_local.h"
+
+int main() {
+  using fz::http::LoopLocal;
+
+  // Every thread gets a value of its own, made on its first call.
+  auto counters = LoopLocal<std::atomic<std::size_t>>{};
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0; i < 4; ++i) {
+    threads.emplace_back([&counters] {
+      for (auto j = 0; j < 1000; ++j) {
+        counters.local().fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  assert(counters.size() == 4);
+  auto total = std::size_t{0};
+  counters.forEach([&total](const auto& counter) {
+    assert(counter.load() == 1000);
+    total += counter.load();
+  });
+  assert(total == 4000);
+  std::cout << "Test passed\n";
+
+  // The same value on every call of a thread, made under the lock.
+  auto indexes = LoopLocal<std::size_t>{
+      [next = std::size_t{0}]() mutable { return next++; }};
+  auto& index = indexes.local();
+  assert(&indexes.local() == &index);
+  assert(index == 0);
+  std::thread{[&indexes] { assert(indexes.local() == 1); }}.join();
+  assert(indexes.local() == 0);
+  std::cout << "Test passed\n";
+
+  // A new instance, even at the address of a destroyed one, starts over.
+  for (auto i = 0; i < 3; ++i) {
+    auto values = std::make_unique<LoopLocal<int>>([] { return 7; });
+    assert(values->local() == 7);
+    values->local() = i;
+    assert(values->size() == 1);
+  }
+  std::cout << "Test passed\n";
+
+  return 0;
+}
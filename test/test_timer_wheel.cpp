@@ -0,0 +1,66 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "http/timer_wheel.h"
+
+int main() {
+  using namespace std::chrono_literals;
+  using fz::http::TimerWheel;
+
+  const auto start = TimerWheel::Clock::time_point{};
+  auto wheel = TimerWheel{100ms, start};
+
+  // Timers fire on the first tick at or after their deadline, across every
+  // level of the wheel.
+  auto fired = std::vector<int>{};
+  for (auto ms : {50, 100, 250, 6400, 6500, 500'000, 30'000'000}) {
+    wheel.add(std::chrono::milliseconds{ms}, [&fired, ms]() {
+      fired.push_back(ms);
+    });
+  }
+  assert(wheel.size() == 7);
+
+  wheel.advance(start + 99ms);
+  assert(fired.empty());
+  wheel.advance(start + 100ms);
+  assert(fired.size() == 2);
+  wheel.advance(start + 6400ms);
+  assert(fired.size() == 4 && fired[2] == 250 && fired[3] == 6400);
+  wheel.advance(start + 499'999ms);
+  assert(fired.size() == 5);
+  wheel.advance(start + 500'000ms);
+  assert(fired.size() == 6);
+  wheel.advance(start + 30'000'000ms);
+  assert(fired.size() == 7 && fired.back() == 30'000'000);
+  assert(wheel.size() == 0);
+  std::cout << "Test passed\n";
+
+  // Cancelled timers never fire, and stale ids are ignored once the slot is
+  // reused.
+  auto count = 0;
+  const auto now = start + 30'000'000ms;
+  const auto id = wheel.add(1s, [&count]() { ++count; });
+  wheel.cancel(id);
+  const auto other = wheel.add(1s, [&count]() { count += 10; });
+  wheel.cancel(id);
+  assert(wheel.size() == 1);
+  wheel.advance(now + 1s);
+  assert(count == 10);
+  wheel.cancel(other);
+  std::cout << "Test passed\n";
+
+  // A callback can re-arm itself, e.g. a keep-alive timer being restarted.
+  auto rearmed = 0;
+  auto callback = std::function<void()>{};
+  callback = [&]() {
+    if (++rearmed < 3) {
+      wheel.add(200ms, callback);
+    }
+  };
+  wheel.add(200ms, callback);
+  wheel.advance(now + 2s);
+  assert(rearmed == 3);
+  std::cout << "Test passed\n";
+}
@@ -0,0 +1,220 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http/websocket.h"
+#include "http/websocket_frame.h"
+#include "http/websocket_parse.h"
+#include "net/common/buffer.h"
+
+namespace {
+
+using fz::http::WebSocketFrame;
+using fz::http::WebSocketParse;
+using Opcode = WebSocketFrame::Opcode;
+
+constexpr auto KEY = WebSocketFrame::MaskingKey{0x37, 0xfa, 0x21, 0x3d};
+
+/**
+ * @brief A frame as a client sends it: masked, with raw header bits.
+ */
+auto clientFrame(std::uint8_t first, std::string_view payload,
+                 bool masked = true) -> std::string {
+  auto frame = std::string{};
+  WebSocketFrame::serialize(frame, Opcode::Text, payload);
+  frame[0] = static_cast<char>(first);
+  if (!masked) {
+    return frame;
+  }
+
+  const auto header_size = frame.size() - payload.size();
+  frame[1] = static_cast<char>(frame[1] | 0x80);
+  auto masked_payload = std::string{payload};
+  WebSocketFrame::mask(masked_payload.data(), masked_payload.size(), KEY);
+  return frame.substr(0, header_size) +
+         std::string{reinterpret_cast<const char*>(KEY.data()), KEY.size()} +
+         masked_payload;
+}
+
+auto clientFrame(Opcode opcode, std::string_view payload, bool fin = true)
+    -> std::string {
+  return clientFrame(
+      static_cast<std::uint8_t>((fin ? 0x80 : 0) |
+                                static_cast<std::uint8_t>(opcode)),
+      payload);
+}
+
+struct Result {
+  std::vector<std::pair<Opcode, std::string>> messages;
+  WebSocketParse::Status status;
+  std::uint16_t close_code;
+};
+
+auto parse(std::string_view input, std::size_t chunk_size = 0,
+           std::size_t max_message_size = std::size_t{1} << 20) -> Result {
+  auto parse = WebSocketParse{};
+  parse.setLimits({.max_message_size = max_message_size});
+  auto buffer = fz::net::Buffer{};
+  auto result = Result{};
+  const auto step = chunk_size == 0 ? input.size() : chunk_size;
+  for (std::size_t i = 0; i < input.size(); i += step) {
+    buffer.append(input.substr(i, step));
+    parse.run(buffer, [&result](Opcode opcode, std::string_view payload) {
+      result.messages.emplace_back(opcode, std::string{payload});
+    });
+  }
+  result.status = parse.status();
+  result.close_code = parse.closeCode();
+  return result;
+}
+
+}  // namespace
+
+int main() {
+  // Server frames: the length field grows at 126 and 65536 bytes.
+  assert(WebSocketFrame::make(Opcode::Text, "hi") ==
+         std::string_view("\x81\x02hi", 4));
+  assert(WebSocketFrame::make(Opcode::Binary, std::string(125, 'a')).size() ==
+         2 + 125);
+  const auto medium = WebSocketFrame::make(Opcode::Text, std::string(126, 'a'));
+  assert(medium.size() == 4 + 126);
+  assert(medium.substr(1, 3) == std::string_view("\x7e\x00\x7e", 3));
+  const auto large =
+      WebSocketFrame::make(Opcode::Text, std::string(65536, 'a'));
+  assert(large.size() == 10 + 65536);
+  assert(large.substr(1, 9) ==
+         std::string_view("\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 9));
+  auto fragment = std::string{};
+  WebSocketFrame::serialize(fragment, Opcode::Text, "a", false);
+  assert(fragment[0] == '\x01');
+  assert(WebSocketFrame::closePayload(1000, "bye") ==
+         std::string_view("\x03\xe8"
+                          "bye",
+                          5));
+  assert(WebSocketFrame::closePayload(1000, std::string(200, 'r')).size() ==
+         WebSocketFrame::MAX_CONTROL_PAYLOAD);
+
+  // Every kernel masks like the byte loop, at every key offset and at
+  // lengths around the vector widths.
+  std::cout << "Selected kernel: "
+            << WebSocketFrame::kernelToString(WebSocketFrame::kernel())
+            << "\n";
+  auto engine = std::mt19937{42};
+  auto byte = std::uniform_int_distribution<int>{0, 255};
+  for (std::size_t size = 0; size < 100; ++size) {
+    auto data = std::string(size, '\0');
+    for (auto& c : data) {
+      c = static_cast<char>(byte(engine));
+    }
+    for (std::size_t offset = 0; offset < 4; ++offset) {
+      auto expected = data;
+      for (std::size_t i = 0; i < size; ++i) {
+        expected[i] = static_cast<char>(expected[i] ^ KEY[(offset + i) % 4]);
+      }
+      for (auto kernel :
+           {WebSocketFrame::Kernel::Scalar, WebSocketFrame::Kernel::SSE2,
+            WebSocketFrame::Kernel::AVX2}) {
+        if (!WebSocketFrame::supported(kernel)) {
+          continue;
+        }
+        auto masked = data;
+        WebSocketFrame::mask(kernel, masked.data(), masked.size(), KEY, offset);
+        assert(masked == expected);
+      }
+    }
+  }
+
+  assert(WebSocketFrame::validUtf8(""));
+  assert(WebSocketFrame::validUtf8("plain ascii, long enough for a word"));
+  assert(WebSocketFrame::validUtf8("gr\xc3\xbc\xc3\x9f \xe2\x82\xac "
+                                   "\xf0\x9f\x98\x80"));
+  assert(!WebSocketFrame::validUtf8("\xc0\xaf"));          // overlong
+  assert(!WebSocketFrame::validUtf8("\xe0\x80\xaf"));      // overlong
+  assert(!WebSocketFrame::validUtf8("\xed\xa0\x80"));      // surrogate
+  assert(!WebSocketFrame::validUtf8("\xf4\x90\x80\x80"));  // past U+10FFFF
+  assert(!WebSocketFrame::validUtf8("abcdefgh\xe2\x82"));  // truncated
+  assert(!WebSocketFrame::validUtf8("\x80"));
+
+  // A masked frame, whole and byte by byte.
+  const auto hello = clientFrame(Opcode::Text, "Hello");
+  for (auto chunk_size : {std::size_t{0}, std::size_t{1}}) {
+    const auto result = parse(hello + hello, chunk_size);
+    assert(result.status == WebSocketParse::Status::Frame);
+    assert(result.messages.size() == 2);
+    assert(result.messages[1].first == Opcode::Text);
+    assert(result.messages[1].second == "Hello");
+  }
+
+  // Extended lengths.
+  const auto big = std::string(70000, 'x');
+  auto result = parse(clientFrame(Opcode::Binary, big), 4096);
+  assert(result.messages.size() == 1);
+  assert(result.messages[0].second == big);
+
+  // Fragments are gathered, a ping between them is handed over first.
+  result = parse(clientFrame(Opcode::Text, "Hel", false) +
+                     clientFrame(Opcode::Ping, "p") +
+                     clientFrame(Opcode::Continuation, "l", false) +
+                     clientFrame(Opcode::Continuation, "o"),
+                 3);
+  assert(result.status == WebSocketParse::Status::Frame);
+  assert(result.messages.size() == 2);
+  assert(result.messages[0].first == Opcode::Ping);
+  assert(result.messages[0].second == "p");
+  assert(result.messages[1].first == Opcode::Text);
+  assert(result.messages[1].second == "Hello");
+
+  // A close frame ends parsing.
+  result = parse(
+      clientFrame(Opcode::Close, WebSocketFrame::closePayload(1000, "bye")) +
+      hello);
+  assert(result.status == WebSocketParse::Status::Closed);
+  assert(result.messages.size() == 1);
+  assert(result.messages[0].first == Opcode::Close);
+
+  const auto protocol_error = [](std::string_view input) {
+    const auto result = parse(input);
+    return result.status == WebSocketParse::Status::INVALID &&
+           result.close_code == WebSocketFrame::PROTOCOL_ERROR;
+  };
+  assert(protocol_error(clientFrame(0x81, "Hello", false)));  // unmasked
+  assert(protocol_error(clientFrame(0xc1, "Hello")));         // RSV1
+  assert(protocol_error(clientFrame(0x83, "Hello")));         // opcode
+  assert(protocol_error(clientFrame(0x09, "p")));  // fragmented ping
+  assert(protocol_error(clientFrame(Opcode::Ping, std::string(126, 'p'))));
+  assert(protocol_error(clientFrame(Opcode::Continuation, "a")));
+  assert(protocol_error(clientFrame(Opcode::Text, "a", false) +
+                        clientFrame(Opcode::Text, "b")));
+  assert(protocol_error(clientFrame(Opcode::Close, "\x03")));
+  assert(protocol_error(clientFrame(
+      Opcode::Close, WebSocketFrame::closePayload(WebSocketFrame::ABNORMAL))));
+
+  result = parse(clientFrame(Opcode::Text, "\xc0\xaf"));
+  assert(result.status == WebSocketParse::Status::INVALID);
+  assert(result.close_code == WebSocketFrame::INVALID_PAYLOAD);
+  result = parse(clientFrame(Opcode::Text, "\xe2\x82", false) +
+                 clientFrame(Opcode::Continuation, "\xac"));
+  assert(result.status == WebSocketParse::Status::Frame);
+  assert(result.messages[0].second == "\xe2\x82\xac");
+
+  // The limit applies to the whole message, before its frames are buffered.
+  result = parse(clientFrame(Opcode::Binary, std::string(100, 'a')), 0, 64);
+  assert(result.status == WebSocketParse::Status::INVALID);
+  assert(result.close_code == WebSocketFrame::MESSAGE_TOO_BIG);
+  result = parse(clientFrame(Opcode::Binary, std::string(40, 'a'), false) +
+                     clientFrame(Opcode::Continuation, std::string(40, 'a')),
+                 0, 64);
+  assert(result.close_code == WebSocketFrame::MESSAGE_TOO_BIG);
+  assert(parse(clientFrame(0x82, std::string(100, 'a')).substr(0, 4), 0, 64)
+             .status == WebSocketParse::Status::INVALID);
+
+  // The example from RFC 6455, section 1.3.
+  assert(fz::http::WebSocketHandler::acceptKey("dGhlIHNhbXBsZSBub25jZQ==") ==
+         "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+  std::cout << "Test passed\n";
+}